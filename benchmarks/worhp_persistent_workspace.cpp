@@ -0,0 +1,221 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+// Benchmark of the persistent workspace mode of ppnf::worhp (see worhp::set_persistent_workspace()).
+//
+// A single individual of the Luksan-Vlcek 1 problem is repeatedly polished, as an island would do, with and without
+// the persistent workspace mode, and the average time per evolve() call is reported.
+//
+// Usage: worhp_persistent_workspace [path to the worhp library] [problem dimension] [number of evolves]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <pagmo/population.hpp>
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/worhp.hpp>
+
+#if defined __APPLE__
+#define WORHP_LIB "./libworhp_c.dylib"
+#elif defined __MINGW32__
+#define WORHP_LIB ".\\libworhp_c.dll"
+#else
+#define WORHP_LIB "./libworhp_c.so"
+#endif
+
+using namespace pagmo;
+
+namespace
+{
+// The Luksan-Vlcek 1 problem (the same as pagmo::luksan_vlcek1, with the constraints formulated as equalities),
+// complete with the hessians. These are needed as the bogus worhp library requests all the derivatives, and they
+// also allow to use a sparse hessian of the lagrangian with the real library.
+//
+//   min f(x) = sum_{i=0}^{n-2} 100 (x_i^2 - x_{i+1})^2 + (x_i - 1)^2
+//   s.t. c_k(x) = 3 x_{k+1}^3 + 2 x_{k+2} - 5 + sin(x_{k+1} - x_{k+2}) sin(x_{k+1} + x_{k+2}) + 4 x_{k+1}
+//                 - x_k exp(x_k - x_{k+1}) - 3 = 0, k = 0 .. n-3
+//        -5 <= x_i <= 5
+struct luksan_vlcek1_h {
+    explicit luksan_vlcek1_h(vector_double::size_type dim = 3u) : m_dim(dim) {}
+    vector_double fitness(const vector_double &x) const
+    {
+        vector_double retval(m_dim - 1u, 0.);
+        for (decltype(m_dim) i = 0u; i < m_dim - 1u; ++i) {
+            retval[0] += 100. * (x[i] * x[i] - x[i + 1]) * (x[i] * x[i] - x[i + 1]) + (x[i] - 1.) * (x[i] - 1.);
+        }
+        for (decltype(m_dim) k = 0u; k < m_dim - 2u; ++k) {
+            retval[k + 1u] = 3. * std::pow(x[k + 1], 3.) + 2. * x[k + 2] - 5.
+                             + std::sin(x[k + 1] - x[k + 2]) * std::sin(x[k + 1] + x[k + 2]) + 4. * x[k + 1]
+                             - x[k] * std::exp(x[k] - x[k + 1]) - 3.;
+        }
+        return retval;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {vector_double(m_dim, -5.), vector_double(m_dim, 5.)};
+    }
+    vector_double::size_type get_nec() const
+    {
+        return m_dim - 2u;
+    }
+    sparsity_pattern gradient_sparsity() const
+    {
+        sparsity_pattern retval;
+        for (decltype(m_dim) i = 0u; i < m_dim; ++i) {
+            retval.emplace_back(0u, i);
+        }
+        for (decltype(m_dim) k = 0u; k < m_dim - 2u; ++k) {
+            retval.emplace_back(k + 1u, k);
+            retval.emplace_back(k + 1u, k + 1u);
+            retval.emplace_back(k + 1u, k + 2u);
+        }
+        return retval;
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        vector_double retval(m_dim + 3u * (m_dim - 2u), 0.);
+        for (decltype(m_dim) i = 0u; i < m_dim - 1u; ++i) {
+            const auto u = x[i] * x[i] - x[i + 1];
+            retval[i] += 400. * x[i] * u + 2. * (x[i] - 1.);
+            retval[i + 1u] -= 200. * u;
+        }
+        for (decltype(m_dim) k = 0u; k < m_dim - 2u; ++k) {
+            const auto e = std::exp(x[k] - x[k + 1]);
+            retval[m_dim + 3u * k] = -(1. + x[k]) * e;
+            retval[m_dim + 3u * k + 1u] = 9. * x[k + 1] * x[k + 1] + std::sin(2. * x[k + 1]) + 4. + x[k] * e;
+            retval[m_dim + 3u * k + 2u] = 2. - std::sin(2. * x[k + 2]);
+        }
+        return retval;
+    }
+    std::vector<sparsity_pattern> hessians_sparsity() const
+    {
+        std::vector<sparsity_pattern> retval(m_dim - 1u);
+        // The objective hessian is tridiagonal.
+        for (decltype(m_dim) i = 0u; i < m_dim; ++i) {
+            if (i > 0u) {
+                retval[0].emplace_back(i, i - 1u);
+            }
+            retval[0].emplace_back(i, i);
+        }
+        for (decltype(m_dim) k = 0u; k < m_dim - 2u; ++k) {
+            retval[k + 1u] = {{k, k}, {k + 1u, k}, {k + 1u, k + 1u}, {k + 2u, k + 2u}};
+        }
+        return retval;
+    }
+    std::vector<vector_double> hessians(const vector_double &x) const
+    {
+        std::vector<vector_double> retval(m_dim - 1u);
+        auto &h0 = retval[0];
+        for (decltype(m_dim) i = 0u; i < m_dim; ++i) {
+            if (i > 0u) {
+                h0.push_back(-400. * x[i - 1]);
+            }
+            double hii = 0.;
+            if (i < m_dim - 1u) {
+                hii += 1200. * x[i] * x[i] - 400. * x[i + 1] + 2.;
+            }
+            if (i > 0u) {
+                hii += 200.;
+            }
+            h0.push_back(hii);
+        }
+        for (decltype(m_dim) k = 0u; k < m_dim - 2u; ++k) {
+            const auto e = std::exp(x[k] - x[k + 1]);
+            retval[k + 1u] = {-(2. + x[k]) * e, (1. + x[k]) * e, 18. * x[k + 1] + 2. * std::cos(2. * x[k + 1]) - x[k] * e,
+                              -2. * std::cos(2. * x[k + 2])};
+        }
+        return retval;
+    }
+    std::string get_name() const
+    {
+        return "Luksan-Vlcek 1 (with hessians)";
+    }
+    vector_double::size_type m_dim;
+};
+
+// Average time in milliseconds of an evolve() call.
+double ms_per_evolve(const ppnf::worhp &uda, const population &pop, unsigned n_evolves)
+{
+    // Warm up: the library is loaded and, in the persistent mode, the workspace initialised.
+    uda.evolve(pop);
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0u; i < n_evolves; ++i) {
+        uda.evolve(pop);
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count()) / 1000.
+           / n_evolves;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::string library = argc > 1 ? argv[1] : WORHP_LIB;
+    const auto dim = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000ul;
+    const auto n_evolves = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : 20u;
+
+    population pop{problem{luksan_vlcek1_h{dim}}, 1u, 42u};
+
+    ppnf::worhp uda{false, library};
+    const auto fresh = ms_per_evolve(uda, pop, n_evolves);
+    uda.set_persistent_workspace(true);
+    const auto persistent = ms_per_evolve(uda, pop, n_evolves);
+
+    std::cout << "WORHP evolve on " << pop.get_problem().get_name() << ", n = " << dim << " (" << n_evolves
+              << " evolves):\n";
+    std::cout << std::setw(30) << "fresh data structures: " << std::setw(10) << fresh << " ms/evolve\n";
+    std::cout << std::setw(30) << "persistent workspace: " << std::setw(10) << persistent << " ms/evolve\n";
+    std::cout << std::setw(30) << "saved: " << std::setw(10) << fresh - persistent << " ms/evolve\n";
+    return 0;
+}
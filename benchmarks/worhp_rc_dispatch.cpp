@@ -0,0 +1,147 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+// Micro-benchmark of the overhead of the WORHP reverse communication loop (see worhp::evolve()).
+//
+// Each iteration of the loop polls the library 8 times via GetUserAction and acknowledges the
+// served requests via DoneUserAction. Here we measure the cost per iteration of that dispatch when the
+// symbols are held in std::function wrappers (as the plugin used to do) and when they are held as plain
+// C function pointers copied by value (as the plugin does now). The bogus worhp library is used, so that
+// the library calls themselves are (almost) free and the dispatch overhead dominates.
+//
+// Usage: worhp_rc_dispatch [path to the worhp library] [number of iterations]
+
+#include <boost/dll/import.hpp>
+#include <boost/dll/shared_library.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+#include <pagmo_plugins_nonfree/bogus_libs/worhp_lib/worhp_bogus.h>
+
+#if defined __APPLE__
+#define WORHP_LIB "./libworhp_c.dylib"
+#elif defined __MINGW32__
+#define WORHP_LIB ".\\libworhp_c.dll"
+#else
+#define WORHP_LIB "./libworhp_c.so"
+#endif
+
+namespace
+{
+// The actions polled in each iteration of the reverse communication loop, in the same order
+// used by worhp::evolve().
+constexpr int rc_actions[] = {callWorhp, iterOutput, evalF, evalG, evalDF, evalHM, evalDG, fidif};
+
+// One iteration of the loop: the actions which are not callWorhp or fidif are acknowledged.
+template <typename GetUserAction_t, typename DoneUserAction_t>
+unsigned long rc_iteration(GetUserAction_t GetUserAction, DoneUserAction_t DoneUserAction, Control *cnt)
+{
+    unsigned long served = 0u;
+    for (auto action : rc_actions) {
+        if (GetUserAction(cnt, action)) {
+            ++served;
+            if (action != callWorhp && action != fidif) {
+                DoneUserAction(cnt, action);
+            }
+        }
+    }
+    return served;
+}
+
+template <typename F>
+double ns_per_iteration(F &&f, unsigned long n_iter)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0u; i < n_iter; ++i) {
+        f();
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count())
+           / static_cast<double>(n_iter);
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::string library = argc > 1 ? argv[1] : WORHP_LIB;
+    const unsigned long n_iter = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000000ul;
+
+    boost::dll::shared_library libworhp(library);
+    Control cnt;
+
+    // Before: symbols imported as std::function and used through references to the wrappers.
+    const std::function<bool(const Control *, int)> GetUserAction_f
+        = boost::dll::import<bool(const Control *, int)>(libworhp, "GetUserAction");
+    const std::function<void(Control *, int)> DoneUserAction_f
+        = boost::dll::import<void(Control *, int)>(libworhp, "DoneUserAction");
+    const auto &GetUserAction_ref = GetUserAction_f;
+    const auto &DoneUserAction_ref = DoneUserAction_f;
+
+    // After: symbols resolved as plain function pointers and passed by value.
+    const auto GetUserAction_p = &libworhp.get<std::remove_pointer_t<bool (*)(const Control *, int)>>("GetUserAction");
+    const auto DoneUserAction_p = &libworhp.get<std::remove_pointer_t<void (*)(Control *, int)>>("DoneUserAction");
+
+    volatile unsigned long sink = 0u;
+    const auto before = ns_per_iteration(
+        [&]() { sink = sink + rc_iteration<const std::function<bool(const Control *, int)> &,
+                                           const std::function<void(Control *, int)> &>(GetUserAction_ref,
+                                                                                        DoneUserAction_ref, &cnt); },
+        n_iter);
+    const auto after
+        = ns_per_iteration([&]() { sink = sink + rc_iteration(GetUserAction_p, DoneUserAction_p, &cnt); }, n_iter);
+
+    std::cout << "Reverse communication loop dispatch (" << n_iter << " iterations, " << sizeof(rc_actions) / sizeof(int)
+              << " polls per iteration):\n";
+    std::cout << std::setw(30) << "std::function: " << std::setw(10) << before << " ns/iteration\n";
+    std::cout << std::setw(30) << "plain function pointers: " << std::setw(10) << after << " ns/iteration\n";
+    std::cout << std::setw(30) << "speedup: " << std::setw(10) << before / after << "\n";
+    return 0;
+}
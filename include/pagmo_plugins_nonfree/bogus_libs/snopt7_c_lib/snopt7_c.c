@@ -9,11 +9,29 @@ inline double closed_interval_rand(double x0, double x1)
     return x0 + (x1 - x0) * rand() / ((double)RAND_MAX);
 }
 
-__PAGMO_VISIBLE void snInit(snProblem_76 *prob, char *name, char *prtfile, int summOn){};
+// Counters of the calls made to the workspace management routines, so that the tests can check when the plugin
+// (re-)initialises the SNOPT7 workspace and passes the options. They are not meant to be accessed concurrently.
+static int snInit_calls = 0;
+static int setParameter_calls = 0;
+static int deleteSNOPT_calls = 0;
+
+// Reports the number of calls made so far to snInit, to setIntParameter / setRealParameter and to deleteSNOPT.
+__PAGMO_VISIBLE void bogus_call_counts(int *n_snInit, int *n_setParameter, int *n_deleteSNOPT)
+{
+    *n_snInit = snInit_calls;
+    *n_setParameter = setParameter_calls;
+    *n_deleteSNOPT = deleteSNOPT_calls;
+};
+
+__PAGMO_VISIBLE void snInit(snProblem_76 *prob, char *name, char *prtfile, int summOn)
+{
+    ++snInit_calls;
+};
 
 __PAGMO_VISIBLE int setIntParameter(snProblem_76 *prob, char stropt[], int opt)
 {
     char *invalid;
+    ++setParameter_calls;
     invalid = "invalid_integer_option";
     if (strcmp(stropt, invalid) == 0) {
         return 1;
@@ -25,6 +43,7 @@ __PAGMO_VISIBLE int setIntParameter(snProblem_76 *prob, char stropt[], int opt)
 __PAGMO_VISIBLE int setRealParameter(snProblem_76 *prob, char stropt[], double opt)
 {
     char *invalid;
+    ++setParameter_calls;
     invalid = "invalid_numeric_option";
     if (strcmp(stropt, invalid) == 0) {
         return 1;
@@ -33,10 +52,15 @@ __PAGMO_VISIBLE int setRealParameter(snProblem_76 *prob, char stropt[], double o
     }
 };
 
-__PAGMO_VISIBLE void deleteSNOPT(snProblem_76 *prob){};
+__PAGMO_VISIBLE void deleteSNOPT(snProblem_76 *prob)
+{
+    ++deleteSNOPT_calls;
+};
 
 // The following routine fakes the snOptA interface and generates 100 random vectors. It will not touch the input
-// decision vector. We use this implementation to test since the true library is commercial
+// decision vector. Each random vector is treated as a major iteration, after which the snLog and snSTOP hooks are
+// called (if installed) with the objective as merit function, the point as primal feasible, unit step length and
+// infeasibilities and no superbasics. We use this implementation to test since the true library is commercial
 __PAGMO_VISIBLE int solveA(snProblem_76 *prob, int start, int nF, int n, double ObjAdd, int ObjRow, snFunA usrfun, int neA, int *iAfun,
            int *jAvar, double *A, int neG, int *iGfun, int *jGvar, double *xlow, double *xupp, double *Flow,
            double *Fupp, double *x, int *xstate, double *xmul, double *F, int *Fstate, double *Fmul, int *nS, int *nInf,
@@ -52,6 +76,14 @@ __PAGMO_VISIBLE int solveA(snProblem_76 *prob, int start, int nF, int n, double
     char cu[1];
     int lencu = 0;
     double *G = malloc(sizeof(double) * nF * n);
+    int iAbort = 0;
+    int KTcond[2] = {1, 0};
+    int nMajor = 0;
+    double prInf = 1.;
+    double duInf = 1.;
+    double step = 1.;
+    int idummy = 0;
+    double rdummy = 0.;
     srand((unsigned int)(time(NULL)));
 
     int i, j;
@@ -67,6 +99,26 @@ __PAGMO_VISIBLE int solveA(snProblem_76 *prob, int start, int nF, int n, double
             retval = 71;
             break;
         }
+        nMajor = i + 1;
+        if (prob->snLog) {
+            prob->snLog(&iAbort, &idummy, &idummy, KTcond, &idummy, &idummy, &n, &n, &idummy, &idummy, &idummy,
+                        &nMajor, &idummy, &idummy, &rdummy, &idummy, &rdummy, &rdummy, F, &rdummy, &step, &prInf,
+                        &duInf, &rdummy, &rdummy, NULL, &idummy, NULL, NULL, NULL, NULL, NULL, xlow, xupp, NULL, NULL,
+                        x_new, cu, &lencu, prob->iu, &(prob->leniu), prob->ru, &(prob->lenru), cu, &lencu, NULL,
+                        &idummy, NULL, &idummy);
+        }
+        if (prob->snSTOP) {
+            prob->snSTOP(&iAbort, KTcond, &idummy, &idummy, &idummy, &idummy, &n, &n, &idummy, &idummy, &idummy,
+                         &idummy, &idummy, &idummy, &nMajor, &idummy, &idummy, &rdummy, &idummy, &rdummy, &rdummy,
+                         F, &rdummy, &rdummy, &prInf, &duInf, &rdummy, &rdummy, NULL, &idummy, &idummy, NULL, NULL,
+                         NULL, &idummy, NULL, xlow, xupp, NULL, NULL, NULL, NULL, NULL, NULL, NULL, x_new, cu, &lencu,
+                         prob->iu, &(prob->leniu), prob->ru, &(prob->lenru), cu, &lencu, NULL, &idummy, NULL,
+                         &idummy);
+            if (iAbort) {
+                retval = 74;
+                break;
+            }
+        }
     }
     free(x_new);
     free(G);
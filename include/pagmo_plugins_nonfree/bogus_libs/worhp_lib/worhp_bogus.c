@@ -10,10 +10,24 @@ inline double closed_interval_rand(double x0, double x1)
     return x0 + (x1 - x0) * rand() / ((double)RAND_MAX);
 }
 
+// Counters of the calls made to the routines allocating, restarting and releasing the data structures. They are not
+// meant to be accessed concurrently.
+static int init_calls = 0;
+static int restart_calls = 0;
+static int free_calls = 0;
+
+void bogus_call_counts(int *n_init, int *n_restart, int *n_free)
+{
+    *n_init = init_calls;
+    *n_restart = restart_calls;
+    *n_free = free_calls;
+}
+
 void ReadParams(int *a, const char b[], Params *c) {}
 void WorhpPreInit(OptVar *o, Workspace *w, Params *p, Control *c) {}
 void WorhpInit(OptVar *o, Workspace *w, Params *p, Control *c)
 {
+    ++init_calls;
     o->X = calloc(o->n, sizeof(double));
     o->G = calloc(o->m, sizeof(double));
     o->Lambda = calloc(o->n, sizeof(double));
@@ -34,9 +48,16 @@ void WorhpInit(OptVar *o, Workspace *w, Params *p, Control *c)
     w->DG.NeedStructure = false;
     w->HM.NeedStructure = false;
     w->ScaleObj = 1;
+    w->MajorIter = 0;
     c->status = 0; // to ensure it will enter the main loop in worhp.hpp
     srand((unsigned int)(time(NULL)));
 }
+void WorhpRestart(OptVar *o, Workspace *w, Params *p, Control *c)
+{
+    ++restart_calls;
+    w->MajorIter = 0;
+    c->status = 0; // to ensure it will enter the main loop in worhp.hpp
+}
 bool GetUserAction(const Control *c, int b)
 {
     return true;
@@ -46,6 +67,12 @@ void IterationOutput(OptVar *o, Workspace *w, Params *p, Control *c) {}
 void Worhp(OptVar *o, Workspace *w, Params *p, Control *c)
 {
     c->status = c->status + 100; // this will make it so after ten calls it concludes.
+    // Each call is a major iteration, with a unit step to a feasible point.
+    ++w->MajorIter;
+    w->ArmijoAlpha = 1.;
+    w->NormMax_CV = 0.;
+    w->OptiMax = 1.;
+    w->Feasible = true;
     // Random vector
     int j;
     for (j = 0; j < o->n; ++j) {
@@ -74,6 +101,7 @@ void StatusMsgString(OptVar *o, Workspace *w, Params *p, Control *c, char messag
 
 void WorhpFree(OptVar *o, Workspace *w, Params *p, Control *c)
 {
+    ++free_calls;
     free(o->X);
     free(o->G);
     free(o->Lambda);
@@ -60,4 +60,16 @@ double closed_interval_rand(double x0, double x1);
 // The original headers from worhp
 #include "worhp_headers/worhp.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reports the number of calls made so far to WorhpInit, WorhpRestart and WorhpFree (not part of the WORHP API: it
+// is used by the tests to check when the plugin re-uses the data structures).
+DLL_PUBLIC void bogus_call_counts(int *n_init, int *n_restart, int *n_free);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // WORHP_BOGUS_H
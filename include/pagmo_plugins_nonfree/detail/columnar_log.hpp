@@ -0,0 +1,233 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_COLUMNAR_LOG_HPP
+#define PPNF_DETAIL_COLUMNAR_LOG_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <pagmo/s11n.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+// An optimisation log stored as a structure of arrays, i.e. with one contiguous column per field of the log lines
+// (bool fields are stored as unsigned char, so that each column can be viewed as a plain array).
+//
+// The log can be bounded: when a line is added to a full log, the log is downsampled by discarding every other line
+// and, from then on, only one every 2 (4, 8, ...) lines offered is recorded. The lines kept are thus always those
+// offered at multiples of the current stride, they cover the whole run and they stay in chronological order. The
+// columns are preallocated on construction and on clear(), so that adding lines to a bounded log never allocates.
+//
+// The columns are held via a shared pointer, so that they can be exposed (e.g., to Python) without copies, keeping them
+// alive via storage(): the log detaches from columns shared this way (or with copies of the log) before modifying them.
+template <typename... Ts>
+class columnar_log
+{
+    template <typename T>
+    using stored_t = std::conditional_t<std::is_same<T, bool>::value, unsigned char, T>;
+
+public:
+    using size_type = std::size_t;
+    using line_type = std::tuple<Ts...>;
+    using columns_type = std::tuple<std::vector<stored_t<Ts>>...>;
+    // The type of the I-th column.
+    template <std::size_t I>
+    using column_type = std::tuple_element_t<I, columns_type>;
+
+    // A capacity of zero means unbounded.
+    explicit columnar_log(size_type capacity = 0u) : m_capacity(capacity)
+    {
+        assert(m_capacity != 1u);
+        clear();
+    }
+    size_type capacity() const
+    {
+        return m_capacity;
+    }
+    // Sets the capacity, downsampling the lines already recorded if needed. The capacity must not be 1.
+    void set_capacity(size_type capacity)
+    {
+        assert(capacity != 1u);
+        m_capacity = capacity;
+        if (m_capacity && size() > m_capacity) {
+            detach();
+            while (size() > m_capacity) {
+                downsample();
+            }
+        }
+    }
+    size_type size() const
+    {
+        return std::get<0>(m_data->m_columns).size();
+    }
+    bool empty() const
+    {
+        return !size();
+    }
+    // The number of lines offered per line recorded.
+    unsigned long long stride() const
+    {
+        return m_data->m_stride;
+    }
+    // Empties the log (in new storage, preallocated if the log is bounded).
+    void clear()
+    {
+        m_data = std::make_shared<data>();
+        reserve();
+    }
+    // Offers a line to the log, which records it only if it falls on the current stride.
+    void push_back(const Ts &...fields)
+    {
+        const auto k = m_data->m_offered;
+        detach();
+        ++m_data->m_offered;
+        if (k % m_data->m_stride) {
+            return;
+        }
+        if (m_capacity && size() == m_capacity) {
+            downsample();
+            if (k % m_data->m_stride) {
+                return;
+            }
+        }
+        push_back_impl(std::index_sequence_for<Ts...>{}, fields...);
+    }
+    line_type operator[](size_type i) const
+    {
+        return line(std::index_sequence_for<Ts...>{}, i);
+    }
+    // The log as an array of structures.
+    std::vector<line_type> lines() const
+    {
+        std::vector<line_type> retval;
+        retval.reserve(size());
+        for (size_type i = 0u; i < size(); ++i) {
+            retval.push_back((*this)[i]);
+        }
+        return retval;
+    }
+    template <std::size_t I>
+    const column_type<I> &column() const
+    {
+        return std::get<I>(m_data->m_columns);
+    }
+    // A handle keeping the current columns alive.
+    std::shared_ptr<const void> storage() const
+    {
+        return m_data;
+    }
+    template <typename Archive>
+    void serialize(Archive &ar, unsigned)
+    {
+        if (Archive::is_loading::value) {
+            m_data = std::make_shared<data>();
+        }
+        pagmo::detail::archive(ar, m_capacity, m_data->m_columns, m_data->m_offered, m_data->m_stride);
+    }
+
+private:
+    struct data {
+        columns_type m_columns;
+        // The number of lines offered so far, and the current stride.
+        unsigned long long m_offered = 0u;
+        unsigned long long m_stride = 1u;
+    };
+    void detach()
+    {
+        if (m_data.use_count() > 1) {
+            m_data = std::make_shared<data>(*m_data);
+            reserve();
+        }
+    }
+    void reserve()
+    {
+        if (m_capacity) {
+            std::apply([this](auto &...cols) { (cols.reserve(m_capacity), ...); }, m_data->m_columns);
+        }
+    }
+    // Keeps the lines at even positions (i.e., offered at multiples of twice the stride) and doubles the stride.
+    void downsample()
+    {
+        std::apply(
+            [](auto &...cols) {
+                const auto compact = [](auto &col) {
+                    size_type j = 0u;
+                    for (size_type i = 0u; i < col.size(); i += 2u) {
+                        col[j++] = col[i];
+                    }
+                    col.resize(j);
+                };
+                (compact(cols), ...);
+            },
+            m_data->m_columns);
+        m_data->m_stride *= 2u;
+    }
+    template <std::size_t... I>
+    void push_back_impl(std::index_sequence<I...>, const Ts &...fields)
+    {
+        (std::get<I>(m_data->m_columns).push_back(static_cast<stored_t<Ts>>(fields)), ...);
+    }
+    template <std::size_t... I>
+    line_type line(std::index_sequence<I...>, size_type i) const
+    {
+        return line_type{static_cast<Ts>(std::get<I>(m_data->m_columns)[i])...};
+    }
+
+    size_type m_capacity;
+    std::shared_ptr<data> m_data;
+};
+} // namespace detail
+} // namespace ppnf
+
+#endif
@@ -0,0 +1,212 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_EVAL_CACHE_HPP
+#define PPNF_DETAIL_EVAL_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pagmo/types.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+// Hash of a decision vector (FNV-1a over the bit patterns of its components).
+inline std::size_t dv_hash(const pagmo::vector_double &x)
+{
+    std::uint64_t h = 14695981039346656037ull;
+    for (const auto &xi : x) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &xi, sizeof(bits));
+        for (auto i = 0u; i < 8u; ++i) {
+            h ^= (bits >> (8u * i)) & 0xffu;
+            h *= 1099511628211ull;
+        }
+    }
+    return static_cast<std::size_t>(h);
+}
+
+// Exact (bitwise) comparison of two decision vectors, consistent with dv_hash().
+inline bool dv_equal(const pagmo::vector_double &a, const pagmo::vector_double &b)
+{
+    return a.size() == b.size()
+           && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(double)) == 0);
+}
+
+// Bounded least-recently-used cache of the values of type T computed at given decision vectors.
+//
+// The entries are looked up via the hash of the decision vector, and the match is then verified exactly, so that
+// a hash collision can never return a wrong value. When full, the least recently used entry is evicted. A capacity of
+// zero disables the cache (nothing is stored). The hits counter records the lookups served by the cache, the
+// misses counter the values that had to be computed (i.e., the calls to the UDP).
+template <typename T>
+class eval_cache
+{
+    struct entry {
+        pagmo::vector_double m_x;
+        std::size_t m_hash;
+        T m_value;
+    };
+    using list_type = std::list<entry>;
+
+public:
+    explicit eval_cache(std::size_t capacity) : m_capacity(capacity) {}
+    // Returns the value computed at x, calling f(x) only if it is not cached.
+    template <typename F>
+    const T &get(const pagmo::vector_double &x, F &&f)
+    {
+        const auto h = dv_hash(x);
+        if (auto ptr = find(x, h)) {
+            return *ptr;
+        }
+        return insert(x, h, f(x));
+    }
+    // Checks if a value computed at x is cached (without touching the counters and the LRU order).
+    bool contains(const pagmo::vector_double &x) const
+    {
+        const auto h = dv_hash(x);
+        auto range = m_index.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (dv_equal(it->second->m_x, x)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // Stores the value computed at x (which must not be already cached) outside get(), and returns a reference to it.
+    const T &insert(const pagmo::vector_double &x, T value)
+    {
+        return insert(x, dv_hash(x), std::move(value));
+    }
+    unsigned long long hits() const
+    {
+        return m_hits;
+    }
+    unsigned long long misses() const
+    {
+        return m_misses;
+    }
+    std::size_t size() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    const T *find(const pagmo::vector_double &x, std::size_t h)
+    {
+        auto range = m_index.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (dv_equal(it->second->m_x, x)) {
+                ++m_hits;
+                // Move the entry to the front (most recently used).
+                m_entries.splice(m_entries.begin(), m_entries, it->second);
+                return &it->second->m_value;
+            }
+        }
+        return nullptr;
+    }
+    const T &insert(const pagmo::vector_double &x, std::size_t h, T value)
+    {
+        ++m_misses;
+        if (m_capacity == 0u) {
+            // Nothing is stored, we keep the last value around only to be able to return a reference to it.
+            m_uncached = std::move(value);
+            return m_uncached;
+        }
+        if (m_entries.size() == m_capacity) {
+            // Evict the least recently used entry.
+            auto last = std::prev(m_entries.end());
+            auto range = m_index.equal_range(last->m_hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == last) {
+                    m_index.erase(it);
+                    break;
+                }
+            }
+            m_entries.erase(last);
+        }
+        m_entries.push_front(entry{x, h, std::move(value)});
+        m_index.emplace(h, m_entries.begin());
+        return m_entries.front().m_value;
+    }
+
+    std::size_t m_capacity;
+    list_type m_entries;
+    std::unordered_multimap<std::size_t, typename list_type::iterator> m_index;
+    T m_uncached{};
+    unsigned long long m_hits = 0u;
+    unsigned long long m_misses = 0u;
+};
+
+// The fitness, gradient and hessians caches used by the solver plugins during an evolve() call.
+struct evaluation_cache {
+    explicit evaluation_cache(std::size_t capacity) : m_f(capacity), m_g(capacity), m_h(capacity) {}
+    // The hits/misses counters, in the format returned by the get_cache_stats() methods of the plugins.
+    std::map<std::string, unsigned long long> stats() const
+    {
+        return {{"fitness_hits", m_f.hits()},     {"fitness_misses", m_f.misses()},
+                {"gradient_hits", m_g.hits()},    {"gradient_misses", m_g.misses()},
+                {"hessians_hits", m_h.hits()},    {"hessians_misses", m_h.misses()}};
+    }
+    eval_cache<pagmo::vector_double> m_f;
+    eval_cache<pagmo::vector_double> m_g;
+    eval_cache<std::vector<pagmo::vector_double>> m_h;
+};
+
+} // namespace detail
+} // namespace ppnf
+
+#endif
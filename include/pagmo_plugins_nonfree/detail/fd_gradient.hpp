@@ -0,0 +1,149 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_FD_GRADIENT_HPP
+#define PPNF_DETAIL_FD_GRADIENT_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <pagmo/bfe.hpp>
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/parallel_for.hpp>
+#include <pagmo_plugins_nonfree/detail/visibility.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+// Curtis-Powell-Reid coloring of the columns of a sparse Jacobian: two columns get the same color only if they
+// have no nonzero in a common row, so that all the columns of a color can be estimated with a single perturbed
+// evaluation. Returns the color of each of the nx columns (the colors are numbered from zero and the number of
+// colors is thus the maximum plus one). The best among the greedy colorings in the natural, largest-first and
+// incidence degree orderings of the columns is returned.
+PPNF_DLL_PUBLIC std::vector<pagmo::vector_double::size_type> cpr_coloring(const pagmo::sparsity_pattern &,
+                                                                         pagmo::vector_double::size_type nx);
+// As cpr_coloring(), but the colorings of the most recently used patterns are cached (process-wide), so that
+// the coloring is computed only once per problem structure.
+PPNF_DLL_PUBLIC std::shared_ptr<const std::vector<pagmo::vector_double::size_type>>
+cached_cpr_coloring(const pagmo::sparsity_pattern &, pagmo::vector_double::size_type nx);
+
+// Forward finite-difference gradient computed by the plugins, for problems not providing the gradient.
+//
+// The perturbed points of all the colors of the gradient sparsity are evaluated in a single batch via a
+// pagmo::bfe, so that they can be computed in parallel. The returned gradient follows the sparsity pattern,
+// as the one returned by pagmo::problem::gradient().
+class PPNF_DLL_PUBLIC fd_gradient
+{
+public:
+    fd_gradient(const pagmo::problem &, pagmo::sparsity_pattern, pagmo::bfe);
+    // Gradient at x, given the fitness f at x.
+    pagmo::vector_double operator()(const pagmo::problem &, const pagmo::vector_double &x,
+                                    const pagmo::vector_double &f) const;
+    pagmo::vector_double::size_type get_ncolors() const
+    {
+        return m_ncolors;
+    }
+
+private:
+    pagmo::sparsity_pattern m_sp;
+    std::shared_ptr<const std::vector<pagmo::vector_double::size_type>> m_colors;
+    pagmo::vector_double::size_type m_ncolors = 0u;
+    pagmo::vector_double m_lb;
+    pagmo::vector_double m_ub;
+    pagmo::bfe m_bfe;
+};
+
+// Finite-difference hessians computed by the plugins, for problems providing the gradient but not the hessians.
+//
+// The hessians of all the fitness components are estimated together, differencing the gradient along the
+// directions given by a Curtis-Powell-Reid coloring of the (symmetrised) union of the hessians sparsity patterns.
+// The perturbed gradients are evaluated concurrently, on copies of the problem if its thread safety is only basic
+// (and serially if it is none), by a pool of threads started at construction. The copies are made at construction
+// too, so that the call operator does not modify the object, but calls must not be made concurrently, as they share
+// the pool. The returned hessians follow the sparsity patterns, as the ones returned by pagmo::problem::hessians().
+// The gradient evaluations made by the copies are not counted by the problem (see get_copies_gevals()).
+class PPNF_DLL_PUBLIC fd_hessians
+{
+public:
+    explicit fd_hessians(const pagmo::problem &, std::size_t nthreads = default_nthreads());
+    // Hessians at x, given the gradient g at x.
+    std::vector<pagmo::vector_double> operator()(const pagmo::problem &, const pagmo::vector_double &x,
+                                                 const pagmo::vector_double &g) const;
+    pagmo::vector_double::size_type get_ncolors() const
+    {
+        return m_ncolors;
+    }
+    // The number of gradient evaluations made by the copies of the problem.
+    unsigned long long get_copies_gevals() const;
+
+private:
+    // Position, in the gradient, of the derivative of a fitness component with respect to a variable (npos if
+    // not in the gradient sparsity).
+    static constexpr pagmo::vector_double::size_type npos = static_cast<pagmo::vector_double::size_type>(-1);
+    // For each nonzero of each hessian, the variables (i, j) and the positions, in the gradient, of the derivatives
+    // of its fitness component with respect to x_i and x_j.
+    struct entry {
+        pagmo::vector_double::size_type m_i, m_j, m_gi, m_gj;
+    };
+    std::vector<std::vector<entry>> m_entries;
+    std::shared_ptr<const std::vector<pagmo::vector_double::size_type>> m_colors;
+    pagmo::vector_double::size_type m_ncolors = 0u;
+    pagmo::vector_double m_lb;
+    pagmo::vector_double m_ub;
+    // Copies of the problem used by the threads other than the calling one (if the problem is not thread safe),
+    // and the number of gradient evaluations of the problem when they were made.
+    std::vector<pagmo::problem> m_copies;
+    unsigned long long m_gevals0 = 0u;
+    std::unique_ptr<thread_pool> m_pool;
+};
+} // namespace detail
+} // namespace ppnf
+
+#endif
@@ -0,0 +1,112 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_HM_STRUCTURE_HPP
+#define PPNF_DETAIL_HM_STRUCTURE_HPP
+
+#include <memory>
+#include <vector>
+
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/parallel_for.hpp>
+#include <pagmo_plugins_nonfree/detail/visibility.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+// The structure of the hessian of the lagrangian in the WORHP representation, i.e., the lower triangular
+// off-diagonal nonzeros sorted by column and then by row, followed by the full diagonal.
+struct hm_structure {
+    // The union of the hessians sparsity patterns, sorted.
+    pagmo::sparsity_pattern m_merged;
+    // The index in m_merged of each off-diagonal nonzero, in the WORHP order.
+    std::vector<pagmo::vector_double::size_type> m_idx_map;
+    // The scatter plan: the k-th element is the position in HM.val of the k-th nonzero of the pagmo hessians,
+    // counted across the objective and all the constraints in order.
+    std::vector<pagmo::vector_double::size_type> m_plan;
+};
+
+// Builds the structure of the hessian of the lagrangian of a problem with dim variables from its hessians sparsity
+// patterns hs (which need not be sorted).
+PPNF_DLL_PUBLIC hm_structure build_hm_structure(const std::vector<pagmo::sparsity_pattern> &hs,
+                                                pagmo::vector_double::size_type dim);
+// As build_hm_structure(), but the structures of the most recently used patterns are cached (process-wide), so that
+// repeated calls to evolve() on the same problem do not rebuild them.
+PPNF_DLL_PUBLIC std::shared_ptr<const hm_structure> cached_hm_structure(const std::vector<pagmo::sparsity_pattern> &hs,
+                                                                        pagmo::vector_double::size_type dim);
+// Assembles the hessian of the lagrangian, i.e., the sum of the hessians h weighted by w0 (the objective) and by
+// the multipliers mu (the constraints), into the nnz elements of val via the scatter plan.
+PPNF_DLL_PUBLIC void hm_scatter(const std::vector<pagmo::vector_double::size_type> &plan,
+                                const std::vector<pagmo::vector_double> &h, double w0, const double *mu, double *val,
+                                pagmo::vector_double::size_type nnz);
+
+// The gather plan used to assemble the hessian of the lagrangian in parallel (see worhp::set_hm_threads()): the
+// terms contributing to each element of HM.val are listed contiguously, in the same (objective first, then
+// constraints) order as in the scatter plan, and the elements of HM.val are partitioned among the threads in
+// contiguous chunks having about the same number of terms. Each element is thus summed by a single thread in a
+// fixed order, and the result does not depend on the number of threads. The threads are kept in a pool, started
+// once at construction and reused at each assembly.
+struct PPNF_DLL_PUBLIC hm_gather {
+    hm_gather(const std::vector<pagmo::vector_double::size_type> &plan, const std::vector<pagmo::sparsity_pattern> &hs,
+              pagmo::vector_double::size_type nslots, pagmo::vector_double::size_type nthreads);
+    // As hm_scatter(), with val having nslots elements.
+    void operator()(const std::vector<pagmo::vector_double> &h, double w0, const double *mu, double *val) const;
+    // The terms of the i-th element of HM.val are those in [m_ptr[i], m_ptr[i + 1]).
+    std::vector<pagmo::vector_double::size_type> m_ptr;
+    // The index of the hessian and of the nonzero within it of each term.
+    std::vector<pagmo::vector_double::size_type> m_h;
+    std::vector<pagmo::vector_double::size_type> m_nz;
+    // The chunks of HM.val: [m_bounds[t], m_bounds[t + 1]).
+    std::vector<pagmo::vector_double::size_type> m_bounds;
+    // One thread per chunk.
+    std::unique_ptr<thread_pool> m_pool;
+};
+} // namespace detail
+} // namespace ppnf
+
+#endif
@@ -0,0 +1,132 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_LIBRARY_REGISTRY_HPP
+#define PPNF_DETAIL_LIBRARY_REGISTRY_HPP
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ppnf
+{
+namespace detail
+{
+// Process-wide registry of the solver libraries loaded at run-time.
+//
+// The solver libraries (and the symbols they export) are loaded and resolved only once per
+// (library path, API version) key. Afterwards, the resulting symbol table is immutable and shared by all
+// the evolve() calls of all the UDA instances in the process. A lookup of an already loaded library
+// does not take any lock: the entries are stored in an immutable snapshot of the registry, which is
+// atomically replaced (copy on write) each time a new library is loaded. The old snapshots are kept
+// alive until the end of the program, as concurrent readers might still be accessing them. As the number
+// of distinct libraries loaded by a process is tiny, this is not a concern.
+//
+// The Symbols type must be constructible from the loader functor passed to get(), which is
+// invoked only on a cache miss (and under the registry lock). If the loader throws, nothing is
+// stored and the exception is propagated to the caller, so that a later call will try again.
+template <typename Symbols>
+class library_registry
+{
+public:
+    using key_type = std::pair<std::string, unsigned>;
+    template <typename Loader>
+    static const Symbols &get(const std::string &path, unsigned api_version, Loader &&loader)
+    {
+        const key_type key(path, api_version);
+        // Fast path: lock-free lookup in the current snapshot.
+        if (const auto ptr = find(s_snapshot.load(std::memory_order_acquire), key)) {
+            return *ptr;
+        }
+        // Slow path: we load the library under the lock.
+        std::lock_guard<std::mutex> lock(s_mutex);
+        // Another thread might have loaded the same library in the meantime.
+        if (const auto ptr = find(s_snapshot.load(std::memory_order_relaxed), key)) {
+            return *ptr;
+        }
+        std::shared_ptr<const Symbols> symbols(loader());
+        auto new_snapshot = s_snapshots.empty() ? std::make_unique<map_type>()
+                                                : std::make_unique<map_type>(*s_snapshots.back());
+        new_snapshot->emplace(key, std::move(symbols));
+        s_snapshots.push_back(std::move(new_snapshot));
+        s_snapshot.store(s_snapshots.back().get(), std::memory_order_release);
+        return *s_snapshots.back()->at(key);
+    }
+
+private:
+    using map_type = std::map<key_type, std::shared_ptr<const Symbols>>;
+    static const Symbols *find(const map_type *snapshot, const key_type &key)
+    {
+        if (snapshot) {
+            const auto it = snapshot->find(key);
+            if (it != snapshot->end()) {
+                return it->second.get();
+            }
+        }
+        return nullptr;
+    }
+    static std::atomic<const map_type *> s_snapshot;
+    static std::mutex s_mutex;
+    static std::vector<std::unique_ptr<const map_type>> s_snapshots;
+};
+
+template <typename Symbols>
+std::atomic<const typename library_registry<Symbols>::map_type *> library_registry<Symbols>::s_snapshot{nullptr};
+
+template <typename Symbols>
+std::mutex library_registry<Symbols>::s_mutex;
+
+template <typename Symbols>
+std::vector<std::unique_ptr<const typename library_registry<Symbols>::map_type>> library_registry<Symbols>::s_snapshots;
+
+} // namespace detail
+} // namespace ppnf
+
+#endif
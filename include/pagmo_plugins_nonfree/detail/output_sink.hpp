@@ -0,0 +1,199 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_OUTPUT_SINK_HPP
+#define PPNF_DETAIL_OUTPUT_SINK_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <pagmo/exceptions.hpp>
+#include <pagmo/io.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+// The output modes of the plugins (see snopt7::set_output_mode()).
+enum class output_mode { sync, async, null };
+
+inline output_mode output_mode_from_string(const std::string &mode)
+{
+    if (mode == "sync") {
+        return output_mode::sync;
+    }
+    if (mode == "async") {
+        return output_mode::async;
+    }
+    if (mode != "null") {
+        pagmo_throw(std::invalid_argument,
+                    "The output mode must be one of 'sync', 'async' and 'null', while '" + mode + "' was provided");
+    }
+    return output_mode::null;
+}
+
+inline std::string output_mode_to_string(output_mode mode)
+{
+    if (mode == output_mode::sync) {
+        return "sync";
+    }
+    return mode == output_mode::async ? "async" : "null";
+}
+
+// The destination of the screen output produced during an optimisation. The arguments of print() are streamed to
+// std::cout as by pagmo::print():
+// - immediately, in the sync mode,
+// - by a writer thread, in the async mode: print() only copies its arguments into a queue, and the writer formats
+//   the queued lines and writes them in batches, one write and flush per batch,
+// - never, in the null mode.
+// The writer thread is started on the first print() and stopped by flush(), which writes all the lines queued: it must
+// be called before any output that has to follow them. The destructor calls flush().
+class output_sink
+{
+public:
+    explicit output_sink(output_mode mode) : m_mode(mode) {}
+    output_sink(const output_sink &) = delete;
+    output_sink &operator=(const output_sink &) = delete;
+    ~output_sink()
+    {
+        flush();
+    }
+    output_mode mode() const
+    {
+        return m_mode;
+    }
+    template <typename... Args>
+    void print(const Args &...args)
+    {
+        if (m_mode == output_mode::sync) {
+            pagmo::print(args...);
+        } else if (m_mode == output_mode::async) {
+            // The arguments are copied and formatted later on. NOTE: character arrays decay to pointers, hence they
+            // must be string literals (or outlive the next flush()).
+            enqueue([t = std::make_tuple(args...)](std::ostream &os) {
+                std::apply([&os](const auto &...a) { pagmo::stream(os, a...); }, t);
+            });
+        }
+    }
+    // Writes the lines queued and stops the writer thread, if running.
+    void flush()
+    {
+        if (!m_writer.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_writer.join();
+        m_stop = false;
+    }
+
+private:
+    using line_type = std::function<void(std::ostream &)>;
+    void enqueue(line_type &&line)
+    {
+        if (!m_writer.joinable()) {
+            m_writer = std::thread([this]() { write_loop(); });
+        }
+        bool was_empty;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            was_empty = m_queue.empty();
+            m_queue.push_back(std::move(line));
+        }
+        // The writer waits only when the queue is empty.
+        if (was_empty) {
+            m_cv.notify_one();
+        }
+    }
+    void write_loop()
+    {
+        std::vector<line_type> batch;
+        std::ostringstream oss;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            batch.swap(m_queue);
+            lock.unlock();
+            // The screen output is best effort: errors writing it do not interrupt the optimisation.
+            try {
+                for (const auto &line : batch) {
+                    line(oss);
+                }
+                std::cout << oss.str() << std::flush;
+            } catch (...) {
+            }
+            batch.clear();
+            oss.str("");
+            lock.lock();
+        }
+    }
+
+    const output_mode m_mode;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<line_type> m_queue;
+    bool m_stop = false;
+    std::thread m_writer;
+};
+} // namespace detail
+} // namespace ppnf
+
+#endif
@@ -0,0 +1,194 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_PARALLEL_FOR_HPP
+#define PPNF_DETAIL_PARALLEL_FOR_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ppnf
+{
+namespace detail
+{
+// The number of threads used by default by the thread pools.
+inline std::size_t default_nthreads()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// A pool of persistent threads, running loops together with the calling thread. Unlike starting and joining new
+// threads for each loop, the nthreads - 1 worker threads are started once, in the constructor, and joined in the
+// destructor, so that the pool can be reused cheaply for many short loops. The loops must not be run concurrently
+// on the same pool.
+class thread_pool
+{
+public:
+    explicit thread_pool(std::size_t nthreads)
+    {
+        try {
+            for (std::size_t t = 1u; t < nthreads; ++t) {
+                m_workers.emplace_back([this, t]() { worker(t); });
+            }
+        } catch (...) {
+            // A thread could not be started: the ones already running are joined before propagating the error.
+            stop();
+            throw;
+        }
+    }
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+    ~thread_pool()
+    {
+        stop();
+    }
+    // The number of threads, including the calling one.
+    std::size_t size() const
+    {
+        return m_workers.size() + 1u;
+    }
+    // Calls f(t, i) for each i in [0, n), distributing the calls among (at most) size() threads, where t in
+    // [0, size()) identifies the calling thread (t == 0 being the calling one). The i are assigned to the threads
+    // in a fixed round-robin order, so that which thread evaluates what does not depend on the scheduling. If any
+    // call throws, the first exception (in the order of the threads) is rethrown once all the threads are done.
+    template <typename F>
+    void run(std::size_t n, const F &f)
+    {
+        const auto nthreads = std::min(size(), n);
+        if (nthreads <= 1u) {
+            for (std::size_t i = 0u; i < n; ++i) {
+                f(std::size_t(0), i);
+            }
+            return;
+        }
+        std::vector<std::exception_ptr> eptrs(nthreads);
+        const std::function<void(std::size_t)> work = [n, nthreads, &f, &eptrs](std::size_t t) {
+            if (t >= nthreads) {
+                return;
+            }
+            try {
+                for (auto i = t; i < n; i += nthreads) {
+                    f(t, i);
+                }
+            } catch (...) {
+                eptrs[t] = std::current_exception();
+            }
+        };
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &work;
+            m_pending = m_workers.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+        work(0u);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_pending == 0u; });
+            m_task = nullptr;
+        }
+        for (const auto &eptr : eptrs) {
+            if (eptr) {
+                std::rethrow_exception(eptr);
+            }
+        }
+    }
+
+private:
+    void worker(std::size_t t)
+    {
+        unsigned long long generation = 0u;
+        while (true) {
+            const std::function<void(std::size_t)> *task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+                if (m_stop) {
+                    return;
+                }
+                generation = m_generation;
+                task = m_task;
+            }
+            (*task)(t);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_pending;
+            }
+            m_done.notify_one();
+        }
+    }
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_start.notify_all();
+        for (auto &th : m_workers) {
+            th.join();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    // The loop being run, the number of workers still running it and the number of loops started so far.
+    const std::function<void(std::size_t)> *m_task = nullptr;
+    std::size_t m_pending = 0u;
+    unsigned long long m_generation = 0u;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+};
+} // namespace detail
+} // namespace ppnf
+
+#endif
@@ -0,0 +1,119 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_SPARSITY_DETECTION_HPP
+#define PPNF_DETAIL_SPARSITY_DETECTION_HPP
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <pagmo/bfe.hpp>
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/visibility.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+// Detects the gradient sparsity of a problem not providing it, probing the problem at a few random points near x0,
+// taken in neighbourhoods of increasing radius (up to the magnitude of the variables, within the bounds), so that the
+// dependencies vanishing near x0 are likely to be found too. If the problem provides the gradient, the nonzeros of
+// the (dense) gradient at the probe points are collected.
+// Otherwise, each variable is perturbed in turn and the fitness components that change are recorded, evaluating the
+// perturbed points in batches via the bfe b. The union over the probe points is then validated at a further random
+// point: if a nonzero not in the union is found there, the detection is deemed unreliable and the dense pattern is
+// returned. Variables with equal bounds cannot be perturbed, and are conservatively assumed to affect all the fitness
+// components. As probing cannot guarantee that the pattern is complete, the solvers must verify, when the problem
+// provides the gradient, that the elements of the gradient outside the pattern are zero during the run (see
+// dropped_gradient_positions() and discard_gradient_sparsity()).
+PPNF_DLL_PUBLIC pagmo::sparsity_pattern detect_gradient_sparsity(const pagmo::problem &, const pagmo::vector_double &x0,
+                                                                 const pagmo::bfe &b);
+// As detect_gradient_sparsity(), but the patterns detected for the most recently used problems (identified by their
+// name, dimensions, bounds and whether they provide the gradient) are cached (process-wide), so that the full
+// detection runs only once per problem. As the identification is not unique (e.g., for parametrised problems), a
+// cached pattern is validated, and detected again if a nonzero outside it is found. If the problem provides the
+// gradient, the validation is left to the solvers, which verify the pattern during the runs. Otherwise, the problem
+// is probed at a further random point near x0, perturbing only a few variables (cycling through all of them across
+// the calls), which costs at most 9 fitness evaluations.
+PPNF_DLL_PUBLIC std::shared_ptr<const pagmo::sparsity_pattern>
+cached_gradient_sparsity(const pagmo::problem &, const pagmo::vector_double &x0, const pagmo::bfe &b);
+// Records in the cache of cached_gradient_sparsity() that the gradient of the problem is dense, after a nonzero
+// outside the detected pattern was found during a run.
+PPNF_DLL_PUBLIC void discard_gradient_sparsity(const pagmo::problem &);
+// The positions, in the dense gradient of a problem with nf fitness components and nx variables, of the elements
+// not in sp, which are to be verified to be zero.
+PPNF_DLL_PUBLIC std::vector<pagmo::vector_double::size_type>
+dropped_gradient_positions(const pagmo::sparsity_pattern &sp, pagmo::vector_double::size_type nf,
+                           pagmo::vector_double::size_type nx);
+// The position, in the dense gradient of a problem with nx variables (i.e., in the gradient returned by
+// pagmo::problem::gradient() when the problem does not provide the gradient sparsity), of each nonzero of sp.
+PPNF_DLL_PUBLIC std::vector<pagmo::vector_double::size_type> dense_gradient_positions(const pagmo::sparsity_pattern &sp,
+                                                                                     pagmo::vector_double::size_type nx);
+// Detects the elements of the gradient of a problem providing it that are constant, evaluating the gradient at x0 and
+// at a few random points near x0. The candidates are the elements of sp, pos being the position of each of them in
+// the gradient returned by the problem. An element is deemed constant if its value is the same (bitwise) at all the
+// points. The constant elements and their values are returned sorted, in the same format of linear_jacobian(): as
+// constancy at a few points does not guarantee constancy everywhere, the solvers must verify them during the run.
+PPNF_DLL_PUBLIC std::pair<pagmo::sparsity_pattern, pagmo::vector_double>
+detect_constant_jacobian(const pagmo::problem &, const pagmo::vector_double &x0, const pagmo::sparsity_pattern &sp,
+                         const std::vector<pagmo::vector_double::size_type> &pos);
+// As detect_constant_jacobian(), but the elements detected for the most recently used problems (identified by their
+// name, dimensions and bounds) are cached (process-wide), so that the full detection runs only once per problem. As
+// the identification is not unique, the cached elements are validated evaluating the gradient at x0, and detected
+// again if any of them is not among the candidates or has a different value.
+PPNF_DLL_PUBLIC std::shared_ptr<const std::pair<pagmo::sparsity_pattern, pagmo::vector_double>>
+cached_constant_jacobian(const pagmo::problem &, const pagmo::vector_double &x0, const pagmo::sparsity_pattern &sp,
+                         const std::vector<pagmo::vector_double::size_type> &pos);
+// Records in the cache of cached_constant_jacobian() that the problem has no constant elements, after the ones
+// detected were found not to be constant during a run.
+PPNF_DLL_PUBLIC void discard_constant_jacobian(const pagmo::problem &);
+} // namespace detail
+} // namespace ppnf
+
+#endif
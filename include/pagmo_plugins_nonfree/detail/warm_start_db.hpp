@@ -0,0 +1,185 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_DETAIL_WARM_START_DB_HPP
+#define PPNF_DETAIL_WARM_START_DB_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <pagmo/s11n.hpp>
+#include <pagmo/types.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+// The scale of each variable in the nearest-neighbour lookups of warm_start_db: the width of its bounds, if finite and
+// nonzero, or 1 otherwise.
+inline pagmo::vector_double warm_start_scale(const pagmo::vector_double &lb, const pagmo::vector_double &ub)
+{
+    pagmo::vector_double retval(lb.size(), 1.);
+    for (decltype(lb.size()) i = 0u; i < lb.size(); ++i) {
+        const auto w = ub[i] - lb[i];
+        if (std::isfinite(w) && w > 0.) {
+            retval[i] = w;
+        }
+    }
+    return retval;
+}
+
+// Bounded store of the warm start data (of type T) of solved problems, indexed by the final decision vector and
+// grouped per problem fingerprint (name, number of variables and of fitness components). When full, the oldest entry
+// is evicted. A capacity of zero disables the store (nothing is stored). The lookups return the data stored at the
+// decision vector nearest to the given one for the same problem, each variable being scaled by a per-problem factor
+// (see warm_start_scale()). As the store is meant to be small, the lookups scan all the entries of the problem.
+template <typename T>
+class warm_start_db
+{
+public:
+    using key_type = std::tuple<std::string, pagmo::vector_double::size_type, pagmo::vector_double::size_type>;
+
+    std::size_t capacity() const
+    {
+        return m_capacity;
+    }
+    // Sets the capacity, evicting the oldest entries if needed.
+    void set_capacity(std::size_t capacity)
+    {
+        m_capacity = capacity;
+        while (m_size > m_capacity) {
+            evict();
+        }
+    }
+    std::size_t size() const
+    {
+        return m_size;
+    }
+    void clear()
+    {
+        m_entries.clear();
+        m_size = 0u;
+    }
+    // Stores the data obtained at the decision vector x for the problem identified by key.
+    void insert(const key_type &key, const pagmo::vector_double &x, T data)
+    {
+        if (m_capacity == 0u) {
+            return;
+        }
+        if (m_size == m_capacity) {
+            evict();
+        }
+        m_entries[key].emplace_back(m_stamp++, x, std::move(data));
+        ++m_size;
+    }
+    // The data stored at the decision vector nearest to x for the problem identified by key (nullptr if none).
+    // In case of ties, the oldest entry is selected.
+    const T *nearest(const key_type &key, const pagmo::vector_double &x, const pagmo::vector_double &scale) const
+    {
+        const auto it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            return nullptr;
+        }
+        const T *retval = nullptr;
+        double best_d2 = 0.;
+        for (const auto &e : it->second) {
+            const auto d2 = scaled_dist2(std::get<1>(e), x, scale);
+            if (!retval || d2 < best_d2) {
+                retval = &std::get<2>(e);
+                best_d2 = d2;
+            }
+        }
+        return retval;
+    }
+    template <typename Archive>
+    void serialize(Archive &ar, unsigned)
+    {
+        pagmo::detail::archive(ar, m_capacity, m_stamp, m_size, m_entries);
+    }
+
+private:
+    // The squared Euclidean distance between x and y, each variable being divided by its scale.
+    static double scaled_dist2(const pagmo::vector_double &x, const pagmo::vector_double &y,
+                               const pagmo::vector_double &scale)
+    {
+        double retval = 0.;
+        for (decltype(x.size()) i = 0u; i < x.size() && i < y.size(); ++i) {
+            const auto diff = (x[i] - y[i]) / (i < scale.size() ? scale[i] : 1.);
+            retval += diff * diff;
+        }
+        return retval;
+    }
+    // Evicts the oldest entry (the entries of each problem are stored in insertion order).
+    void evict()
+    {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (std::get<0>(it->second.front()) < std::get<0>(oldest->second.front())) {
+                oldest = it;
+            }
+        }
+        oldest->second.erase(oldest->second.begin());
+        if (oldest->second.empty()) {
+            m_entries.erase(oldest);
+        }
+        --m_size;
+    }
+
+    std::size_t m_capacity = 0u;
+    unsigned long long m_stamp = 0u;
+    std::size_t m_size = 0u;
+    // For each problem, the insertion stamp, the decision vector and the data of each entry, in insertion order.
+    std::map<key_type, std::vector<std::tuple<unsigned long long, pagmo::vector_double, T>>> m_entries;
+};
+} // namespace detail
+} // namespace ppnf
+
+#endif
@@ -49,6 +49,7 @@ see https://www.gnu.org/licenses/. */
 
 #include <pagmo_plugins_nonfree/config.hpp>
 #include <pagmo_plugins_nonfree/snopt7.hpp>
+#include <pagmo_plugins_nonfree/udp_extensions.hpp>
 #include <pagmo_plugins_nonfree/worhp.hpp>
 
 #endif
\ No newline at end of file
@@ -47,18 +47,28 @@ see https://www.gnu.org/licenses/. */
 #ifndef PAGMO_SNOPT7_HPP
 #define PAGMO_SNOPT7_HPP
 
+#include <boost/optional.hpp>
 #include <boost/type_traits/is_object.hpp>
 #include <limits> // std::numeric_limits
 #include <map>
+#include <memory>
 #include <mutex>
 #include <pagmo/algorithm.hpp>
 #include <pagmo/algorithms/not_population_based.hpp>
+#include <pagmo/bfe.hpp>
 #include <pagmo/population.hpp>
 #include <pagmo/s11n.hpp>
+// NOTE: after pagmo/s11n.hpp, which includes the boost archives.
+#include <boost/serialization/optional.hpp>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#include <pagmo_plugins_nonfree/detail/columnar_log.hpp>
+#include <pagmo_plugins_nonfree/detail/output_sink.hpp>
 #include <pagmo_plugins_nonfree/detail/visibility.hpp>
+#include <pagmo_plugins_nonfree/detail/warm_start_db.hpp>
+#include <pagmo_plugins_nonfree/udp_extensions.hpp>
 extern "C" {
 #include "bogus_libs/snopt7_c_lib/snopt7_c.h"
 }
@@ -84,20 +94,60 @@ namespace ppnf
 {
 namespace detail
 {
+// The fitness and gradient caches used during an evolve() call.
+struct evaluation_cache;
+// The finite-difference gradient computed by the plugin (see snopt7::set_bfe()).
+class fd_gradient;
+// The early termination criteria checked at each major iteration (see snopt7::set_stop_criterion()).
+struct stop_data;
+
 // Encapsulating struct for data that are used in the fitness wrapper.
 struct user_data {
     // Single entry of the log (objevals, objval, n of unsatisfied const, constr. violation, feasibility).
     using log_line_type = std::tuple<unsigned long, double, pagmo::vector_double::size_type, double, bool>;
-    // The log.
-    using log_type = std::vector<log_line_type>;
+    // The log, stored column by column (see snopt7::set_log_capacity()).
+    using log_type = columnar_log<unsigned long, double, pagmo::vector_double::size_type, double, bool>;
+    // Single entry of the major iterations log (major iteration, merit function, step length, primal infeasibility,
+    // dual infeasibility, n of superbasics).
+    using major_log_line_type = std::tuple<int, double, double, double, double, int>;
+    // The major iterations log.
+    using major_log_type = std::vector<major_log_line_type>;
     // The problem stored in the evolve() population
     pagmo::problem m_prob;
     // A preallocated decision vector
     pagmo::vector_double m_dv;
-    // The verbosity
+    // The fitness_and_gradient() of the UDP, if registered (see ppnf::has_fitness_and_gradient)
+    fitness_and_gradient_ptr m_fitness_and_gradient = nullptr;
+    // The fitness and gradient caches
+    evaluation_cache *m_cache = nullptr;
+    // The finite-difference gradient, if computed by the plugin
+    const fd_gradient *m_fd_gradient = nullptr;
+    // The size of the gradient computed by the problem and, if the gradient sparsity was detected by the plugin,
+    // the position in it of each element of G (see snopt7::set_sparsity_detection())
+    pagmo::vector_double::size_type m_grad_size = 0u;
+    const std::vector<pagmo::vector_double::size_type> *m_grad_idx = nullptr;
+    // If the gradient sparsity was detected by the plugin and the problem provides the gradient, the position in
+    // it of the elements outside the detected pattern, and whether one of them was found to be nonzero
+    const std::vector<pagmo::vector_double::size_type> *m_dropped_pos = nullptr;
+    bool m_sparsity_mismatch = false;
+    // The linear part of the problem (see ppnf::register_linear_jacobian()), if any, which is subtracted from the
+    // fitness to obtain F
+    const pagmo::sparsity_pattern *m_linear_sp = nullptr;
+    const pagmo::vector_double *m_linear_vals = nullptr;
+    // If the linear part was detected by the plugin (see snopt7::set_constant_jacobian_detection()), the position of
+    // each of its elements in the gradient computed by the problem, and whether one of them was found to change
+    const std::vector<pagmo::vector_double::size_type> *m_linear_pos = nullptr;
+    bool m_linear_mismatch = false;
+    // The early termination criteria, if any
+    stop_data *m_stop = nullptr;
+    // The verbosity, and the destination of the screen output
     unsigned m_verbosity;
+    output_sink *m_sink = nullptr;
     // The log
     log_type m_log;
+    // The major iterations log mode (see snopt7::set_log_mode()) and the major iterations log
+    bool m_log_majors = false;
+    major_log_type m_major_log;
     // A counter
     unsigned long m_objfun_counter = 0;
     // This exception pointer will be null, unless
@@ -116,7 +166,48 @@ extern "C" {
 inline void snopt_fitness_wrapper(int *Status, int *n, double x[], int *needF, int *nF, double F[], int *needG,
                                   int *neG, double G[], char cu[], int *lencu, int iu[], int *leniu, double ru[],
                                   int *lenru);
+// Wrappers connecting the early termination criteria to the snSTOP hook of the two supported APIs.
+inline void snopt_stop_wrapper_76(int *iAbort, int KTcond[], int *MjrPrt, int *minimz, int *m, int *maxS, int *n,
+                                  int *nb, int *nnCon0, int *nnCon, int *nnObj0, int *nnObj, int *nS, int *itn,
+                                  int *nMajor, int *nMinor, int *nSwap, double *condHz, int *iObj, double *sclObj,
+                                  double *ObjAdd, double *fMrt, double *PenNrm, double *step, double *prInf,
+                                  double *duInf, double *vimax, double *virel, int hs[], int *ne, int *nlocJ,
+                                  int locJ[], int indJ[], double Jcol[], int *negCon, double Ascale[], double bl[],
+                                  double bu[], double fCon[], double gCon[], double gObj[], double yCon[], double pi[],
+                                  double rc[], double rg[], double x[], char cu[], int *lencu, int iu[], int *leniu,
+                                  double ru[], int *lenru, char cw[], int *lencw, int iw[], int *leniw, double rw[],
+                                  int *lenrw);
+inline void snopt_stop_wrapper_77(int *iAbort, int KTcond[], int *MjrPrt, int *minimz, int *m, int *maxS, int *n,
+                                  int *nb, int *nnCon0, int *nnCon, int *nnObj0, int *nnObj, int *nS, int *itn,
+                                  int *nMajor, int *nMinor, int *nSwap, double *condHz, int *iObj, double *sclObj,
+                                  double *ObjAdd, double *fObj, double *fMrt, double *PenNrm, double *step,
+                                  double *prInf, double *duInf, double *vimax, double *virel, int hs[], int *ne,
+                                  int *nlocJ, int locJ[], int indJ[], double Jcol[], int *negCon, double Ascale[],
+                                  double bl[], double bu[], double Fx[], double fCon[], double gCon[], double gObj[],
+                                  double yCon[], double pi[], double rc[], double rg[], double x[], char cu[],
+                                  int *lencu, int iu[], int *leniu, double ru[], int *lenru, char cw[], int *lencw,
+                                  int iw[], int *leniw, double rw[], int *lenrw);
+// Wrappers connecting the major iterations log to the snLog hook of the two supported APIs.
+inline void snopt_log_wrapper_76(int *iAbort, int *info, int *HQNType, int KTcond[], int *MjrPrt, int *minimz, int *n,
+                                 int *nb, int *nnCon0, int *nS, int *itn, int *nMajor, int *nMinor, int *nSwap,
+                                 double *condHz, int *iObj, double *sclObj, double *ObjAdd, double *fMrt,
+                                 double *PenNrm, double *step, double *prInf, double *duInf, double *vimax,
+                                 double *virel, int hs[], int *ne, int nlocJ[], int locJ[], int indJ[], double Jcol[],
+                                 double Ascale[], double bl[], double bu[], double fCon[], double yCon[], double x[],
+                                 char cu[], int *lencu, int iu[], int *leniu, double ru[], int *lenru, char cw[],
+                                 int *lencw, int iw[], int *leniw, double rw[], int *lenrw);
+inline void snopt_log_wrapper_77(int *iAbort, int KTcond[], int *MjrPrt, int *minimz, int *n, int *nb, int *nnCon0,
+                                 int *nnObj, int *nS, int *itn, int *nMajor, int *nMinor, int *nSwap, double *condHz,
+                                 int *iObj, double *sclObj, double *ObjAdd, double *fObj, double *fMrt,
+                                 double *PenNrm, double *step, double *prInf, double *duInf, double *vimax,
+                                 double *virel, int hs[], int *ne, int nlocJ[], int locJ[], int indJ[], double Jcol[],
+                                 double Ascale[], double bl[], double bu[], double Fx[], double fCon[], double yCon[],
+                                 double x[], char cu[], int *lencu, int iu[], int *leniu, double ru[], int *lenru,
+                                 char cw[], int *lencw, int iw[], int *leniw, double rw[], int *lenrw);
 } // extern C
+
+// The persistent SNOPT7 workspace used by snopt7::evolve() (see snopt7::set_persistent_workspace()).
+struct snopt7_workspace;
 } // namespace detail
 
 /// SNOPT 7 - (Sparse Nonlinear OPTimizer, Version 7)
@@ -167,15 +258,22 @@ inline void snopt_fitness_wrapper(int *Status, int *n, double x[], int *needF, i
  *
  *    Constructing this class with an inconsistent \p minor_version parameter results in undefined behaviour.
  *
+ * .. note::
+ *
+ *    The snopt7_c library is loaded, and its symbols resolved, only once per process (for each
+ *    library path and API version). Replacing the library file while the process is running will thus
+ *    have no effect.
+ *
  * .. warning::
  *
  *    A moved-from :cpp:class:`ppnf::snopt7` is destructible and assignable. Any other operation will result
  *    in undefined behaviour.
  *
- * .. warning::
+ * .. note::
  *
- *    The possibility to exploit the linear part of the problem fitness, part of the original SNOPT7 library,
- *    is deactivated in this plugin for pagmo.
+ *    The linear part of the problem fitness can be exploited as in the original SNOPT7 library: a UDP can declare
+ *    the constant elements of its gradient via :c:macro:`PPNF_REGISTER_LINEAR_JACOBIAN`, or the plugin can detect
+ *    them (see :cpp:func:`ppnf::snopt7::set_constant_jacobian_detection()`).
  *
  * .. seealso::
  *
@@ -207,9 +305,50 @@ public:
      * (see snopt7::set_verbosity()).
      */
     using log_type = std::vector<log_line_type>;
+    /// Columnar log type.
+    /**
+     * The algorithm log as it is stored internally, i.e., with one contiguous column per field of
+     * snopt7::log_line_type (the feasibility flags being stored as ``unsigned char``) and a bounded number of
+     * lines (see snopt7::set_log_capacity()).
+     */
+    using columnar_log_type = detail::user_data::log_type;
+    /// Single data line for the algorithm's major iterations log.
+    /**
+     * A major iterations log data line is a tuple consisting of:
+     * - the major iteration number,
+     * - the merit function,
+     * - the step length,
+     * - the primal infeasibility,
+     * - the dual infeasibility,
+     * - the number of superbasic variables,
+     *
+     * as computed by SNOPT7.
+     */
+    using major_log_line_type = std::tuple<int, double, double, double, double, int>;
+    /// Major iterations log type.
+    /**
+     * The major iterations log is a collection of snopt7::major_log_line_type data lines, stored in chronological
+     * order during the optimisation if the log mode is ``"major"`` (see snopt7::set_log_mode()) and the verbosity
+     * of the algorithm is set to a nonzero value (see snopt7::set_verbosity()).
+     */
+    using major_log_type = std::vector<major_log_line_type>;
+    /// Warm start data type.
+    /**
+     * The final state of an optimisation, from which a subsequent one can be warm started
+     * (see snopt7::set_warm_start()). It is a tuple consisting of:
+     * - the name of the problem,
+     * - the final number of superbasic variables (the ``nS`` argument of the snOptA interface),
+     * - the final states and multipliers of the variables (``xstate`` and ``xmul``),
+     * - the final states and multipliers of the fitness components (``Fstate`` and ``Fmul``).
+     */
+    using warm_start_data_type
+        = std::tuple<std::string, int, std::vector<int>, pagmo::vector_double, std::vector<int>, pagmo::vector_double>;
 
 private:
     static_assert(std::is_same<log_line_type, detail::user_data::log_line_type>::value, "Invalid log line type.");
+    static_assert(std::is_same<log_line_type, columnar_log_type::line_type>::value, "Invalid columnar log type.");
+    static_assert(std::is_same<major_log_line_type, detail::user_data::major_log_line_type>::value,
+                  "Invalid major log line type.");
 
 public:
     ///  Constructor.
@@ -231,6 +370,14 @@ public:
     pagmo::population evolve(pagmo::population) const;
     void set_verbosity(unsigned);
     const log_type &get_log() const;
+    const columnar_log_type &get_columnar_log() const;
+    void set_log_capacity(unsigned);
+    unsigned get_log_capacity() const;
+    void set_log_mode(const std::string &);
+    std::string get_log_mode() const;
+    const major_log_type &get_major_log() const;
+    void set_output_mode(const std::string &);
+    std::string get_output_mode() const;
     unsigned int get_verbosity() const;
     std::string get_name() const;
     std::string get_extra_info() const;
@@ -247,7 +394,12 @@ public:
     {
         pagmo::detail::archive(ar, boost::serialization::base_object<not_population_based>(*this), m_snopt7_c_library,
                                m_minor_version, m_integer_opts, m_numeric_opts, m_last_opt_res, m_screen_output,
-                               m_verbosity, m_log);
+                               m_verbosity, m_log, m_persistent_workspace, m_cache_size, m_bfe,
+                               m_sparsity_detection, m_constant_jacobian_detection, m_warm_start, m_warm_start_data,
+                               m_warm_start_db, m_stop_criteria, m_log_majors, m_major_log, m_output_mode);
+        if (Archive::is_loading::value) {
+            reset_workspace();
+        }
     }
     void set_integer_option(const std::string &, int);
     void set_integer_options(const std::map<std::string, int> &);
@@ -258,10 +410,31 @@ public:
     void reset_integer_options();
     void reset_numeric_options();
     int get_last_opt_result() const;
+    void set_persistent_workspace(bool);
+    bool get_persistent_workspace() const;
+    void set_cache_size(unsigned);
+    unsigned get_cache_size() const;
+    std::map<std::string, unsigned long long> get_cache_stats() const;
+    void set_bfe(const pagmo::bfe &);
+    void set_sparsity_detection(bool);
+    bool get_sparsity_detection() const;
+    void set_constant_jacobian_detection(bool);
+    bool get_constant_jacobian_detection() const;
+    void set_warm_start(bool);
+    bool get_warm_start() const;
+    void set_warm_start_data(const warm_start_data_type &);
+    const warm_start_data_type &get_warm_start_data() const;
+    void set_warm_start_db_size(unsigned);
+    unsigned get_warm_start_db_size() const;
+    void set_stop_criterion(const std::string &, double);
+    void set_stop_criteria(const std::map<std::string, double> &);
+    std::map<std::string, double> get_stop_criteria() const;
+    void reset_stop_criteria();
 
 private:
     template <typename snProblem>
     pagmo::population evolve_version(pagmo::population &) const;
+    void reset_workspace();
 
     // The absolute path to the snopt7 lib
     std::string m_snopt7_c_library;
@@ -275,7 +448,38 @@ private:
     // Activates the original snopt screen output
     bool m_screen_output;
     unsigned int m_verbosity;
-    mutable log_type m_log;
+    mutable columnar_log_type m_log;
+    // The log as returned by get_log(), built on demand from the columns of m_log kept alive by m_log_lines_storage
+    // (which are thus never modified in place: see columnar_log).
+    mutable log_type m_log_lines;
+    mutable std::shared_ptr<const void> m_log_lines_storage;
+    // Major iterations log mode, and the major iterations log.
+    bool m_log_majors = false;
+    mutable major_log_type m_major_log;
+    // Screen output mode.
+    detail::output_mode m_output_mode = detail::output_mode::sync;
+    // Persistent workspace mode. When active, the initialised SNOPT7 workspace is kept in m_workspace (shared
+    // among the copies of this object) and re-used across evolve() calls. m_workspace is created together with the
+    // mode (see reset_workspace()), so that evolve() only reads it.
+    bool m_persistent_workspace = false;
+    std::shared_ptr<detail::snopt7_workspace> m_workspace;
+    // The number of points stored in the fitness and gradient caches, and the caches counters recorded during
+    // the last call to evolve().
+    unsigned m_cache_size = 16u;
+    mutable std::map<std::string, unsigned long long> m_cache_stats;
+    // The batch fitness evaluator used to compute the finite-difference gradient, if set.
+    boost::optional<pagmo::bfe> m_bfe;
+    // Gradient sparsity detection mode.
+    bool m_sparsity_detection = false;
+    // Constant Jacobian detection mode.
+    bool m_constant_jacobian_detection = false;
+    // Warm start mode, and the final state of the last optimisation.
+    bool m_warm_start = false;
+    mutable warm_start_data_type m_warm_start_data;
+    // The final states of the last optimisations, indexed by their final decision vectors.
+    mutable detail::warm_start_db<warm_start_data_type> m_warm_start_db;
+    // The early termination criteria.
+    std::map<std::string, double> m_stop_criteria;
 
     // Deleting the methods load save public inherited from not_population_based as to avoid conflict with serialize
     // implemented by snopt7
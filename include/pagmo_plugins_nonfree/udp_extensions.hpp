@@ -0,0 +1,260 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#ifndef PPNF_UDP_EXTENSIONS_HPP
+#define PPNF_UDP_EXTENSIONS_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/visibility.hpp>
+
+namespace ppnf
+{
+
+/// Detect \p fitness_and_gradient() method.
+/**
+ * This type trait will be \p true if \p T provides a method with
+ * the following signature:
+ * @code{.unparsed}
+ * std::pair<pagmo::vector_double, pagmo::vector_double> fitness_and_gradient(const pagmo::vector_double &) const;
+ * @endcode
+ * The \p fitness_and_gradient() method is part of the interface for the definition of a problem
+ * (see ppnf::register_fitness_and_gradient), and it is used by the solver plugins to compute, in a single call, the
+ * fitness and the gradient of a problem at the same decision vector.
+ */
+template <typename T>
+class has_fitness_and_gradient
+{
+    template <typename U, typename = void>
+    struct detect : std::false_type {
+    };
+    template <typename U>
+    struct detect<U, std::void_t<decltype(std::declval<const U &>().fitness_and_gradient(
+                         std::declval<const pagmo::vector_double &>()))>>
+        : std::is_same<decltype(std::declval<const U &>().fitness_and_gradient(
+                           std::declval<const pagmo::vector_double &>())),
+                       std::pair<pagmo::vector_double, pagmo::vector_double>> {
+    };
+
+public:
+    /// Value of the type trait.
+    static const bool value = detect<T>::value;
+};
+
+template <typename T>
+const bool has_fitness_and_gradient<T>::value;
+
+/// Detect \p linear_jacobian() method.
+/**
+ * This type trait will be \p true if \p T provides a method with
+ * the following signature:
+ * @code{.unparsed}
+ * std::pair<pagmo::sparsity_pattern, pagmo::vector_double> linear_jacobian() const;
+ * @endcode
+ * The \p linear_jacobian() method is part of the interface for the definition of a problem
+ * (see ppnf::register_linear_jacobian), and it is used by the solver plugins to pass the linear part of the
+ * problem to the solvers.
+ */
+template <typename T>
+class has_linear_jacobian
+{
+    template <typename U, typename = void>
+    struct detect : std::false_type {
+    };
+    template <typename U>
+    struct detect<U, std::void_t<decltype(std::declval<const U &>().linear_jacobian())>>
+        : std::is_same<decltype(std::declval<const U &>().linear_jacobian()),
+                       std::pair<pagmo::sparsity_pattern, pagmo::vector_double>> {
+    };
+
+public:
+    /// Value of the type trait.
+    static const bool value = detect<T>::value;
+};
+
+template <typename T>
+const bool has_linear_jacobian<T>::value;
+
+namespace detail
+{
+// Type-erased pointer to the fitness_and_gradient() method of a UDP: the first argument is the UDP itself,
+// as returned by pagmo::problem::get_ptr().
+using fitness_and_gradient_ptr = std::pair<pagmo::vector_double, pagmo::vector_double> (*)(const void *,
+                                                                                             const pagmo::vector_double &);
+
+// Registry of the UDP extensions, keyed by the type of the UDP.
+PPNF_DLL_PUBLIC void register_fitness_and_gradient(const std::type_index &, fitness_and_gradient_ptr);
+PPNF_DLL_PUBLIC fitness_and_gradient_ptr get_fitness_and_gradient(const pagmo::problem &);
+
+// Computes fitness and gradient of p at x via f (as returned by get_fitness_and_gradient()). The
+// dimensions of the input and of the outputs are checked as pagmo::problem would do (the expected size of
+// the gradient, i.e. the size of the gradient sparsity, is passed as grad_size) and the fitness evaluations counter
+// of p is incremented.
+PPNF_DLL_PUBLIC std::pair<pagmo::vector_double, pagmo::vector_double>
+fitness_and_gradient(const pagmo::problem &p, fitness_and_gradient_ptr f, const pagmo::vector_double &x,
+                     pagmo::vector_double::size_type grad_size);
+
+// Type-erased pointer to the linear_jacobian() method of a UDP.
+using linear_jacobian_ptr = std::pair<pagmo::sparsity_pattern, pagmo::vector_double> (*)(const void *);
+
+PPNF_DLL_PUBLIC void register_linear_jacobian(const std::type_index &, linear_jacobian_ptr);
+PPNF_DLL_PUBLIC linear_jacobian_ptr get_linear_jacobian(const pagmo::problem &);
+
+// Computes the linear Jacobian of p via f (as returned by get_linear_jacobian()). The indices are checked against the
+// dimensions of p and the elements are returned sorted (in the order of a pagmo sparsity pattern).
+PPNF_DLL_PUBLIC std::pair<pagmo::sparsity_pattern, pagmo::vector_double> linear_jacobian(const pagmo::problem &p,
+                                                                                         linear_jacobian_ptr f);
+
+template <typename T>
+struct fitness_and_gradient_registrar {
+    static_assert(has_fitness_and_gradient<T>::value,
+                  "A UDP registered via PPNF_REGISTER_FITNESS_AND_GRADIENT() must provide a "
+                  "fitness_and_gradient() method (see ppnf::has_fitness_and_gradient).");
+    fitness_and_gradient_registrar()
+    {
+        register_fitness_and_gradient(std::type_index(typeid(T)),
+                                      [](const void *udp, const pagmo::vector_double &x) {
+                                          return static_cast<const T *>(udp)->fitness_and_gradient(x);
+                                      });
+    }
+};
+
+template <typename T>
+struct linear_jacobian_registrar {
+    static_assert(has_linear_jacobian<T>::value,
+                  "A UDP registered via PPNF_REGISTER_LINEAR_JACOBIAN() must provide a "
+                  "linear_jacobian() method (see ppnf::has_linear_jacobian).");
+    linear_jacobian_registrar()
+    {
+        register_linear_jacobian(std::type_index(typeid(T)),
+                                 [](const void *udp) { return static_cast<const T *>(udp)->linear_jacobian(); });
+    }
+};
+} // namespace detail
+
+} // namespace ppnf
+
+#define PPNF_UDP_EXTENSIONS_CONCAT_IMPL(a, b) a##b
+#define PPNF_UDP_EXTENSIONS_CONCAT(a, b) PPNF_UDP_EXTENSIONS_CONCAT_IMPL(a, b)
+
+/// Register the \p fitness_and_gradient() method of a UDP.
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * pagmo has no notion of a joint fitness and gradient computation. When the fitness and the gradient of a problem
+ * share expensive intermediate results, a UDP can implement the method
+ *
+ * .. code-block:: c++
+ *
+ *    std::pair<pagmo::vector_double, pagmo::vector_double> fitness_and_gradient(const pagmo::vector_double &) const;
+ *
+ * returning the fitness and the gradient (in the same format of ``fitness()`` and ``gradient()``) at the input
+ * decision vector, and register it invoking this macro (at namespace scope, in a single translation unit):
+ *
+ * .. code-block:: c++
+ *
+ *    PPNF_REGISTER_FITNESS_AND_GRADIENT(my_udp)
+ *
+ * The solver plugins will then use it whenever both the fitness and the gradient are requested at the same decision
+ * vector, and the separate ``fitness()`` and ``gradient()`` methods (which the UDP must still provide) otherwise.
+ *
+ * .. note::
+ *
+ *    Each call to ``fitness_and_gradient()`` increments the fitness evaluations counter of the problem, but
+ *    not the gradient evaluations one (pagmo::problem does not allow it).
+ *
+ * \endverbatim
+ */
+#define PPNF_REGISTER_FITNESS_AND_GRADIENT(udp)                                                                      \
+    namespace                                                                                                          \
+    {                                                                                                                  \
+    const ::ppnf::detail::fitness_and_gradient_registrar<udp>                                                          \
+        PPNF_UDP_EXTENSIONS_CONCAT(ppnf_fitness_and_gradient_registrar_, __LINE__);                                    \
+    }
+
+/// Register the \p linear_jacobian() method of a UDP.
+/**
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * pagmo has no notion of linear constraints. When some elements of the gradient of a problem are constant (e.g., the
+ * problem has linear constraints, or its objective has linear terms), a UDP can implement the method
+ *
+ * .. code-block:: c++
+ *
+ *    std::pair<pagmo::sparsity_pattern, pagmo::vector_double> linear_jacobian() const;
+ *
+ * returning the indices (in the same format of ``gradient_sparsity()``) and the values of the constant elements, and
+ * register it invoking this macro (at namespace scope, in a single translation unit):
+ *
+ * .. code-block:: c++
+ *
+ *    PPNF_REGISTER_LINEAR_JACOBIAN(my_udp)
+ *
+ * Each fitness component is then the sum of a linear part (the constant elements times the corresponding
+ * variables) and of a nonlinear remainder not depending on those variables. ``fitness()`` and ``gradient()``
+ * (if provided) must still return the full fitness and gradient: the plugins subtract the linear part from the
+ * fitness, and ignore the constant elements of the gradient.
+ *
+ * Solvers able to handle the linear part separately (SNOPT7, via the A arrays of its snOptA interface) then do not
+ * request the derivatives of the linear part, and keep the linear constraints satisfied exactly.
+ *
+ * \endverbatim
+ */
+#define PPNF_REGISTER_LINEAR_JACOBIAN(udp)                                                                           \
+    namespace                                                                                                          \
+    {                                                                                                                  \
+    const ::ppnf::detail::linear_jacobian_registrar<udp>                                                               \
+        PPNF_UDP_EXTENSIONS_CONCAT(ppnf_linear_jacobian_registrar_, __LINE__);                                         \
+    }
+
+#endif
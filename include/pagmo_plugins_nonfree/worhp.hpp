@@ -51,18 +51,22 @@ see https://www.gnu.org/licenses/. */
 #include <boost/dll/import.hpp>
 #include <boost/dll/shared_library.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/functional/hash.hpp>
+#include <boost/optional.hpp>
 #include <boost/serialization/map.hpp>
 #include <iomanip>
+#include <memory>
 #include <mutex>
 #include <pagmo/algorithm.hpp>
 #include <pagmo/algorithms/not_population_based.hpp>
+#include <pagmo/bfe.hpp>
 #include <pagmo/config.hpp>
 #include <pagmo/exceptions.hpp>
 #include <pagmo/io.hpp>
 #include <pagmo/population.hpp>
 #include <pagmo/problem.hpp>
 #include <pagmo/s11n.hpp>
+// NOTE: after pagmo/s11n.hpp, which includes the boost archives.
+#include <boost/serialization/optional.hpp>
 #include <pagmo/utils/constrained.hpp>
 #include <random>
 #include <stdexcept>
@@ -73,10 +77,29 @@ see https://www.gnu.org/licenses/. */
 #include <vector>
 
 #include "bogus_libs/worhp_lib/worhp_bogus.h"
+#include <pagmo_plugins_nonfree/detail/columnar_log.hpp>
+#include <pagmo_plugins_nonfree/detail/output_sink.hpp>
 #include <pagmo_plugins_nonfree/detail/visibility.hpp>
+#include <pagmo_plugins_nonfree/detail/warm_start_db.hpp>
+#include <pagmo_plugins_nonfree/udp_extensions.hpp>
 
 namespace ppnf
 {
+namespace detail
+{
+// The persistent WORHP solver context used by worhp::evolve() (see worhp::set_persistent_workspace()).
+struct worhp_context;
+// The parameters parsed from the parameter source (see worhp::worhp()).
+struct worhp_params;
+// The fitness, gradient and hessians caches used during an evolve() call.
+struct evaluation_cache;
+// The finite-difference gradient computed by the plugin (see worhp::set_bfe()).
+class fd_gradient;
+// The finite-difference hessians computed by the plugin (see worhp::set_fd_hessians()).
+class fd_hessians;
+// The plan used to assemble the hessian of the lagrangian in parallel (see worhp::set_hm_threads()).
+struct hm_gather;
+} // namespace detail
 
 /// WORHP - (We Optimize Really Huge Problems)
 /**
@@ -127,6 +150,11 @@ namespace ppnf
  *    This plugin for the WORHP was developed around version 1.12.1 of the worhp library and will not work with
  *    any other version.
  *
+ * .. note::
+ *
+ *    The WORHP library is loaded, and its symbols resolved, only once per process (for each library path).
+ *    Replacing the library file while the process is running will thus have no effect.
+ *
  * .. warning::
  *
  *    A moved-from :cpp:class:`ppnf::worhp` is destructible and assignable. Any other operation will result
@@ -159,6 +187,45 @@ public:
      * (see worhp::set_verbosity()).
      */
     using log_type = std::vector<log_line_type>;
+    /// Columnar log type.
+    /**
+     * The algorithm log as it is stored internally, i.e., with one contiguous column per field of
+     * worhp::log_line_type (the feasibility flags being stored as ``unsigned char``) and a bounded number of
+     * lines (see worhp::set_log_capacity()).
+     */
+    using columnar_log_type
+        = detail::columnar_log<unsigned long, double, pagmo::vector_double::size_type, double, bool>;
+    /// Single data line for the algorithm's major iterations log.
+    /**
+     * A major iterations log data line is a tuple consisting of:
+     * - the major iteration number,
+     * - the objective function value for the current iterate,
+     * - the constraints violation (max norm) for the current iterate,
+     * - the optimality (max norm of the KKT residual) for the current iterate,
+     * - the step length of the last major iteration,
+     * - a boolean flag signalling the feasibility of the current iterate,
+     *
+     * as computed by WORHP.
+     */
+    using major_log_line_type = std::tuple<int, double, double, double, double, bool>;
+    /// Major iterations log type.
+    /**
+     * The major iterations log is a collection of worhp::major_log_line_type data lines, stored in chronological
+     * order during the optimisation if the log mode is ``"major"`` (see worhp::set_log_mode()) and the verbosity
+     * of the algorithm is set to a nonzero value (see worhp::set_verbosity()).
+     */
+    using major_log_type = std::vector<major_log_line_type>;
+    /// Warm start data type.
+    /**
+     * The final primal-dual solution of an optimisation, from which a subsequent one can be warm started
+     * (see worhp::set_warm_start()). It is a tuple consisting of:
+     * - the name of the problem,
+     * - the final decision vector (``X``),
+     * - the final multipliers of the box constraints (``Lambda``),
+     * - the final multipliers of the constraints (``Mu``).
+     */
+    using warm_start_data_type
+        = std::tuple<std::string, pagmo::vector_double, pagmo::vector_double, pagmo::vector_double>;
 
     ///  Constructor.
     /**
@@ -169,12 +236,27 @@ public:
      * @param screen_output when ``true`` will activate the screen output from the WORHP library, otherwise
      * will let pagmo regulate logs and screen_output via its pagmo::algorithm::set_verbosity mechanism.
      * @param worhp_library The filename, including the absolute path, of the worhp library.
+     * @param param_source The source of the WORHP parameters. It can be either the path to an xml parameter file,
+     * or the xml content itself (any string starting, after white spaces, with ``<``). If empty, WORHP will
+     * look for the file defined in the environment variable WORHP_PARAM_FILE or, if not set, for a file named
+     * param.xml in the current working directory (falling back to the default parameters if not found).
+     * The source is parsed only once, at the first call to evolve(), and the resulting parameters are then
+     * re-used, so that later changes to the source have no effect.
      *
      */
-    worhp(bool screen_output = false, std::string worhp_library = "/usr/local/lib/libworhp.so");
+    worhp(bool screen_output = false, std::string worhp_library = "/usr/local/lib/libworhp.so",
+          std::string param_source = "");
     pagmo::population evolve(pagmo::population pop) const;
     void set_verbosity(unsigned n);
     const log_type &get_log() const;
+    const columnar_log_type &get_columnar_log() const;
+    void set_log_capacity(unsigned);
+    unsigned get_log_capacity() const;
+    void set_log_mode(const std::string &);
+    std::string get_log_mode() const;
+    const major_log_type &get_major_log() const;
+    void set_output_mode(const std::string &);
+    std::string get_output_mode() const;
     unsigned int get_verbosity() const;
     std::string get_name() const;
     std::string get_extra_info() const;
@@ -191,6 +273,25 @@ public:
     void reset_numeric_options();
     void reset_bool_options();
     std::string get_last_opt_result() const;
+    std::string get_param_source() const;
+    void set_persistent_workspace(bool);
+    bool get_persistent_workspace() const;
+    void set_cache_size(unsigned);
+    unsigned get_cache_size() const;
+    std::map<std::string, unsigned long long> get_cache_stats() const;
+    void set_bfe(const pagmo::bfe &);
+    void set_fd_hessians(bool);
+    bool get_fd_hessians() const;
+    void set_hm_threads(unsigned);
+    unsigned get_hm_threads() const;
+    void set_sparsity_detection(bool);
+    bool get_sparsity_detection() const;
+    void set_warm_start(bool);
+    bool get_warm_start() const;
+    void set_warm_start_data(const warm_start_data_type &);
+    const warm_start_data_type &get_warm_start_data() const;
+    void set_warm_start_db_size(unsigned);
+    unsigned get_warm_start_db_size() const;
     /// Object serialization
     /**
      * This method will save/load \p this into the archive \p ar.
@@ -204,40 +305,39 @@ public:
     {
         pagmo::detail::archive(ar, boost::serialization::base_object<not_population_based>(*this), m_worhp_library,
                                m_last_opt_res, m_integer_opts, m_numeric_opts, m_bool_opts, m_screen_output,
-                               m_verbosity, m_f_cache, m_g_cache);
+                               m_verbosity, m_persistent_workspace, m_param_source, m_cache_size, m_bfe,
+                               m_fd_hessians, m_hm_threads, m_sparsity_detection, m_warm_start, m_warm_start_data,
+                               m_warm_start_db, m_log, m_log_majors, m_output_mode);
+        if (Archive::is_loading::value) {
+            reset_context();
+        }
     }
 
 private:
-    struct pair_hash {
-        template <class T1, class T2>
-        std::size_t operator()(const std::pair<T1, T2> &p) const
-        {
-            std::size_t seed = 0;
-            boost::hash_combine(seed, p.first);
-            boost::hash_combine(seed, p.second);
-            return seed;
-        }
-    };
+    void reset_context();
     // Log update and print to screen
-    void update_log(const pagmo::problem &prob, const pagmo::vector_double &fit, long long unsigned fevals0) const;
+    void update_log(const pagmo::problem &prob, const pagmo::vector_double &fit, long long unsigned fevals0,
+                    detail::output_sink &sink) const;
+    // Major iterations log update and print to screen
+    void update_major_log(const OptVar &opt, const Workspace &wsp, detail::output_sink &sink) const;
     // Objective function
     void UserF(OptVar *opt, Workspace *wsp, Params *, Control *, const pagmo::population &pop,
-               long long unsigned fevals0) const;
+               long long unsigned fevals0, detail::evaluation_cache &cache, detail::output_sink &sink) const;
     // Constraints
-    void UserG(OptVar *opt, Workspace *, Params *, Control *, const pagmo::population &pop) const;
+    void UserG(OptVar *opt, Workspace *, Params *, Control *, const pagmo::population &pop,
+               detail::evaluation_cache &cache) const;
     // Gradient for the objective function
-    void UserDF(OptVar *opt, Workspace *wsp, Params *, Control *, const pagmo::population &pop) const;
+    void UserDF(OptVar *opt, Workspace *wsp, Params *, Control *, const pagmo::population &pop,
+                const std::vector<pagmo::vector_double::size_type> &df_idx_map, detail::evaluation_cache &cache,
+                const detail::fd_gradient *fd_grad) const;
     // Gradient for the constraints
     void UserDG(OptVar *opt, Workspace *wsp, Params *, Control *, const pagmo::population &pop,
-                const std::vector<pagmo::vector_double::size_type> &gs_idx_map) const;
+                const std::vector<pagmo::vector_double::size_type> &dg_idx_map, detail::evaluation_cache &cache,
+                const detail::fd_gradient *fd_grad) const;
     // The Hessian of the Lagrangian L = f + mu * g
     void UserHM(OptVar *opt, Workspace *wsp, Params *, Control *, const pagmo::population &pop,
-                const std::vector<pagmo::sparsity_pattern> &pagmo_hsp, const pagmo::sparsity_pattern &pagmo_merged_hsp,
-                const std::vector<pagmo::vector_double::size_type> &hs_idx_map) const;
-    // We cache the last call to fitness as it will be repeated by worhp
-    pagmo::vector_double fitness_with_cache(const pagmo::vector_double &x, const pagmo::problem &prob) const;
-    // We cache the last call to gradient as it will be repeated by worhp
-    pagmo::vector_double gradient_with_cache(const pagmo::vector_double &x, const pagmo::problem &prob) const;
+                const std::vector<pagmo::vector_double::size_type> &hm_plan, const detail::hm_gather *hm_gather,
+                detail::evaluation_cache &cache, const detail::fd_hessians *fd_hess) const;
     // The absolute path to the worhp library
     std::string m_worhp_library;
     // Solver return status.
@@ -252,11 +352,44 @@ private:
     // Activates the original worhp screen output
     bool m_screen_output;
     unsigned int m_verbosity;
-    mutable log_type m_log;
+    mutable columnar_log_type m_log;
+    // The log as returned by get_log(), built on demand from the columns of m_log kept alive by m_log_lines_storage
+    // (which are thus never modified in place: see columnar_log).
+    mutable log_type m_log_lines;
+    mutable std::shared_ptr<const void> m_log_lines_storage;
+    // Major iterations log mode, and the major iterations log.
+    bool m_log_majors = false;
+    mutable major_log_type m_major_log;
+    // Screen output mode.
+    detail::output_mode m_output_mode = detail::output_mode::sync;
+
+    // The number of points stored in the fitness, gradient and hessians caches, and the caches counters
+    // recorded during the last call to evolve().
+    unsigned m_cache_size = 16u;
+    mutable std::map<std::string, unsigned long long> m_cache_stats;
+    // The batch fitness evaluator used to compute the finite-difference gradient, if set.
+    boost::optional<pagmo::bfe> m_bfe;
+    // Finite-difference hessians mode.
+    bool m_fd_hessians = false;
+    // Number of threads assembling the hessian of the lagrangian (0 for the hardware concurrency).
+    unsigned m_hm_threads = 1u;
+    // Gradient sparsity detection mode.
+    bool m_sparsity_detection = false;
+    // Warm start mode, and the final primal-dual solution of the last optimisation.
+    bool m_warm_start = false;
+    mutable warm_start_data_type m_warm_start_data;
+    // The final primal-dual solutions of the last optimisations, indexed by their final decision vectors.
+    mutable detail::warm_start_db<warm_start_data_type> m_warm_start_db;
+
+    // Persistent workspace mode. When active, the initialised WORHP data structures are kept in m_context (shared
+    // among the copies of this object) and re-used across evolve() calls. m_context is created together with the
+    // mode (see reset_context()), so that evolve() only reads it.
+    bool m_persistent_workspace = false;
+    std::shared_ptr<detail::worhp_context> m_context;
 
-    // The caches
-    mutable std::pair<pagmo::vector_double, pagmo::vector_double> m_f_cache = {{}, {}};
-    mutable std::pair<pagmo::vector_double, pagmo::vector_double> m_g_cache = {{}, {}};
+    // The source of the WORHP parameters and the parameters parsed from it (shared among the copies of this object).
+    std::string m_param_source;
+    std::shared_ptr<detail::worhp_params> m_params;
 
     // Deleting the methods load save public in base as to avoid conflict with serialize
     template <typename Archive>
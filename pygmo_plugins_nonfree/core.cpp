@@ -1,10 +1,14 @@
 #include <boost/numeric/conversion/cast.hpp>
+#include <cstddef>
 #include <iostream>
+#include <memory>
 #include <pagmo/s11n.hpp>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <sstream>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include <pagmo_plugins_nonfree/snopt7.hpp>
 #include <pagmo_plugins_nonfree/worhp.hpp>
@@ -59,6 +63,112 @@ UDA uda_pickle_setstate(py::tuple state)
     return uda;
 }
 
+// Expose the evaluation caches methods of a solver plugin.
+template <typename UDA>
+void expose_eval_cache(py::class_<UDA> &c, const std::string &algo)
+{
+    c.def("set_cache_size", &UDA::set_cache_size, ppnf::set_cache_size_docstring(algo).c_str(), py::arg("n"));
+    c.def("get_cache_size", &UDA::get_cache_size, ppnf::get_cache_size_docstring().c_str());
+    c.def(
+        "get_cache_stats",
+        [](const UDA &a) {
+            py::dict retval;
+            for (const auto &p : a.get_cache_stats()) {
+                retval[py::str(p.first)] = p.second;
+            }
+            return retval;
+        },
+        ppnf::get_cache_stats_docstring().c_str());
+}
+
+// Expose the batch fitness evaluation setter of a solver plugin.
+template <typename UDA>
+void expose_set_bfe(py::class_<UDA> &c, const std::string &solver)
+{
+    c.def("set_bfe", &UDA::set_bfe, ppnf::set_bfe_docstring(solver).c_str(), py::arg("b"));
+}
+
+// Expose the gradient sparsity detection mode of a solver plugin.
+template <typename UDA>
+void expose_sparsity_detection(py::class_<UDA> &c, const std::string &solver)
+{
+    c.def("set_sparsity_detection", &UDA::set_sparsity_detection,
+          ppnf::set_sparsity_detection_docstring(solver).c_str(), py::arg("flag"));
+    c.def("get_sparsity_detection", &UDA::get_sparsity_detection, ppnf::get_sparsity_detection_docstring().c_str());
+}
+
+// Expose the warm start database of a solver plugin.
+template <typename UDA>
+void expose_warm_start_db(py::class_<UDA> &c, const std::string &solver)
+{
+    c.def("set_warm_start_db_size", &UDA::set_warm_start_db_size,
+          ppnf::set_warm_start_db_size_docstring(solver).c_str(), py::arg("n"));
+    c.def("get_warm_start_db_size", &UDA::get_warm_start_db_size, ppnf::get_warm_start_db_size_docstring().c_str());
+}
+
+// Expose the screen output mode of a solver plugin.
+template <typename UDA>
+void expose_output_mode(py::class_<UDA> &c, const std::string &solver)
+{
+    c.def("set_output_mode", &UDA::set_output_mode, ppnf::set_output_mode_docstring(solver).c_str(),
+          py::arg("mode"));
+    c.def("get_output_mode", &UDA::get_output_mode, ppnf::get_output_mode_docstring().c_str());
+}
+
+// A read-only NumPy view of the I-th column of a columnar log, which keeps the log storage alive.
+template <std::size_t I, typename Log>
+py::array log_column(const Log &log, const py::dtype &dt)
+{
+    const auto &col = log.template column<I>();
+    auto storage = new std::shared_ptr<const void>(log.storage());
+    py::capsule base(storage, [](void *p) { delete static_cast<std::shared_ptr<const void> *>(p); });
+    py::array retval(dt, {col.size()}, col.data(), base);
+    retval.attr("setflags")(py::arg("write") = false);
+    return retval;
+}
+
+// Expose the log capacity and the columnar log of a solver plugin.
+template <typename UDA>
+void expose_log_columns(py::class_<UDA> &c)
+{
+    c.def("set_log_capacity", &UDA::set_log_capacity, ppnf::set_log_capacity_docstring().c_str(), py::arg("n"));
+    c.def("get_log_capacity", &UDA::get_log_capacity, ppnf::get_log_capacity_docstring().c_str());
+    c.def(
+        "get_log_arrays",
+        [](const UDA &a) {
+            const auto &log = a.get_columnar_log();
+            py::dict retval;
+            retval["objevals"] = log_column<0>(log, py::dtype::of<unsigned long>());
+            retval["objval"] = log_column<1>(log, py::dtype::of<double>());
+            retval["violated"] = log_column<2>(log, py::dtype::of<pagmo::vector_double::size_type>());
+            retval["viol_norm"] = log_column<3>(log, py::dtype::of<double>());
+            // The feasibility flags are stored as bytes.
+            retval["feasible"] = log_column<4>(log, py::dtype("bool"));
+            return retval;
+        },
+        ppnf::get_log_arrays_docstring().c_str());
+}
+
+// Conversions between std::vector and Python lists.
+template <typename T>
+py::list to_list(const std::vector<T> &v)
+{
+    py::list retval;
+    for (const auto &x : v) {
+        retval.append(x);
+    }
+    return retval;
+}
+
+template <typename T>
+void from_iterable(std::vector<T> &v, const py::handle &o)
+{
+    v.clear();
+    for (const auto &x : o) {
+        v.push_back(x.cast<T>());
+    }
+}
+
 pagmo::population test_intermodule(const pagmo::population &pop) {
     return pop;
 }
@@ -92,14 +202,85 @@ PYBIND11_MODULE(core, m)
                 ppnf::snopt7_set_integer_option_docstring().c_str(), py::arg("name"), py::arg("value"));
     snopt7_.def("set_numeric_option", &ppnf::snopt7::set_numeric_option,
                 ppnf::snopt7_set_numeric_option_docstring().c_str(), py::arg("name"), py::arg("value"));
+    snopt7_.def("set_log_mode", &ppnf::snopt7::set_log_mode, ppnf::snopt7_set_log_mode_docstring().c_str(),
+                py::arg("mode"));
+    snopt7_.def("get_log_mode", &ppnf::snopt7::get_log_mode, ppnf::snopt7_get_log_mode_docstring().c_str());
+    snopt7_.def(
+        "get_major_log",
+        [](const ppnf::snopt7 &a) {
+            py::list retval;
+            for (const auto &t : a.get_major_log()) {
+                retval.append(t);
+            }
+            return retval;
+        },
+        ppnf::snopt7_get_major_log_docstring().c_str());
+    snopt7_.def("set_persistent_workspace", &ppnf::snopt7::set_persistent_workspace,
+                ppnf::snopt7_set_persistent_workspace_docstring().c_str(), py::arg("flag"));
+    snopt7_.def("get_persistent_workspace", &ppnf::snopt7::get_persistent_workspace,
+                ppnf::snopt7_get_persistent_workspace_docstring().c_str());
+    snopt7_.def("set_constant_jacobian_detection", &ppnf::snopt7::set_constant_jacobian_detection,
+                ppnf::snopt7_set_constant_jacobian_detection_docstring().c_str(), py::arg("flag"));
+    snopt7_.def("get_constant_jacobian_detection", &ppnf::snopt7::get_constant_jacobian_detection,
+                ppnf::snopt7_get_constant_jacobian_detection_docstring().c_str());
+    snopt7_.def("set_warm_start", &ppnf::snopt7::set_warm_start, ppnf::snopt7_set_warm_start_docstring().c_str(),
+                py::arg("flag"));
+    snopt7_.def("get_warm_start", &ppnf::snopt7::get_warm_start, ppnf::snopt7_get_warm_start_docstring().c_str());
+    snopt7_.def(
+        "set_warm_start_data",
+        [](ppnf::snopt7 &a, const py::tuple &data) {
+            if (py::len(data) != 6u) {
+                py_throw(PyExc_ValueError, ("the warm start data must be a tuple of 6 elements, but instead it has "
+                                            + std::to_string(py::len(data)) + " element(s)")
+                                               .c_str());
+            }
+            ppnf::snopt7::warm_start_data_type d;
+            std::get<0>(d) = data[0].cast<std::string>();
+            std::get<1>(d) = data[1].cast<int>();
+            from_iterable(std::get<2>(d), data[2]);
+            from_iterable(std::get<3>(d), data[3]);
+            from_iterable(std::get<4>(d), data[4]);
+            from_iterable(std::get<5>(d), data[5]);
+            a.set_warm_start_data(d);
+        },
+        ppnf::snopt7_set_warm_start_data_docstring().c_str(), py::arg("data"));
+    snopt7_.def(
+        "get_warm_start_data",
+        [](const ppnf::snopt7 &a) {
+            const auto &d = a.get_warm_start_data();
+            return py::make_tuple(std::get<0>(d), std::get<1>(d), to_list(std::get<2>(d)), to_list(std::get<3>(d)),
+                                  to_list(std::get<4>(d)), to_list(std::get<5>(d)));
+        },
+        ppnf::snopt7_get_warm_start_data_docstring().c_str());
+    snopt7_.def("set_stop_criterion", &ppnf::snopt7::set_stop_criterion,
+                ppnf::snopt7_set_stop_criterion_docstring().c_str(), py::arg("name"), py::arg("value"));
+    snopt7_.def(
+        "get_stop_criteria",
+        [](const ppnf::snopt7 &a) {
+            py::dict retval;
+            for (const auto &p : a.get_stop_criteria()) {
+                retval[py::str(p.first)] = p.second;
+            }
+            return retval;
+        },
+        ppnf::snopt7_get_stop_criteria_docstring().c_str());
+    snopt7_.def("reset_stop_criteria", &ppnf::snopt7::reset_stop_criteria,
+                ppnf::snopt7_reset_stop_criteria_docstring().c_str());
     snopt7_.def(py::pickle(&uda_pickle_getstate<ppnf::snopt7>, &uda_pickle_setstate<ppnf::snopt7>));
     expose_algo_log(snopt7_, ppnf::snopt7_get_log_docstring().c_str());
+    expose_eval_cache(snopt7_, "snopt7");
+    expose_set_bfe(snopt7_, "SNOPT7");
+    expose_sparsity_detection(snopt7_, "SNOPT7");
+    expose_warm_start_db(snopt7_, "SNOPT7");
+    expose_log_columns(snopt7_);
+    expose_output_mode(snopt7_, "SNOPT7");
     expose_not_population_based(snopt7_, "snopt7");
 
     py::class_<ppnf::worhp> worhp_(m, "worhp", ppnf::worhp_docstring().c_str());
     worhp_.def(py::init<>());
     // We expose the additional constructor
-    worhp_.def(py::init<bool, std::string>(), py::arg("screen_output") = false, py::arg("library") = "/usr/local/lib/");
+    worhp_.def(py::init<bool, std::string, std::string>(), py::arg("screen_output") = false,
+               py::arg("library") = "/usr/local/lib/", py::arg("param_source") = "");
     worhp_.def("evolve", &ppnf::worhp::evolve);
     worhp_.def("set_verbosity", &ppnf::worhp::set_verbosity);
     worhp_.def("get_name", &ppnf::worhp::get_name);
@@ -110,7 +291,64 @@ PYBIND11_MODULE(core, m)
                ppnf::worhp_set_numeric_option_docstring().c_str(), py::arg("name"), py::arg("value"));
     worhp_.def("set_bool_option", &ppnf::worhp::set_bool_option, ppnf::worhp_set_bool_option_docstring().c_str(),
                py::arg("name"), py::arg("value"));
+    worhp_.def("get_param_source", &ppnf::worhp::get_param_source);
+    worhp_.def("set_log_mode", &ppnf::worhp::set_log_mode, ppnf::worhp_set_log_mode_docstring().c_str(),
+               py::arg("mode"));
+    worhp_.def("get_log_mode", &ppnf::worhp::get_log_mode, ppnf::worhp_get_log_mode_docstring().c_str());
+    worhp_.def(
+        "get_major_log",
+        [](const ppnf::worhp &a) {
+            py::list retval;
+            for (const auto &t : a.get_major_log()) {
+                retval.append(t);
+            }
+            return retval;
+        },
+        ppnf::worhp_get_major_log_docstring().c_str());
+    worhp_.def("set_persistent_workspace", &ppnf::worhp::set_persistent_workspace,
+               ppnf::worhp_set_persistent_workspace_docstring().c_str(), py::arg("flag"));
+    worhp_.def("get_persistent_workspace", &ppnf::worhp::get_persistent_workspace,
+               ppnf::worhp_get_persistent_workspace_docstring().c_str());
+    worhp_.def("set_fd_hessians", &ppnf::worhp::set_fd_hessians, ppnf::worhp_set_fd_hessians_docstring().c_str(),
+               py::arg("flag"));
+    worhp_.def("get_fd_hessians", &ppnf::worhp::get_fd_hessians, ppnf::worhp_get_fd_hessians_docstring().c_str());
+    worhp_.def("set_hm_threads", &ppnf::worhp::set_hm_threads, ppnf::worhp_set_hm_threads_docstring().c_str(),
+               py::arg("n"));
+    worhp_.def("get_hm_threads", &ppnf::worhp::get_hm_threads, ppnf::worhp_get_hm_threads_docstring().c_str());
+    worhp_.def("set_warm_start", &ppnf::worhp::set_warm_start, ppnf::worhp_set_warm_start_docstring().c_str(),
+               py::arg("flag"));
+    worhp_.def("get_warm_start", &ppnf::worhp::get_warm_start, ppnf::worhp_get_warm_start_docstring().c_str());
+    worhp_.def(
+        "set_warm_start_data",
+        [](ppnf::worhp &a, const py::tuple &data) {
+            if (py::len(data) != 4u) {
+                py_throw(PyExc_ValueError, ("the warm start data must be a tuple of 4 elements, but instead it has "
+                                            + std::to_string(py::len(data)) + " element(s)")
+                                               .c_str());
+            }
+            ppnf::worhp::warm_start_data_type d;
+            std::get<0>(d) = data[0].cast<std::string>();
+            from_iterable(std::get<1>(d), data[1]);
+            from_iterable(std::get<2>(d), data[2]);
+            from_iterable(std::get<3>(d), data[3]);
+            a.set_warm_start_data(d);
+        },
+        ppnf::worhp_set_warm_start_data_docstring().c_str(), py::arg("data"));
+    worhp_.def(
+        "get_warm_start_data",
+        [](const ppnf::worhp &a) {
+            const auto &d = a.get_warm_start_data();
+            return py::make_tuple(std::get<0>(d), to_list(std::get<1>(d)), to_list(std::get<2>(d)),
+                                  to_list(std::get<3>(d)));
+        },
+        ppnf::worhp_get_warm_start_data_docstring().c_str());
     worhp_.def(py::pickle(&uda_pickle_getstate<ppnf::worhp>, &uda_pickle_setstate<ppnf::worhp>));
     expose_algo_log(worhp_, ppnf::worhp_get_log_docstring().c_str());
+    expose_eval_cache(worhp_, "worhp");
+    expose_set_bfe(worhp_, "WORHP");
+    expose_sparsity_detection(worhp_, "WORHP");
+    expose_warm_start_db(worhp_, "WORHP");
+    expose_log_columns(worhp_);
+    expose_output_mode(worhp_, "WORHP");
     expose_not_population_based(worhp_, "worhp");
 }
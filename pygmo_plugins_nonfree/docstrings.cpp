@@ -64,10 +64,11 @@ Raises:
    A moved-from :cpp:class:`ppnf::snopt7` is destructible and assignable. Any other operation will result
    in undefined behaviour.
 
-.. warning::
+.. note::
 
-   The possibility to exploit the linear part of the problem fitness, part of the original SNOPT7 library,
-   is deactivated in this plugin for pagmo.
+   The linear part of the problem fitness can be exploited as in the original SNOPT7 library: the plugin can detect
+   the constant elements of the gradient (see :func:`~pygmo_plugins_nonfree.snopt7.set_constant_jacobian_detection()`),
+   and C++ UDPs can declare them via the ``PPNF_REGISTER_LINEAR_JACOBIAN`` macro.
 
 .. seealso::
 
@@ -244,6 +245,61 @@ Examples:
 )";
 }
 
+std::string snopt7_set_log_mode_docstring()
+{
+    return R"(set_log_mode(mode)
+
+Set the log mode.
+
+In the default ``"evaluation"`` log mode, the status of the optimisation is printed and recorded every *n* objective
+function evaluations, *n* being the verbosity, including the trial points of the line searches. In the ``"major"``
+log mode, it is instead printed and recorded every *n* major iterations, from the data SNOPT7 passes to its snLog
+hook, and the log can be fetched via :func:`~pygmo_plugins_nonfree.snopt7.get_major_log()`. In this mode, no work is
+done for the log when evaluating the fitness.
+
+Args:
+   mode (``str``): the log mode, either ``"evaluation"`` or ``"major"``
+
+Raises:
+    ValueError: if *mode* is not one of ``"evaluation"`` and ``"major"``
+
+.. note::
+
+   The SNOPT7 screen output is not affected by the log mode.
+
+)";
+}
+
+std::string snopt7_get_log_mode_docstring()
+{
+    return R"(get_log_mode()
+
+Returns:
+    ``str``: the log mode, either ``"evaluation"`` or ``"major"``
+
+)";
+}
+
+std::string snopt7_get_major_log_docstring()
+{
+    return R"(get_major_log()
+
+Returns:
+    ``list``: the major iterations log (see :func:`~pygmo_plugins_nonfree.snopt7.set_log_mode()`) containing the
+    values ``major``, ``merit``, ``step``, ``prim. inf.``, ``dual inf.``, ``superbasics``, where:
+
+    * ``major`` (``int``), the major iteration number
+    * ``merit`` (``float``), the merit function
+    * ``step`` (``float``), the step length
+    * ``prim. inf.`` (``float``), the primal infeasibility
+    * ``dual inf.`` (``float``), the dual infeasibility
+    * ``superbasics`` (``int``), the number of superbasic variables
+
+    all as computed by SNOPT7.
+
+)";
+}
+
 std::string snopt7_set_numeric_option_docstring()
 {
     return R"(set_numeric_option(name, value)
@@ -315,9 +371,196 @@ Examples:
 )";
 }
 
+std::string snopt7_set_persistent_workspace_docstring()
+{
+    return R"(set_persistent_workspace(flag)
+
+Set the persistent workspace mode.
+
+By default, each call to evolve() initialises a new SNOPT7 workspace (calling snInit) and releases it at the end
+(calling deleteSNOPT). When solving many small problems this setup can dominate the solution time. In the persistent
+workspace mode, the initialised workspace is instead kept and re-used by the subsequent calls to evolve(), and
+the options are passed to SNOPT7 only when their values changed. The workspace is initialised anew, automatically,
+whenever the problem name, dimensions or gradient sparsity change, or when an option previously set is removed.
+
+Args:
+   flag (``bool``): ``True`` to activate the persistent workspace mode, ``False`` to deactivate it
+
+.. note::
+
+   Copies of this object share the same persistent workspace. If evolve() is called concurrently on two copies,
+   one of them will use a temporary workspace, as if the persistent workspace mode was not active.
+
+)";
+}
+
+std::string snopt7_get_persistent_workspace_docstring()
+{
+    return R"(get_persistent_workspace()
+
+Returns:
+    ``bool``: ``True`` if the persistent workspace mode is active, ``False`` otherwise
+
+)";
+}
+
+std::string snopt7_set_constant_jacobian_detection_docstring()
+{
+    return R"(set_constant_jacobian_detection(flag)
+
+Set the constant Jacobian detection mode.
+
+Elements of the gradient that are constant (e.g., those of linear constraints) are best passed to SNOPT7 as the
+linear part of the problem, so that they are neither requested nor copied at each iteration. In the constant
+Jacobian detection mode, the plugin finds them for problems providing the gradient: the gradient is evaluated at the
+initial guess and at a few random points near it, and the elements having the same value at all the points are
+passed to SNOPT7 as the linear part of the problem. Problems not providing the gradient are not affected.
+
+Args:
+   flag (``bool``): ``True`` to activate the constant Jacobian detection mode, ``False`` to deactivate it
+
+.. note::
+
+   The detected elements are cached (per problem name, dimensions and bounds), so that the detection runs only once
+   per problem.
+
+.. warning::
+
+   Elements constant near the initial guess may not be constant elsewhere. The detected elements are thus verified
+   at each gradient evaluation: if one of them changes, the detection is discarded and the optimisation is started
+   again without a linear part.
+
+)";
+}
+
+std::string snopt7_get_constant_jacobian_detection_docstring()
+{
+    return R"(get_constant_jacobian_detection()
+
+Returns:
+    ``bool``: ``True`` if the constant Jacobian detection mode is active, ``False`` otherwise
+
+)";
+}
+
+std::string snopt7_set_warm_start_docstring()
+{
+    return R"(set_warm_start(flag)
+
+Set the warm start mode.
+
+At the end of each call to evolve(), the final number of superbasic variables and the final states and multipliers
+of the variables and of the fitness components are stored in this object (see :func:`~pygmo_plugins_nonfree.snopt7.get_warm_start_data()`).
+In the warm start mode, a subsequent call to evolve() on a problem with the same name and dimensions starts SNOPT7
+from them (a "Warm" start of the snOptA interface, rather than a "Cold" one). The initial decision vector is still
+the one selected from the population.
+
+Args:
+   flag (``bool``): ``True`` to activate the warm start mode, ``False`` to deactivate it
+
+)";
+}
+
+std::string snopt7_get_warm_start_docstring()
+{
+    return R"(get_warm_start()
+
+Returns:
+    ``bool``: ``True`` if the warm start mode is active, ``False`` otherwise
+
+)";
+}
+
+std::string snopt7_set_warm_start_data_docstring()
+{
+    return R"(set_warm_start_data(data)
+
+Set the data from which the next call to evolve() will be warm started, if the warm start mode is active.
+
+Args:
+   data (``tuple``): the problem name, the number of superbasic variables, the states and the multipliers of the
+     variables and the states and the multipliers of the fitness components, as returned by
+     :func:`~pygmo_plugins_nonfree.snopt7.get_warm_start_data()`
+
+Raises:
+    ValueError: if the sizes of the states and of the multipliers are not consistent, or if the number of superbasic
+      variables is negative
+
+)";
+}
+
+std::string snopt7_get_warm_start_data_docstring()
+{
+    return R"(get_warm_start_data()
+
+Returns:
+    ``tuple``: the final state of the last optimisation, i.e. the problem name, the number of superbasic variables,
+    the states (``list`` of ``int``) and the multipliers (``list`` of ``float``) of the variables and the states and
+    the multipliers of the fitness components. Before the first call to evolve(), the name is empty and so are the
+    lists.
+
+)";
+}
+
+std::string snopt7_set_stop_criterion_docstring()
+{
+    return R"(set_stop_criterion(name, value)
+
+Set an early termination criterion.
+
+The early termination criteria are checked by the plugin at the end of each major iteration (via the snSTOP hook of
+SNOPT7), from the data SNOPT7 provides, and they stop the optimisation as soon as one of them is met (with the exit
+code 74, "terminated from monitor routine"). They are meant to cut short the local optimisations that are not
+promising (e.g., in multi-start schemes).
+
+Args:
+   name (``string``): name of the criterion
+   value (``float``): value of the criterion
+
+Raises:
+    ValueError: if *name* is not one of the criteria listed below, if *value* is NaN, or if *value* is negative (or not
+      integral) for the criteria expecting a non-negative (integral) value
+
+The available criteria are listed in the following table:
+
+=============================  ============================================================================
+Name                           Notes
+=============================  ============================================================================
+Target objective               stop when the current point is feasible with an objective not greater
+Primal feasibility             if nonzero, stop when SNOPT7 deems the current point primal feasible
+Max primal infeasibility       stop when the primal infeasibility computed by SNOPT7 exceeds it
+Max dual infeasibility         stop when the dual infeasibility computed by SNOPT7 exceeds it
+Infeasibility check iteration  the major iteration from which the two limits above are checked (default 0)
+Stall iterations               stop when the merit function did not decrease over this many major iterations
+Stall tolerance                the relative decrease of the merit function deemed a stall (default 0)
+=============================  ============================================================================
+
+)";
+}
+
+std::string snopt7_get_stop_criteria_docstring()
+{
+    return R"(get_stop_criteria()
+
+Returns:
+    ``dict``: the early termination criteria set (see
+    :func:`~pygmo_plugins_nonfree.snopt7.set_stop_criterion()`)
+
+)";
+}
+
+std::string snopt7_reset_stop_criteria_docstring()
+{
+    return R"(reset_stop_criteria()
+
+Clear all early termination criteria.
+
+)";
+}
+
 std::string worhp_docstring()
 {
-    return R"(__init__(screen_output = false, library = '\usr\local\lib\libworhp.so')
+    return R"(__init__(screen_output = false, library = '\usr\local\lib\libworhp.so', param_source = '')
 
 WORHP - (We Optimize Really Huge Problems)
 
@@ -360,6 +603,9 @@ Args:
    screen_output (``bool``): when True will activate the original screen output from WORHP and deactivate the logging system based on
      :class:`~pygmo_worhp.set_verbosity()`.
    library (``str``): the worhp library filename in your system (absolute path included)
+   param_source (``str``): the path to an xml parameter file, or the xml content itself. If empty, WORHP will look
+     for the file defined in the environment variable WORHP_PARAM_FILE or, if not set, for param.xml in the current
+     working directory. The source is parsed only once, at the first call to evolve().
 
 Raises:
    ArgumentError: for any conversion problems between the python types and the c++ signature
@@ -616,6 +862,465 @@ Raises:
     unspecified: any exception thrown by failures at the intersection between C++ and Python (e.g.,
       type conversion errors, mismatched function signatures, etc.)
 
+)";
+}
+
+std::string set_cache_size_docstring(const std::string &algo)
+{
+    return R"(set_cache_size(n)
+
+Set the size of the evaluation caches.
+
+The fitness, gradients and (where used) hessians computed by the problem during evolve() are stored in
+least-recently-used caches, each holding up to *n* points, so that they are not recomputed when the solver requests
+them again at the same decision vector. The points are looked up via a hash and then compared exactly. A size of
+zero disables the caches. The caches are emptied at each call to evolve(), and their efficiency can be inspected
+via :func:`~pygmo_plugins_nonfree.)"
+           + algo + R"(.get_cache_stats()`.
+
+Args:
+    n (``int``): the number of points stored in each cache (defaults to 16)
+
+Raises:
+    OverflowError: if *n* is negative or too large
+
+)";
+}
+
+std::string get_cache_size_docstring()
+{
+    return R"(get_cache_size()
+
+Returns:
+    ``int``: the number of points stored in each of the evaluation caches
+
+)";
+}
+
+std::string get_cache_stats_docstring()
+{
+    return R"(get_cache_stats()
+
+Returns:
+    ``dict``: the hits and misses counters of the evaluation caches during the last call to evolve(), with the keys
+    ``"fitness_hits"``, ``"fitness_misses"``, ``"gradient_hits"``, ``"gradient_misses"``, ``"hessians_hits"`` and
+    ``"hessians_misses"``. The hits count the values returned from the caches, the misses the values computed by the
+    problem. The dictionary is empty if evolve() was never called.
+
+)";
+}
+
+std::string set_bfe_docstring(const std::string &solver)
+{
+    return R"(set_bfe(b)
+
+Set the batch fitness evaluator.
+
+When the problem does not provide the gradient, )"
+           + solver + R"( estimates it by finite differences, evaluating one perturbed point at a time.
+After a batch fitness evaluator has been set, the gradient is instead estimated by the plugin with forward
+differences: the columns of the gradient sparsity pattern are grouped via a Curtis-Powell-Reid coloring, so that all
+the columns in a group can be estimated from a single perturbed point, and the perturbed points of all the groups are
+evaluated in a single batch via *b* (thus, for instance, in parallel when using a :class:`pygmo.thread_bfe`). The
+gradient is then passed to )"
+           + solver + R"( as if it was provided by the problem. Problems providing the gradient are not affected.
+
+Args:
+    b (:class:`pygmo.bfe`): the batch fitness evaluator that will be used to evaluate the perturbed points
+
+Raises:
+    unspecified: any exception thrown by failures at the intersection between C++ and Python (e.g.,
+      type conversion errors, mismatched function signatures, etc.)
+
+)";
+}
+
+std::string set_sparsity_detection_docstring(const std::string &solver)
+{
+    return R"(set_sparsity_detection(flag)
+
+Set the gradient sparsity detection mode.
+
+When the problem does not provide the gradient sparsity, a dense one is assumed and passed to )"
+           + solver + R"(. In the gradient
+sparsity detection mode, the plugin instead probes the problem at a few random points around the initial guess (in
+neighbourhoods of increasing radius, up to the magnitude of the variables), collecting the nonzeros of the gradient (if provided by the problem) or the fitness components changed by perturbing
+each variable. The resulting pattern is validated at a further random point (falling back to the dense pattern if
+the validation fails), and passed to )"
+           + solver + R"( instead of the dense one. The perturbed points are evaluated via the batch
+fitness evaluator, if set (see ``set_bfe()``), or via the default :class:`pygmo.bfe` otherwise. Problems providing
+the gradient sparsity are not affected.
+
+Args:
+   flag (``bool``): ``True`` to activate the gradient sparsity detection mode, ``False`` to deactivate it
+
+.. note::
+
+   The detected pattern is cached (per problem name, dimensions and bounds), so that the detection runs only once
+   per problem. As the cache key does not identify the problem uniquely, a cached pattern is validated: if the
+   problem provides the gradient, at no extra cost, during the run (see below); otherwise, perturbing a few variables
+   (at most eight, cycling through all of them across the calls) at a further random point, which costs at most nine
+   fitness evaluations. A pattern failing the validation is detected again.
+
+.. warning::
+
+   Dependencies that do not manifest themselves at the probe points cannot be detected. If the problem provides the
+   gradient, the elements outside the detected pattern are verified to be zero at each gradient evaluation: otherwise,
+   the optimisation is stopped and started again with the dense pattern, which is then cached for the problem. If it
+   does not, the missed dependencies are silently ignored: problems whose sparsity changes across the search space
+   should provide it explicitly.
+
+)";
+}
+
+std::string get_sparsity_detection_docstring()
+{
+    return R"(get_sparsity_detection()
+
+Returns:
+    ``bool``: ``True`` if the gradient sparsity detection mode is active, ``False`` otherwise
+
+)";
+}
+
+std::string set_warm_start_db_size_docstring(const std::string &solver)
+{
+    return R"(set_warm_start_db_size(n)
+
+Set the size of the warm start database.
+
+In the warm start mode (see ``set_warm_start()``), only the final state of the last optimisation is reused by
+default. With a nonzero size, the final states of the last *n* optimisations are instead stored (together with their
+final decision vectors) in a database, and each call to evolve() warm starts )"
+           + solver + R"( from the state stored at the decision
+vector nearest to the initial one, among those of the same problem (i.e., with the same name and dimensions). Each
+variable is scaled by the width of its bounds, if finite, in the distance computation.
+
+Args:
+   n (``int``): the maximum number of states stored (zero to disable the database, which is then emptied)
+
+.. note::
+
+   The database is most effective in multi-start optimisations over clustered basins of attraction. When full, the
+   oldest states are evicted.
+
+)";
+}
+
+std::string get_warm_start_db_size_docstring()
+{
+    return R"(get_warm_start_db_size()
+
+Returns:
+    ``int``: the maximum number of states stored in the warm start database
+
+)";
+}
+
+std::string set_log_capacity_docstring()
+{
+    return R"(set_log_capacity(n)
+
+Set the log capacity.
+
+By default, the optimisation log is unbounded. With a nonzero capacity, the log is preallocated at the beginning of
+each call to evolve() and, whenever it is full, every other line recorded so far is discarded: from then on, one line
+every 2 (4, 8, ...) lines is recorded. The log thus never holds more than *n* lines, which cover the whole
+optimisation in chronological order. The lines printed to screen are not affected.
+
+Args:
+   n (``int``): the log capacity (zero for an unbounded log)
+
+Raises:
+   ValueError: if *n* is 1
+
+)";
+}
+
+std::string get_log_capacity_docstring()
+{
+    return R"(get_log_capacity()
+
+Returns:
+    ``int``: the log capacity (zero for an unbounded log)
+
+)";
+}
+
+std::string get_log_arrays_docstring()
+{
+    return R"(get_log_arrays()
+
+Returns the optimisation log as NumPy arrays, one per column of the log returned by ``get_log()``.
+
+The arrays are read-only views of the log stored in the algorithm, and no data is copied. They stay valid (and
+unchanged) after subsequent calls to evolve().
+
+Returns:
+    ``dict``: a dictionary with keys ``"objevals"``, ``"objval"``, ``"violated"``, ``"viol_norm"`` and
+    ``"feasible"``, mapping to 1-dimensional NumPy arrays of the same length
+
+Examples:
+    >>> uda.get_log_arrays()["objval"] # doctest: +SKIP
+    array([48.9451, 30.153, 26.2884, 14.6958, 14.7742, 17.093, 17.1772, 17.0254, 17.0162, 17.0142, 17.014, 17.014])
+
+)";
+}
+
+std::string set_output_mode_docstring(const std::string &solver)
+{
+    return R"(set_output_mode(mode)
+
+Set the screen output mode.
+
+This selects how the screen output produced with a nonzero verbosity is written:
+
+* in the default ``"sync"`` mode, each line is written to screen as soon as it is produced, while )"
+           + solver + R"( waits,
+* in the ``"async"`` mode, the data of each line is queued, and a writer thread formats the queued lines and writes
+  them to screen in batches. All the lines are written before evolve() returns,
+* in the ``"null"`` mode, nothing is written to screen, while the log is still recorded.
+
+The ``"async"`` and ``"null"`` modes thus keep the screen output latency (e.g., when the standard output is piped to
+another process) off the optimisation. The )"
+           + solver + R"( screen output (see the constructor) is not affected by the output mode.
+
+Args:
+   mode (``str``): the screen output mode, one of ``"sync"``, ``"async"`` and ``"null"``
+
+Raises:
+   ValueError: if *mode* is not one of ``"sync"``, ``"async"`` and ``"null"``
+
+)";
+}
+
+std::string get_output_mode_docstring()
+{
+    return R"(get_output_mode()
+
+Returns:
+    ``str``: the screen output mode, one of ``"sync"``, ``"async"`` and ``"null"``
+
+)";
+}
+
+std::string worhp_set_log_mode_docstring()
+{
+    return R"(set_log_mode(mode)
+
+Set the log mode.
+
+In the default ``"evaluation"`` log mode, the status of the optimisation is printed and recorded every *n* objective
+function evaluations, *n* being the verbosity, testing the constraints of each logged evaluation against the
+problem's tolerances. In the ``"major"`` log mode, it is instead printed and recorded every *n* major iterations, when
+WORHP requests the iteration output, reading the current iterate's data from the WORHP workspace, and the log can be
+fetched via :func:`~pygmo_plugins_nonfree.worhp.get_major_log()`. In this mode, no work is done for the log when
+evaluating the fitness.
+
+Args:
+   mode (``str``): the log mode, either ``"evaluation"`` or ``"major"``
+
+Raises:
+    ValueError: if *mode* is not one of ``"evaluation"`` and ``"major"``
+
+)";
+}
+
+std::string worhp_get_log_mode_docstring()
+{
+    return R"(get_log_mode()
+
+Returns:
+    ``str``: the log mode, either ``"evaluation"`` or ``"major"``
+
+)";
+}
+
+std::string worhp_get_major_log_docstring()
+{
+    return R"(get_major_log()
+
+Returns:
+    ``list``: the major iterations log (see :func:`~pygmo_plugins_nonfree.worhp.set_log_mode()`) containing the
+    values ``major``, ``objval``, ``viol. norm``, ``optimality``, ``step``, ``feas.``, where:
+
+    * ``major`` (``int``), the major iteration number
+    * ``objval`` (``float``), the objective function value for the current iterate
+    * ``viol. norm`` (``float``), the constraints violation (max norm) for the current iterate
+    * ``optimality`` (``float``), the optimality (max norm of the KKT residual) for the current iterate
+    * ``step`` (``float``), the step length of the last major iteration
+    * ``feas.`` (``bool``), a boolean flag signalling the feasibility of the current iterate
+
+    all as computed by WORHP.
+
+)";
+}
+
+std::string worhp_set_persistent_workspace_docstring()
+{
+    return R"(set_persistent_workspace(flag)
+
+Set the persistent workspace mode.
+
+By default, each call to evolve() initialises the WORHP data structures (calling WorhpPreInit, ReadParams and
+WorhpInit) and releases them at the end (calling WorhpFree). In the persistent workspace mode, the data structures
+are instead kept and, if the problem dimensions, the gradient and hessian sparsity patterns, the constraints
+tolerances and the options are unchanged, the subsequent calls to evolve() only restart WORHP (calling
+WorhpRestart) from the new initial values. Otherwise, the data structures are initialised anew, automatically.
+
+Args:
+   flag (``bool``): ``True`` to activate the persistent workspace mode, ``False`` to deactivate it
+
+.. note::
+
+   Copies of this object share the same persistent data structures. If evolve() is called concurrently on two
+   copies, one of them will use temporary data structures, as if the persistent workspace mode was not active.
+
+)";
+}
+
+std::string worhp_get_persistent_workspace_docstring()
+{
+    return R"(get_persistent_workspace()
+
+Returns:
+    ``bool``: ``True`` if the persistent workspace mode is active, ``False`` otherwise
+
+)";
+}
+
+std::string worhp_set_fd_hessians_docstring()
+{
+    return R"(set_fd_hessians(flag)
+
+Set the finite-difference hessians mode.
+
+When the problem provides the gradient but not the hessians, WORHP approximates the hessian of the Lagrangian via
+quasi-Newton updates or via its own finite differences, evaluating one perturbed point at a time. In the
+finite-difference hessians mode, the hessians are instead computed by the plugin, differencing the gradient along the
+directions given by a Curtis-Powell-Reid coloring of the hessians sparsity patterns, so that each hessian costs as many
+gradient evaluations as the number of colors. The perturbed gradients are evaluated concurrently, and the hessians are
+then passed to WORHP as if they were provided by the problem. Problems providing the hessians, or not providing the
+gradient, are not affected.
+
+Args:
+   flag (``bool``): ``True`` to activate the finite-difference hessians mode, ``False`` to deactivate it
+
+.. note::
+
+   Problems whose thread safety is ``basic`` are copied once per thread (at the start of ``evolve()``), and the
+   gradient evaluations made by the copies are not counted by the problem in the population, which thus under-reports
+   the cost of the finite differences. Their number is printed at the end of ``evolve()`` when the verbosity is
+   nonzero. Problems whose thread safety is ``none`` (e.g., pythonic problems) are evaluated serially.
+
+)";
+}
+
+std::string worhp_get_fd_hessians_docstring()
+{
+    return R"(get_fd_hessians()
+
+Returns:
+    ``bool``: ``True`` if the finite-difference hessians mode is active, ``False`` otherwise
+
+)";
+}
+
+std::string worhp_set_hm_threads_docstring()
+{
+    return R"(set_hm_threads(n)
+
+Set the number of threads assembling the hessian of the lagrangian.
+
+By default, the hessian of the lagrangian is assembled sequentially, summing the hessians of the objective and of the
+constraints weighted by the corresponding multipliers. With *n* threads, its nonzeros are instead partitioned among
+the threads in chunks having about the same number of contributions. Each nonzero is summed by a single thread in the
+same order as in the sequential assembly, so that the result is bitwise identical regardless of the number of
+threads.
+
+Args:
+   n (``int``): the number of threads: 1 (the default) for the sequential assembly, 0 to use as many threads as the
+     hardware supports
+
+Raises:
+    OverflowError: if *n* is negative or too large
+
+.. note::
+
+   The threads are started once per call to ``evolve()`` and reused at each request of the hessian. Still, their
+   synchronisation has a cost, so the parallel assembly pays off only for problems whose hessians have a large number
+   of nonzeros (e.g., many constraints).
+
+)";
+}
+
+std::string worhp_get_hm_threads_docstring()
+{
+    return R"(get_hm_threads()
+
+Returns:
+    ``int``: the number of threads assembling the hessian of the lagrangian (see :func:`~pygmo_plugins_nonfree.worhp.set_hm_threads()`)
+
+)";
+}
+
+std::string worhp_set_warm_start_docstring()
+{
+    return R"(set_warm_start(flag)
+
+Set the warm start mode.
+
+At the end of each call to evolve() terminating without errors, the final decision vector and the final multipliers
+of the box constraints and of the constraints are stored in this object (see :func:`~pygmo_plugins_nonfree.worhp.get_warm_start_data()`).
+In the warm start mode, a subsequent call to evolve() on a problem with the same name and dimensions uses the stored
+multipliers as the initial ones, instead of zeros (and disables the initial Lagrange multipliers estimate of WORHP,
+i.e. the "InitialLMest" parameter). The initial decision vector is still the one selected from the population.
+
+Args:
+   flag (``bool``): ``True`` to activate the warm start mode, ``False`` to deactivate it
+
+.. note::
+
+   The warm start data is pickled together with the algorithm, so that it survives the migration between islands.
+
+)";
+}
+
+std::string worhp_get_warm_start_docstring()
+{
+    return R"(get_warm_start()
+
+Returns:
+    ``bool``: ``True`` if the warm start mode is active, ``False`` otherwise
+
+)";
+}
+
+std::string worhp_set_warm_start_data_docstring()
+{
+    return R"(set_warm_start_data(data)
+
+Set the data from which the next call to evolve() will be warm started, if the warm start mode is active.
+
+Args:
+   data (``tuple``): the problem name, the decision vector, the multipliers of the box constraints and the
+     multipliers of the constraints, as returned by :func:`~pygmo_plugins_nonfree.worhp.get_warm_start_data()`
+
+Raises:
+    ValueError: if the sizes of the decision vector and of the multipliers of the box constraints differ
+
+)";
+}
+
+std::string worhp_get_warm_start_data_docstring()
+{
+    return R"(get_warm_start_data()
+
+Returns:
+    ``tuple``: the final primal-dual solution of the last optimisation, i.e. the problem name, the decision vector,
+    the multipliers of the box constraints and the multipliers of the constraints (each a ``list`` of ``float``).
+    Before the first call to evolve(), the name is empty and so are the lists.
+
 )";
 }
 } // namespace ppnf
@@ -9,17 +9,62 @@ namespace ppnf
 std::string bls_selection_docstring(const std::string &);
 std::string bls_replacement_docstring(const std::string &);
 std::string bls_set_random_sr_seed_docstring(const std::string &);
+// evaluation caches.
+std::string set_cache_size_docstring(const std::string &);
+std::string get_cache_size_docstring();
+std::string get_cache_stats_docstring();
+// finite-difference gradient.
+std::string set_bfe_docstring(const std::string &);
+std::string set_sparsity_detection_docstring(const std::string &);
+std::string get_sparsity_detection_docstring();
+// warm start database.
+std::string set_warm_start_db_size_docstring(const std::string &);
+std::string get_warm_start_db_size_docstring();
+// columnar log.
+std::string set_log_capacity_docstring();
+std::string get_log_capacity_docstring();
+std::string get_log_arrays_docstring();
+// screen output mode.
+std::string set_output_mode_docstring(const std::string &);
+std::string get_output_mode_docstring();
 // snopt7
 std::string snopt7_docstring();
 std::string snopt7_get_log_docstring();
 std::string snopt7_set_integer_option_docstring();
 std::string snopt7_set_numeric_option_docstring();
+std::string snopt7_set_log_mode_docstring();
+std::string snopt7_get_log_mode_docstring();
+std::string snopt7_get_major_log_docstring();
+std::string snopt7_set_persistent_workspace_docstring();
+std::string snopt7_get_persistent_workspace_docstring();
+std::string snopt7_set_constant_jacobian_detection_docstring();
+std::string snopt7_get_constant_jacobian_detection_docstring();
+std::string snopt7_set_warm_start_docstring();
+std::string snopt7_get_warm_start_docstring();
+std::string snopt7_set_warm_start_data_docstring();
+std::string snopt7_get_warm_start_data_docstring();
+std::string snopt7_set_stop_criterion_docstring();
+std::string snopt7_get_stop_criteria_docstring();
+std::string snopt7_reset_stop_criteria_docstring();
 // worhp
 std::string worhp_docstring();
 std::string worhp_get_log_docstring();
 std::string worhp_set_integer_option_docstring();
 std::string worhp_set_numeric_option_docstring();
 std::string worhp_set_bool_option_docstring();
+std::string worhp_set_log_mode_docstring();
+std::string worhp_get_log_mode_docstring();
+std::string worhp_get_major_log_docstring();
+std::string worhp_set_persistent_workspace_docstring();
+std::string worhp_get_persistent_workspace_docstring();
+std::string worhp_set_fd_hessians_docstring();
+std::string worhp_get_fd_hessians_docstring();
+std::string worhp_set_hm_threads_docstring();
+std::string worhp_get_hm_threads_docstring();
+std::string worhp_set_warm_start_docstring();
+std::string worhp_get_warm_start_docstring();
+std::string worhp_set_warm_start_data_docstring();
+std::string worhp_get_warm_start_data_docstring();
 }
 
 #endif
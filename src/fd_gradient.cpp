@@ -0,0 +1,384 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <pagmo/bfe.hpp>
+#include <pagmo/exceptions.hpp>
+#include <pagmo/problem.hpp>
+#include <pagmo/threading.hpp>
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/fd_gradient.hpp>
+#include <pagmo_plugins_nonfree/detail/parallel_for.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+
+namespace
+{
+using size_type = pagmo::vector_double::size_type;
+
+const auto uncolored = std::numeric_limits<size_type>::max();
+
+// The adjacency of the sparsity pattern: the columns having a nonzero in each row, and the rows having a nonzero
+// in each column.
+struct pattern_adjacency {
+    pattern_adjacency(const pagmo::sparsity_pattern &sp, size_type nx) : m_cols(nx)
+    {
+        size_type nrows = 0u;
+        for (const auto &p : sp) {
+            nrows = std::max(nrows, p.first + 1u);
+        }
+        m_rows.resize(nrows);
+        for (const auto &p : sp) {
+            m_rows[p.first].push_back(p.second);
+            m_cols[p.second].push_back(p.first);
+        }
+    }
+    std::vector<std::vector<size_type>> m_rows;
+    std::vector<std::vector<size_type>> m_cols;
+};
+
+// Assigns to the column j the smallest color not used by the columns already colored that share a row with it.
+// forbidden[c] == j marks the color c as not available for the column j.
+void color_column(const pattern_adjacency &adj, size_type j, std::vector<size_type> &colors,
+                  std::vector<size_type> &forbidden)
+{
+    for (auto i : adj.m_cols[j]) {
+        for (auto k : adj.m_rows[i]) {
+            if (colors[k] != uncolored) {
+                forbidden[colors[k]] = j;
+            }
+        }
+    }
+    size_type c = 0u;
+    while (forbidden[c] == j) {
+        ++c;
+    }
+    colors[j] = c;
+}
+
+size_type count_colors(const std::vector<size_type> &colors)
+{
+    size_type retval = 0u;
+    for (auto c : colors) {
+        retval = std::max(retval, c + 1u);
+    }
+    return retval;
+}
+
+// Greedy coloring, visiting the columns in the given order.
+std::vector<size_type> greedy_coloring(const pattern_adjacency &adj, const std::vector<size_type> &order)
+{
+    const auto nx = adj.m_cols.size();
+    std::vector<size_type> colors(nx, uncolored), forbidden(nx, uncolored);
+    for (auto j : order) {
+        color_column(adj, j, colors, forbidden);
+    }
+    return colors;
+}
+
+// Greedy coloring in the incidence degree order: the next column colored is the one sharing rows with the largest
+// number of columns already colored (ties broken in favour of the largest degree).
+std::vector<size_type> incidence_degree_coloring(const pattern_adjacency &adj, const std::vector<size_type> &degree)
+{
+    const auto nx = adj.m_cols.size();
+    std::vector<size_type> colors(nx, uncolored), forbidden(nx, uncolored), incidence(nx, 0u);
+    // The queue stores (incidence, degree, column) tuples: the entries made stale by later increments of the
+    // incidence of the same column are skipped when popped.
+    using item = std::tuple<size_type, size_type, size_type>;
+    std::priority_queue<item> queue;
+    for (size_type j = 0u; j < nx; ++j) {
+        queue.emplace(0u, degree[j], j);
+    }
+    while (!queue.empty()) {
+        const auto top = queue.top();
+        queue.pop();
+        const auto j = std::get<2>(top);
+        if (colors[j] != uncolored || std::get<0>(top) != incidence[j]) {
+            continue;
+        }
+        color_column(adj, j, colors, forbidden);
+        for (auto i : adj.m_cols[j]) {
+            for (auto k : adj.m_rows[i]) {
+                if (colors[k] == uncolored) {
+                    queue.emplace(++incidence[k], degree[k], k);
+                }
+            }
+        }
+    }
+    return colors;
+}
+
+// The forward finite-difference step for x_j, stepping backward if stepping forward would leave the box (and
+// stepping backward would not).
+double fd_step(double x, double lb, double ub)
+{
+    auto step = std::sqrt(std::numeric_limits<double>::epsilon()) * std::max(1., std::abs(x));
+    if (x + step > ub && x - step >= lb) {
+        step = -step;
+    }
+    return step;
+}
+} // namespace
+
+std::vector<pagmo::vector_double::size_type> cpr_coloring(const pagmo::sparsity_pattern &sp,
+                                                          pagmo::vector_double::size_type nx)
+{
+    const pattern_adjacency adj(sp, nx);
+    // No coloring can use fewer colors than the number of nonzeros in a row.
+    size_type lower_bound = 0u, work = 0u;
+    for (const auto &r : adj.m_rows) {
+        lower_bound = std::max(lower_bound, static_cast<size_type>(r.size()));
+        work += r.size() * r.size();
+    }
+    // The greedy coloring in the natural order of the columns is optimal for dense (and many banded) patterns.
+    std::vector<size_type> order(nx);
+    std::iota(order.begin(), order.end(), size_type(0));
+    auto best = greedy_coloring(adj, order);
+    auto best_ncolors = count_colors(best);
+    // Otherwise, we try also the largest-first and the incidence degree orderings, keeping the coloring with
+    // the fewest colors, unless the pattern is so large that the additional orderings would be too costly
+    // (each one costs as much as the natural one, which is proportional to work).
+    if (best_ncolors > lower_bound && work <= 100000000u) {
+        // An upper bound of the number of columns sharing a row with each column.
+        std::vector<size_type> degree(nx, 0u);
+        for (size_type j = 0u; j < nx; ++j) {
+            for (auto i : adj.m_cols[j]) {
+                degree[j] += adj.m_rows[i].size() - 1u;
+            }
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [&degree](size_type a, size_type b) { return degree[a] > degree[b]; });
+        for (auto colors : {greedy_coloring(adj, order), incidence_degree_coloring(adj, degree)}) {
+            const auto ncolors = count_colors(colors);
+            if (ncolors < best_ncolors) {
+                best = std::move(colors);
+                best_ncolors = ncolors;
+            }
+        }
+    }
+    return best;
+}
+
+std::shared_ptr<const std::vector<pagmo::vector_double::size_type>>
+cached_cpr_coloring(const pagmo::sparsity_pattern &sp, pagmo::vector_double::size_type nx)
+{
+    using entry = std::tuple<pagmo::vector_double::size_type, pagmo::sparsity_pattern,
+                             std::shared_ptr<const std::vector<pagmo::vector_double::size_type>>>;
+    // The colorings of the most recently used patterns, the most recent first.
+    static std::mutex mutex;
+    static std::list<entry> cache;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (std::get<0>(*it) == nx && std::get<1>(*it) == sp) {
+                cache.splice(cache.begin(), cache, it);
+                return std::get<2>(cache.front());
+            }
+        }
+    }
+    // The coloring is computed without holding the lock: two threads might compute the same coloring
+    // concurrently, which is harmless.
+    auto colors = std::make_shared<const std::vector<pagmo::vector_double::size_type>>(cpr_coloring(sp, nx));
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.emplace_front(nx, sp, colors);
+    if (cache.size() > 16u) {
+        cache.pop_back();
+    }
+    return colors;
+}
+
+fd_gradient::fd_gradient(const pagmo::problem &p, pagmo::sparsity_pattern sp, pagmo::bfe b)
+    : m_sp(std::move(sp)), m_colors(cached_cpr_coloring(m_sp, p.get_nx())), m_ncolors(count_colors(*m_colors)),
+      m_lb(p.get_lb()), m_ub(p.get_ub()), m_bfe(std::move(b))
+{
+}
+
+pagmo::vector_double fd_gradient::operator()(const pagmo::problem &p, const pagmo::vector_double &x,
+                                             const pagmo::vector_double &f) const
+{
+    const auto &colors = *m_colors;
+    const auto nx = x.size();
+    const auto nf = f.size();
+    // The perturbed points, one per color, stored contiguously as required by pagmo::bfe, and the actual
+    // steps taken along each component.
+    pagmo::vector_double dvs(m_ncolors * nx);
+    pagmo::vector_double h(nx);
+    for (size_type c = 0u; c < m_ncolors; ++c) {
+        std::copy(x.begin(), x.end(), dvs.begin() + static_cast<std::ptrdiff_t>(c * nx));
+    }
+    for (size_type j = 0u; j < nx; ++j) {
+        auto &xj = dvs[colors[j] * nx + j];
+        xj = x[j] + fd_step(x[j], m_lb[j], m_ub[j]);
+        // The step actually representable in floating point.
+        h[j] = xj - x[j];
+    }
+    const auto fs = m_bfe(p, dvs);
+    if (fs.size() != m_ncolors * nf) {
+        pagmo_throw(std::invalid_argument, "The batch fitness evaluation returned " + std::to_string(fs.size())
+                                               + " values, while " + std::to_string(m_ncolors * nf)
+                                               + " were expected in the finite-difference gradient computation");
+    }
+    pagmo::vector_double retval(m_sp.size());
+    for (size_type k = 0u; k < m_sp.size(); ++k) {
+        const auto i = m_sp[k].first;
+        const auto j = m_sp[k].second;
+        retval[k] = (fs[colors[j] * nf + i] - f[i]) / h[j];
+    }
+    return retval;
+}
+
+fd_hessians::fd_hessians(const pagmo::problem &p, std::size_t nthreads)
+    : m_lb(p.get_lb()), m_ub(p.get_ub()), m_gevals0(p.get_gevals())
+{
+    const auto nx = p.get_nx();
+    const auto gs = p.gradient_sparsity();
+    const auto hs = p.hessians_sparsity();
+    // The position of each nonzero of the gradient.
+    std::map<std::pair<size_type, size_type>, size_type> gpos;
+    for (size_type k = 0u; k < gs.size(); ++k) {
+        gpos.emplace(gs[k], k);
+    }
+    auto find_gpos = [&gpos](size_type f, size_type x) {
+        const auto it = gpos.find({f, x});
+        return it == gpos.end() ? npos : it->second;
+    };
+    // The entries of each hessian and the symmetrised union of the patterns, which is the one to be colored.
+    pagmo::sparsity_pattern merged;
+    m_entries.resize(hs.size());
+    for (size_type f = 0u; f < hs.size(); ++f) {
+        for (const auto &ij : hs[f]) {
+            m_entries[f].push_back(entry{ij.first, ij.second, find_gpos(f, ij.first), find_gpos(f, ij.second)});
+            merged.push_back(ij);
+            merged.emplace_back(ij.second, ij.first);
+        }
+    }
+    std::sort(merged.begin(), merged.end());
+    merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+    m_colors = cached_cpr_coloring(merged, nx);
+    m_ncolors = count_colors(*m_colors);
+    // The threads, and the copies of the problem used by all of them but the calling one.
+    if (p.get_thread_safety() == pagmo::thread_safety::none) {
+        nthreads = 1u;
+    }
+    nthreads = std::max(std::size_t(1), std::min(nthreads, static_cast<std::size_t>(m_ncolors)));
+    if (p.get_thread_safety() != pagmo::thread_safety::constant) {
+        m_copies.resize(nthreads - 1u, p);
+    }
+    m_pool = std::make_unique<thread_pool>(nthreads);
+}
+
+unsigned long long fd_hessians::get_copies_gevals() const
+{
+    unsigned long long retval = 0u;
+    for (const auto &c : m_copies) {
+        retval += c.get_gevals() - m_gevals0;
+    }
+    return retval;
+}
+
+std::vector<pagmo::vector_double> fd_hessians::operator()(const pagmo::problem &p, const pagmo::vector_double &x,
+                                                          const pagmo::vector_double &g) const
+{
+    const auto &colors = *m_colors;
+    const auto nx = x.size();
+    // The perturbed points, one per color, and the actual steps taken along each component.
+    std::vector<pagmo::vector_double> dvs(m_ncolors, x);
+    pagmo::vector_double h(nx);
+    for (size_type j = 0u; j < nx; ++j) {
+        auto &xj = dvs[colors[j]][j];
+        xj = x[j] + fd_step(x[j], m_lb[j], m_ub[j]);
+        h[j] = xj - x[j];
+    }
+    // The gradients at the perturbed points are computed concurrently. If the problem is not thread safe, each
+    // thread but the calling one uses its own copy.
+    std::vector<pagmo::vector_double> dg(m_ncolors);
+    m_pool->run(m_ncolors, [&](std::size_t t, std::size_t c) {
+        const auto &pt = (t == 0u || m_copies.empty()) ? p : m_copies[t - 1u];
+        dg[c] = pt.gradient(dvs[c]);
+        if (dg[c].size() != g.size()) {
+            pagmo_throw(std::invalid_argument, "The gradient at a perturbed point has " + std::to_string(dg[c].size())
+                                                   + " components, while " + std::to_string(g.size())
+                                                   + " were expected in the finite-difference hessians computation");
+        }
+        for (size_type k = 0u; k < g.size(); ++k) {
+            dg[c][k] -= g[k];
+        }
+    });
+    // The derivative of the component gk of the gradient with respect to x_j, estimated along the color of j.
+    auto d = [&](size_type gk, size_type j) { return gk == npos ? 0. : dg[colors[j]][gk] / h[j]; };
+    std::vector<pagmo::vector_double> retval(m_entries.size());
+    for (size_type f = 0u; f < m_entries.size(); ++f) {
+        retval[f].resize(m_entries[f].size());
+        for (size_type e = 0u; e < m_entries[f].size(); ++e) {
+            const auto &en = m_entries[f][e];
+            // Off the diagonal, we average the two estimates of the symmetric entry.
+            retval[f][e] = en.m_i == en.m_j ? d(en.m_gi, en.m_j) : .5 * (d(en.m_gi, en.m_j) + d(en.m_gj, en.m_i));
+        }
+    }
+    return retval;
+}
+
+} // namespace detail
+} // namespace ppnf
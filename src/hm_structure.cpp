@@ -0,0 +1,239 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/hm_structure.hpp>
+#include <pagmo_plugins_nonfree/detail/parallel_for.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+
+namespace
+{
+using size_type = pagmo::vector_double::size_type;
+} // namespace
+
+// Builds the structure of the hessian of the lagrangian (see hm_structure) from the hessians sparsity patterns hs.
+// The patterns are merged in a single pass via a k-way merge (a heap holding the next nonzero of each pattern), which
+// also yields the position in the merged pattern of each nonzero, and the off-diagonal part of the merged pattern is
+// then put in the WORHP (column-major) order via a counting sort on the columns.
+hm_structure build_hm_structure(const std::vector<pagmo::sparsity_pattern> &hs, size_type dim)
+{
+    hm_structure retval;
+    // The offset of each pattern in the plan.
+    std::vector<size_type> offsets(hs.size() + 1u, 0u);
+    for (decltype(hs.size()) i = 0u; i < hs.size(); ++i) {
+        offsets[i + 1u] = offsets[i] + hs[i].size();
+    }
+    // The order in which the nonzeros of each pattern are visited: the natural one, unless the pattern is not
+    // sorted (user-provided patterns need not be).
+    std::vector<std::vector<size_type>> orders(hs.size());
+    for (decltype(hs.size()) i = 0u; i < hs.size(); ++i) {
+        if (!std::is_sorted(hs[i].begin(), hs[i].end())) {
+            orders[i].resize(hs[i].size());
+            std::iota(orders[i].begin(), orders[i].end(), size_type(0));
+            std::sort(orders[i].begin(), orders[i].end(),
+                      [&hs, i](size_type k1, size_type k2) { return hs[i][k1] < hs[i][k2]; });
+        }
+    }
+    auto nz_idx = [&orders](size_type i, size_type n) { return orders[i].empty() ? n : orders[i][n]; };
+    // The k-way merge. The heap holds, for each pattern not yet exhausted, its next nonzero, the index of the
+    // pattern and the number of its nonzeros already visited.
+    using heap_entry = std::tuple<pagmo::sparsity_pattern::value_type, size_type, size_type>;
+    std::priority_queue<heap_entry, std::vector<heap_entry>, std::greater<heap_entry>> heap;
+    for (decltype(hs.size()) i = 0u; i < hs.size(); ++i) {
+        if (!hs[i].empty()) {
+            heap.emplace(hs[i][nz_idx(i, 0u)], i, 0u);
+        }
+    }
+    // The position in the merged pattern of each nonzero of the pagmo hessians.
+    std::vector<size_type> merged_pos(offsets.back());
+    while (!heap.empty()) {
+        const auto top = heap.top();
+        heap.pop();
+        const auto &rc = std::get<0>(top);
+        const auto i = std::get<1>(top);
+        const auto n = std::get<2>(top);
+        if (retval.m_merged.empty() || retval.m_merged.back() != rc) {
+            retval.m_merged.push_back(rc);
+        }
+        merged_pos[offsets[i] + nz_idx(i, n)] = retval.m_merged.size() - 1u;
+        if (n + 1u < hs[i].size()) {
+            heap.emplace(hs[i][nz_idx(i, n + 1u)], i, n + 1u);
+        }
+    }
+    // The WORHP order of the off-diagonal nonzeros of the merged pattern: by column, then by row. As the merged
+    // pattern is sorted by row, a stable counting sort on the columns suffices.
+    std::vector<size_type> col_ptr(dim + 1u, 0u);
+    for (const auto &rc : retval.m_merged) {
+        if (rc.first != rc.second) {
+            ++col_ptr[rc.second + 1u];
+        }
+    }
+    std::partial_sum(col_ptr.begin(), col_ptr.end(), col_ptr.begin());
+    retval.m_idx_map.resize(col_ptr.back());
+    // The position in HM.val of each nonzero of the merged pattern. The diagonal follows the off-diagonal part.
+    std::vector<size_type> slot(retval.m_merged.size());
+    for (decltype(retval.m_merged.size()) k = 0u; k < retval.m_merged.size(); ++k) {
+        const auto &rc = retval.m_merged[k];
+        if (rc.first == rc.second) {
+            slot[k] = col_ptr.back() + rc.first;
+        } else {
+            slot[k] = col_ptr[rc.second]++;
+            retval.m_idx_map[slot[k]] = k;
+        }
+    }
+    retval.m_plan.resize(merged_pos.size());
+    for (decltype(merged_pos.size()) k = 0u; k < merged_pos.size(); ++k) {
+        retval.m_plan[k] = slot[merged_pos[k]];
+    }
+    return retval;
+}
+
+std::shared_ptr<const hm_structure> cached_hm_structure(const std::vector<pagmo::sparsity_pattern> &hs, size_type dim)
+{
+    using entry = std::tuple<size_type, std::vector<pagmo::sparsity_pattern>, std::shared_ptr<const hm_structure>>;
+    // The structures of the most recently used patterns, the most recent first. As they can be large, only a few
+    // are kept.
+    static std::mutex mutex;
+    static std::list<entry> cache;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (std::get<0>(*it) == dim && std::get<1>(*it) == hs) {
+                cache.splice(cache.begin(), cache, it);
+                return std::get<2>(cache.front());
+            }
+        }
+    }
+    // The structure is built without holding the lock: two threads might build the same structure concurrently,
+    // which is harmless.
+    auto str = std::make_shared<const hm_structure>(build_hm_structure(hs, dim));
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.emplace_front(dim, hs, str);
+    if (cache.size() > 4u) {
+        cache.pop_back();
+    }
+    return str;
+}
+
+hm_gather::hm_gather(const std::vector<size_type> &plan, const std::vector<pagmo::sparsity_pattern> &hs,
+                     size_type nslots, size_type nthreads)
+    : m_ptr(nslots + 1u, 0u), m_h(plan.size()), m_nz(plan.size())
+{
+    // Counting sort of the terms by their target element, stable with respect to the plan order.
+    for (auto slot : plan) {
+        ++m_ptr[slot + 1u];
+    }
+    std::partial_sum(m_ptr.begin(), m_ptr.end(), m_ptr.begin());
+    auto next = m_ptr;
+    size_type k = 0u;
+    for (decltype(hs.size()) i = 0u; i < hs.size(); ++i) {
+        for (decltype(hs[i].size()) j = 0u; j < hs[i].size(); ++j, ++k) {
+            const auto pos = next[plan[k]]++;
+            m_h[pos] = i;
+            m_nz[pos] = j;
+        }
+    }
+    // The chunk boundaries.
+    nthreads = std::max(size_type(1), std::min(nthreads, nslots));
+    m_bounds.push_back(0u);
+    for (decltype(nthreads) t = 1u; t < nthreads; ++t) {
+        const auto target = plan.size() * t / nthreads;
+        const auto it = std::lower_bound(m_ptr.begin() + static_cast<std::ptrdiff_t>(m_bounds.back()),
+                                         m_ptr.end() - 1, target);
+        m_bounds.push_back(static_cast<size_type>(it - m_ptr.begin()));
+    }
+    m_bounds.push_back(nslots);
+    m_pool = std::make_unique<thread_pool>(m_bounds.size() - 1u);
+}
+
+void hm_gather::operator()(const std::vector<pagmo::vector_double> &h, double w0, const double *mu, double *val) const
+{
+    // Each thread sums, in a fixed order, the terms of its own chunk of val.
+    m_pool->run(m_bounds.size() - 1u, [this, &h, w0, mu, val](std::size_t, std::size_t t) {
+        for (auto i = m_bounds[t]; i < m_bounds[t + 1u]; ++i) {
+            double v = 0.;
+            for (auto k = m_ptr[i]; k < m_ptr[i + 1u]; ++k) {
+                v += (m_h[k] == 0u ? w0 : mu[m_h[k] - 1u]) * h[m_h[k]][m_nz[k]];
+            }
+            val[i] = v;
+        }
+    });
+}
+
+void hm_scatter(const std::vector<size_type> &plan, const std::vector<pagmo::vector_double> &h, double w0,
+                const double *mu, double *val, size_type nnz)
+{
+    // The contribution of each nonzero of the pagmo hessians is added to its precomputed position. The diagonal
+    // elements not in any pattern remain zero.
+    std::fill(val, val + nnz, 0.);
+    const auto *slot = plan.data();
+    for (decltype(h.size()) i = 0u; i < h.size(); ++i) {
+        const double w = i == 0u ? w0 : mu[i - 1u];
+        for (decltype(h[i].size()) j = 0u; j < h[i].size(); ++j) {
+            val[slot[j]] += w * h[i][j];
+        }
+        slot += h[i].size();
+    }
+}
+
+} // namespace detail
+} // namespace ppnf
@@ -44,15 +44,19 @@ You should have received copies of the GNU General Public License and the
 GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
 see https://www.gnu.org/licenses/. */
 
-#include <algorithm> // std::min_element
-#include <boost/dll/import.hpp>
+#include <algorithm> // std::min_element, std::binary_search
 #include <boost/dll/shared_library.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/serialization/map.hpp>
+#include <cmath> // std::isnan, std::floor, std::abs
+#include <deque>
 #include <exception>
 #include <iomanip>
 #include <limits> // std::numeric_limits
+#include <map>
+#include <memory>
 #include <mutex>
+#include <numeric> // std::iota
 #include <pagmo/algorithm.hpp>
 #include <pagmo/algorithms/not_population_based.hpp>
 #include <pagmo/config.hpp>
@@ -68,9 +72,16 @@ see https://www.gnu.org/licenses/. */
 #include <tuple>
 #include <type_traits> // std::false_type
 #include <unordered_map>
+#include <utility> // std::pair
 #include <vector>
 
+#include <pagmo_plugins_nonfree/detail/eval_cache.hpp>
+#include <pagmo_plugins_nonfree/detail/fd_gradient.hpp>
+#include <pagmo_plugins_nonfree/detail/library_registry.hpp>
+#include <pagmo_plugins_nonfree/detail/output_sink.hpp>
+#include <pagmo_plugins_nonfree/detail/sparsity_detection.hpp>
 #include <pagmo_plugins_nonfree/snopt7.hpp>
+#include <pagmo_plugins_nonfree/udp_extensions.hpp>
 
 extern "C" {
 #include "../include/pagmo_plugins_nonfree/bogus_libs/snopt7_c_lib/snopt7_c.h"
@@ -87,24 +98,318 @@ namespace ppnf
 {
 namespace detail
 {
-// We use this to ensure deleteSNOPT is called also if exceptions occur.
+// The symbols of the snopt7_c library used by the plugin, as plain C function pointers. An instance of this
+// struct is created only once per library and API version (see detail::library_registry) and it is then shared,
+// immutable, among all the evolve() calls. The struct also holds a handle to the library, so that the pointers
+// stay valid for its whole lifetime.
 template <typename snProblem>
-struct sn_problem_raii {
-    sn_problem_raii(snProblem *p, char *a, char *b, int n,
-                    std::function<void(snProblem *, char *, char *, int)> &snInit,
-                    std::function<void(snProblem *)> &deleteSNOPT)
-        : m_prob(p), m_deleteSNOPT(deleteSNOPT)
+struct snopt7_symbols {
+    using snInit_t = void (*)(snProblem *, char *, char *, int);
+    using setIntParameter_t = int (*)(snProblem *, char[], int);
+    using setRealParameter_t = int (*)(snProblem *, char[], double);
+    using deleteSNOPT_t = void (*)(snProblem *);
+    using solveA_t = int (*)(snProblem *, int, int, int, double, int, snFunA, int, int *, int *, double *, int, int *,
+                             int *, double *, double *, double *, double *, double *, int *, double *, double *, int *,
+                             double *, int *, int *, double *);
+
+    explicit snopt7_symbols(const boost::dll::shared_library &libsnopt7_c)
+        : m_lib(libsnopt7_c),
+          // We load the symbols we need for the SNOPT7 plugin
+          snInit(get<snInit_t>("snInit")), setIntParameter(get<setIntParameter_t>("setIntParameter")),
+          setRealParameter(get<setRealParameter_t>("setRealParameter")), deleteSNOPT(get<deleteSNOPT_t>("deleteSNOPT")),
+          solveA(get<solveA_t>("solveA"))
+    {
+    }
+    // Locates the symbol name in the library and returns it as a function pointer of type FuncPtr.
+    template <typename FuncPtr>
+    FuncPtr get(const char *name) const
+    {
+        return &m_lib.get<std::remove_pointer_t<FuncPtr>>(name);
+    }
+    boost::dll::shared_library m_lib;
+    snInit_t snInit;
+    setIntParameter_t setIntParameter;
+    setRealParameter_t setRealParameter;
+    deleteSNOPT_t deleteSNOPT;
+    solveA_t solveA;
+};
+
+inline std::vector<char> s_to_C(const std::string &in)
+{
+    std::vector<char> retval(in.begin(), in.end());
+    retval.push_back('\0');
+    return retval;
+}
+
+// Everything that, if changed, requires the SNOPT7 workspace to be initialised anew: the problem name and the
+// screen output flag (both passed to snInit), the problem dimensions (n, nF) and the sparsity (iGfun, jGvar).
+using snopt7_signature = std::tuple<std::string, bool, int, int, std::vector<int>, std::vector<int>>;
+
+// Base class for the version-dependent SNOPT7 workspaces.
+struct snopt7_workspace_base {
+    virtual ~snopt7_workspace_base() = default;
+};
+
+// An SNOPT7 workspace (i.e. an snProblem) together with the information needed to decide whether it can be re-used.
+// The destructor ensures deleteSNOPT is called (if needed) also if exceptions occur.
+template <typename snProblem>
+struct sn_workspace final : snopt7_workspace_base {
+    explicit sn_workspace(const snopt7_symbols<snProblem> &symbols) : m_symbols(&symbols) {}
+    sn_workspace(const sn_workspace &) = delete;
+    sn_workspace &operator=(const sn_workspace &) = delete;
+    ~sn_workspace()
     {
-        snInit(p, a, b, n);
+        reset();
+    }
+    // Calls deleteSNOPT and forgets the options applied.
+    void reset()
+    {
+        if (m_initialized) {
+            m_symbols->deleteSNOPT(&m_prob);
+            m_initialized = false;
+        }
+        m_int_opts.clear();
+        m_real_opts.clear();
+    }
+    // Ensures the workspace is initialised for the problem identified by sig and that, in it, the options are exactly
+    // those in int_opts and real_opts. snInit is called only if the workspace was never initialised, if the signature
+    // changed or if an option previously applied is not requested anymore (there is no way to reset an option to its
+    // default other than calling snInit). Otherwise, only the options whose values changed are applied.
+    void setup(const snopt7_signature &sig, const std::map<std::string, int> &int_opts,
+               const std::map<std::string, double> &real_opts)
+    {
+        const auto removed = [](const auto &applied, const auto &requested) {
+            return std::any_of(applied.begin(), applied.end(),
+                               [&requested](const auto &p) { return !requested.count(p.first); });
+        };
+        if (!m_initialized || sig != m_signature || removed(m_int_opts, int_opts) || removed(m_real_opts, real_opts)) {
+            reset();
+            auto problem_name = s_to_C(std::get<0>(sig));
+            char empty_string[] = "";
+            // We init the SNOPT workspace suppressing the file output. TODO: should we allow the file output?
+            m_symbols->snInit(&m_prob, problem_name.data(), empty_string, std::get<1>(sig));
+            m_initialized = true;
+            m_signature = sig;
+        }
+        for (const auto &p : real_opts) {
+            const auto it = m_real_opts.find(p.first);
+            if (it == m_real_opts.end() || it->second != p.second) {
+                auto option_name = s_to_C(p.first);
+                if (m_symbols->setRealParameter(&m_prob, option_name.data(), p.second) > 0) {
+                    pagmo_throw(std::invalid_argument,
+                                "The option '" + p.first + "' was requested by the user to be set to the float value "
+                                    + std::to_string(p.second)
+                                    + ", but SNOPT7 interface returned an error. Did you mispell the option name?");
+                }
+                m_real_opts[p.first] = p.second;
+            }
+        }
+        for (const auto &p : int_opts) {
+            const auto it = m_int_opts.find(p.first);
+            if (it == m_int_opts.end() || it->second != p.second) {
+                auto option_name = s_to_C(p.first);
+                if (m_symbols->setIntParameter(&m_prob, option_name.data(), p.second) > 0) {
+                    pagmo_throw(std::invalid_argument,
+                                "The option '" + p.first + "' was requested by the user to be set to the int value "
+                                    + std::to_string(p.second)
+                                    + ", but SNOPT7 interface returned an error. Did you mispell the option name?");
+                }
+                m_int_opts[p.first] = p.second;
+            }
+        }
     }
-    ~sn_problem_raii()
+    snProblem m_prob;
+    bool m_initialized = false;
+    const snopt7_symbols<snProblem> *m_symbols;
+    snopt7_signature m_signature;
+    // The options currently applied to m_prob.
+    std::map<std::string, int> m_int_opts;
+    std::map<std::string, double> m_real_opts;
+};
+
+// The persistent workspace, shared among copies of an snopt7 object. The mutex guarantees exclusive use:
+// an evolve() finding it already in use will fall back to a temporary workspace.
+struct snopt7_workspace {
+    std::mutex m_mutex;
+    std::unique_ptr<snopt7_workspace_base> m_ws;
+};
+
+// The early termination criteria (see snopt7::set_stop_criterion()) together with the state needed to check them
+// across the major iterations.
+struct stop_data {
+    explicit stop_data(const std::map<std::string, double> &criteria)
     {
-        m_deleteSNOPT(m_prob);
+        const auto get = [&criteria](const std::string &name, double def) {
+            const auto it = criteria.find(name);
+            return it == criteria.end() ? def : it->second;
+        };
+        m_has_target = criteria.count("Target objective") > 0u;
+        m_target = get("Target objective", 0.);
+        m_primal_feasibility = get("Primal feasibility", 0.) != 0.;
+        m_max_prinf = get("Max primal infeasibility", std::numeric_limits<double>::infinity());
+        m_max_duinf = get("Max dual infeasibility", std::numeric_limits<double>::infinity());
+        m_check_iteration = get("Infeasibility check iteration", 0.);
+        m_stall_iterations = static_cast<std::deque<double>::size_type>(get("Stall iterations", 0.));
+        m_stall_tolerance = get("Stall tolerance", 0.);
     }
-    snProblem *m_prob;
-    std::function<void(snProblem *)> &m_deleteSNOPT;
+    bool m_has_target;
+    double m_target;
+    bool m_primal_feasibility;
+    double m_max_prinf;
+    double m_max_duinf;
+    double m_check_iteration;
+    std::deque<double>::size_type m_stall_iterations;
+    double m_stall_tolerance;
+    // The merit function at the last major iterations, and the last major iteration seen.
+    std::deque<double> m_merit;
+    int m_last_major = -1;
+    // The criterion that stopped SNOPT7 (empty if none did).
+    std::string m_reason;
 };
 
+// Checks the early termination criteria at the end of a major iteration, returning true if SNOPT7 should stop.
+inline bool snopt_stop(user_data &info, const int KTcond[], int nMajor, double fMrt, double prInf, double duInf,
+                       const double x[])
+{
+    auto &sd = *info.m_stop;
+    if (sd.m_primal_feasibility && KTcond[0]) {
+        sd.m_reason = "the current point is primal feasible";
+        return true;
+    }
+    if (nMajor >= sd.m_check_iteration && (prInf > sd.m_max_prinf || duInf > sd.m_max_duinf)) {
+        sd.m_reason = "the infeasibilities exceed their limits at major iteration " + std::to_string(nMajor);
+        return true;
+    }
+    if (sd.m_stall_iterations && nMajor != sd.m_last_major) {
+        sd.m_last_major = nMajor;
+        sd.m_merit.push_back(fMrt);
+        if (sd.m_merit.size() > sd.m_stall_iterations) {
+            const auto f0 = sd.m_merit.front();
+            sd.m_merit.pop_front();
+            // NOTE: written so that a NaN merit function counts as a stall.
+            if (!(f0 - fMrt > sd.m_stall_tolerance * std::max(1., std::abs(f0)))) {
+                sd.m_reason = "the merit function stalled over " + std::to_string(sd.m_stall_iterations)
+                              + " major iterations";
+                return true;
+            }
+        }
+    }
+    if (sd.m_has_target) {
+        // The fitness at the current point is usually in the cache, as it was requested by SNOPT7.
+        auto &p = info.m_prob;
+        auto &dv = info.m_dv;
+        std::copy(x, x + p.get_nx(), dv.begin());
+        const auto &fit = info.m_cache->m_f.get(dv, [&p](const pagmo::vector_double &y) { return p.fitness(y); });
+        if (fit[0] <= sd.m_target && p.feasibility_f(fit)) {
+            sd.m_reason = "the objective target was reached";
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void snopt_stop_wrapper_76(int *iAbort, int KTcond[], int *, int *, int *, int *, int *, int *, int *, int *,
+                                  int *, int *, int *, int *, int *nMajor, int *, int *, double *, int *, double *,
+                                  double *, double *fMrt, double *, double *, double *prInf, double *duInf, double *,
+                                  double *, int[], int *, int *, int[], int[], double[], int *, double[], double[],
+                                  double[], double[], double[], double[], double[], double[], double[], double[],
+                                  double x[], char[], int *, int iu[], int *, double[], int *, char[], int *, int[],
+                                  int *, double[], int *)
+{
+    auto &info = *(static_cast<detail::user_data *>(static_cast<void *>(iu)));
+    try {
+        if (snopt_stop(info, KTcond, *nMajor, *fMrt, *prInf, *duInf, x)) {
+            *iAbort = 1;
+        }
+    } catch (...) {
+        *iAbort = 1;
+        info.m_eptr = std::current_exception();
+    }
+}
+
+inline void snopt_stop_wrapper_77(int *iAbort, int KTcond[], int *, int *, int *, int *, int *, int *, int *, int *,
+                                  int *, int *, int *, int *, int *nMajor, int *, int *, double *, int *, double *,
+                                  double *, double *, double *fMrt, double *, double *, double *prInf, double *duInf,
+                                  double *, double *, int[], int *, int *, int[], int[], double[], int *, double[],
+                                  double[], double[], double[], double[], double[], double[], double[], double[],
+                                  double[], double[], double x[], char[], int *, int iu[], int *, double[], int *,
+                                  char[], int *, int[], int *, double[], int *)
+{
+    auto &info = *(static_cast<detail::user_data *>(static_cast<void *>(iu)));
+    try {
+        if (snopt_stop(info, KTcond, *nMajor, *fMrt, *prInf, *duInf, x)) {
+            *iAbort = 1;
+        }
+    } catch (...) {
+        *iAbort = 1;
+        info.m_eptr = std::current_exception();
+    }
+}
+
+// Records (and prints) a line of the major iterations log, every info.m_verbosity major iterations.
+inline void snopt_log(user_data &info, int nMajor, double fMrt, double step, double prInf, double duInf, int nS)
+{
+    const auto verb = info.m_verbosity;
+    if (nMajor < 0 || nMajor % static_cast<int>(verb)) {
+        return;
+    }
+    if (!(static_cast<unsigned>(nMajor) / verb % 50u)) {
+        // Every 50 lines print the column names.
+        info.m_sink->print("\n", std::setw(10), "major:", std::setw(15), "merit:", std::setw(15), "step:",
+                           std::setw(15), "prim. inf.:", std::setw(15), "dual inf.:", std::setw(15), "superbasics:",
+                           '\n');
+    }
+    info.m_sink->print(std::setw(10), nMajor, std::setw(15), fMrt, std::setw(15), step, std::setw(15), prInf,
+                       std::setw(15), duInf, std::setw(15), nS, '\n');
+    info.m_major_log.emplace_back(nMajor, fMrt, step, prInf, duInf, nS);
+}
+
+inline void snopt_log_wrapper_76(int *, int *, int *, int[], int *, int *, int *, int *, int *, int *nS, int *,
+                                 int *nMajor, int *, int *, double *, int *, double *, double *, double *fMrt,
+                                 double *, double *step, double *prInf, double *duInf, double *, double *, int[],
+                                 int *, int[], int[], int[], double[], double[], double[], double[], double[],
+                                 double[], double[], char[], int *, int iu[], int *, double[], int *, char[], int *,
+                                 int[], int *, double[], int *)
+{
+    snopt_log(*(static_cast<detail::user_data *>(static_cast<void *>(iu))), *nMajor, *fMrt, *step, *prInf, *duInf,
+              *nS);
+}
+
+inline void snopt_log_wrapper_77(int *, int[], int *, int *, int *, int *, int *, int *, int *nS, int *, int *nMajor,
+                                 int *, int *, double *, int *, double *, double *, double *, double *fMrt, double *,
+                                 double *step, double *prInf, double *duInf, double *, double *, int[], int *, int[],
+                                 int[], int[], double[], double[], double[], double[], double[], double[], double[],
+                                 double[], char[], int *, int iu[], int *, double[], int *, char[], int *, int[],
+                                 int *, double[], int *)
+{
+    snopt_log(*(static_cast<detail::user_data *>(static_cast<void *>(iu))), *nMajor, *fMrt, *step, *prInf, *duInf,
+              *nS);
+}
+
+// Installs the snLog hook recording the major iterations log or, if flag is false, removes it (so that SNOPT7 uses its
+// default).
+inline void set_log_hook(snProblem_76 &prob, bool flag)
+{
+    prob.snLog = flag ? snopt_log_wrapper_76 : nullptr;
+}
+
+inline void set_log_hook(snProblem_77 &prob, bool flag)
+{
+    prob.snLog = flag ? snopt_log_wrapper_77 : nullptr;
+}
+
+// Installs the snSTOP hook checking the early termination criteria or, if flag is false, removes it (so that SNOPT7
+// uses its default).
+inline void set_stop_hook(snProblem_76 &prob, bool flag)
+{
+    prob.snSTOP = flag ? snopt_stop_wrapper_76 : nullptr;
+}
+
+inline void set_stop_hook(snProblem_77 &prob, bool flag)
+{
+    prob.snSTOP = flag ? snopt_stop_wrapper_77 : nullptr;
+}
+
 inline void snopt_fitness_wrapper(int *Status, int *n, double x[], int *needF, int *nF, double F[], int *needG,
                                   int *neG, double G[], char cu[], int *lencu, int iu[], int *leniu, double ru[],
                                   int *lenru)
@@ -126,13 +431,48 @@ inline void snopt_fitness_wrapper(int *Status, int *n, double x[], int *needF, i
     std::copy(x, x + p.get_nx(), dv.begin());
     // We try to call the UDP fitness and gradient
     try {
+        // The fitness and the gradient are looked up in the caches first, as SNOPT7 may request them again at
+        // points already visited.
+        auto &cache = *info.m_cache;
+        const pagmo::vector_double *fit_ptr = nullptr, *grad_ptr = nullptr;
+        const bool need_grad = *needG > 0 && (p.has_gradient() || info.m_fd_gradient);
+        if (*needF > 0 && need_grad && info.m_fitness_and_gradient && !cache.m_f.contains(dv)
+            && !cache.m_g.contains(dv)) {
+            // Both are requested at a new point and the UDP can compute them together.
+            auto fg = fitness_and_gradient(p, info.m_fitness_and_gradient, dv, info.m_grad_size);
+            fit_ptr = &cache.m_f.insert(dv, std::move(fg.first));
+            grad_ptr = &cache.m_g.insert(dv, std::move(fg.second));
+        } else {
+            if (*needF > 0) {
+                fit_ptr = &cache.m_f.get(dv, [&p](const pagmo::vector_double &y) { return p.fitness(y); });
+            }
+            if (need_grad) {
+                grad_ptr = &cache.m_g.get(dv, [&p, &info, &cache](const pagmo::vector_double &y) {
+                    if (info.m_fd_gradient) {
+                        // The gradient is computed by the plugin, differencing the fitness at y.
+                        const auto &f = cache.m_f.get(y, [&p](const pagmo::vector_double &z) { return p.fitness(z); });
+                        return (*info.m_fd_gradient)(p, y, f);
+                    }
+                    return p.gradient(y);
+                });
+            }
+        }
+
         if (*needF > 0) {
-            auto fit = p.fitness(dv);
+            const auto &fit = *fit_ptr;
             for (size_t i = 0u; i < static_cast<size_t>(*nF); ++i) {
                 F[i] = fit[i];
             }
+            if (info.m_linear_sp) {
+                // SNOPT7 adds the linear part to F by itself.
+                const auto &sp = *info.m_linear_sp;
+                const auto &vals = *info.m_linear_vals;
+                for (decltype(sp.size()) k = 0u; k < sp.size(); ++k) {
+                    F[sp[k].first] -= vals[k] * x[sp[k].second];
+                }
+            }
 
-            if (verb && !(f_count % verb)) {
+            if (verb && !info.m_log_majors && !(f_count % verb)) {
                 // Constraints bits.
                 const auto ctol = p.get_c_tol();
                 const auto c1eq
@@ -148,24 +488,54 @@ inline void snopt_fitness_wrapper(int *Status, int *n, double x[], int *needF, i
 
                 if (!(f_count / verb % 50u)) {
                     // Every 50 lines print the column names.
-                    pagmo::print("\n", std::setw(10), "objevals:", std::setw(15), "objval:", std::setw(15),
-                                 "violated:", std::setw(15), "viol. norm:", '\n');
+                    info.m_sink->print("\n", std::setw(10), "objevals:", std::setw(15), "objval:", std::setw(15),
+                                       "violated:", std::setw(15), "viol. norm:", '\n');
                 }
                 // Print to screen the log line.
-                pagmo::print(std::setw(10), f_count + 1u, std::setw(15), fit[0], std::setw(15), nv, std::setw(15), l,
-                             feas ? "" : " i", '\n');
+                info.m_sink->print(std::setw(10), f_count + 1u, std::setw(15), fit[0], std::setw(15), nv,
+                                   std::setw(15), l, feas ? "" : " i", '\n');
                 // Record the log.
-                log.emplace_back(f_count + 1u, fit[0], nv, l, feas);
+                log.push_back(f_count + 1u, fit[0], nv, l, feas);
             }
 
             // Update the counter.
             ++f_count;
         }
 
-        if (*needG > 0 && p.has_gradient()) {
-            auto grad = p.gradient(dv);
-            for (size_t i = 0u; i < static_cast<size_t>(*neG); ++i) {
-                G[i] = grad[i];
+        if (need_grad) {
+            const auto &grad = *grad_ptr;
+            if (info.m_dropped_pos) {
+                // The elements outside the detected gradient sparsity are verified: if one of them is not zero,
+                // SNOPT7 is asked to stop.
+                for (auto k : *info.m_dropped_pos) {
+                    if (!(grad[k] == 0.)) {
+                        info.m_sparsity_mismatch = true;
+                        *Status = -2;
+                        return;
+                    }
+                }
+            }
+            if (info.m_linear_pos) {
+                // The detected constant elements are verified: if one of them changed, SNOPT7 is asked to stop.
+                const auto &pos = *info.m_linear_pos;
+                const auto &vals = *info.m_linear_vals;
+                for (decltype(pos.size()) k = 0u; k < pos.size(); ++k) {
+                    if (!(grad[pos[k]] == vals[k])) {
+                        info.m_linear_mismatch = true;
+                        *Status = -2;
+                        return;
+                    }
+                }
+            }
+            if (info.m_grad_idx) {
+                const auto &idx = *info.m_grad_idx;
+                for (size_t i = 0u; i < static_cast<size_t>(*neG); ++i) {
+                    G[i] = grad[idx[i]];
+                }
+            } else {
+                for (size_t i = 0u; i < static_cast<size_t>(*neG); ++i) {
+                    G[i] = grad[i];
+                }
             }
         }
     } catch (...) {
@@ -175,12 +545,6 @@ inline void snopt_fitness_wrapper(int *Status, int *n, double x[], int *needF, i
 }
 namespace
 {
-std::vector<char> s_to_C(const std::string &in)
-{
-    std::vector<char> retval(in.begin(), in.end());
-    retval.push_back('\0');
-    return retval;
-}
 /// Type for the map containing the association between then snopt7 results and their textual description
 const std::unordered_map<int, std::string> results
     = {{0, "None"},
@@ -223,7 +587,12 @@ const std::unordered_map<int, std::string> results
        {141, "System error - wrong number of basic variables"},
        {142, "System error - error in basis package"}};
 
-std::mutex library_load_mutex;
+/// The early termination criteria (see snopt7::set_stop_criterion()): those whose values are iteration counts,
+/// those whose values must be non-negative and the others.
+const std::vector<std::string> stop_iteration_criteria = {"Infeasibility check iteration", "Stall iterations"};
+const std::vector<std::string> stop_nonnegative_criteria
+    = {"Max primal infeasibility", "Max dual infeasibility", "Stall tolerance"};
+const std::vector<std::string> stop_other_criteria = {"Target objective", "Primal feasibility"};
 } // namespace
 } // namespace detail
 
@@ -262,6 +631,12 @@ snopt7::snopt7(bool screen_output, std::string snopt7_c_library, unsigned minor_
  *    setting *eps_r <= min(c_tol)/||x||_ub*, where *||x||_ub* is an upper bound on the value of *||x||*. Care must be
  *    taken with this approach to ensure *eps_r* is not too small.
  *
+ * .. note::
+ *
+ *    If the UDP declares the constant elements of its gradient (see :c:macro:`PPNF_REGISTER_LINEAR_JACOBIAN`), they
+ *    are passed to SNOPT7 as the linear part of the problem (the A arrays of the snOptA interface) and removed from
+ *    the nonlinear Jacobian.
+ *
  * .. seealso::
  *
  *    https://www-leland.stanford.edu/group/SOL/guides/sndoc7.pdf
@@ -274,6 +649,7 @@ snopt7::snopt7(bool screen_output, std::string snopt7_c_library, unsigned minor_
  *
  * @throws std::invalid_argument in the following cases:
  * - the population's problem is multi-objective or stochastic
+ * - the linear part declared by the population's problem is invalid (see ppnf::register_linear_jacobian())
  * @throws unspecified any exception thrown by the public interface of pagmo::problem or
  * pagmo::not_population_based.
  */
@@ -291,7 +667,9 @@ pagmo::population snopt7::evolve(pagmo::population pop) const
  * This method will set the algorithm's verbosity. If \p n is zero, no output is produced during the
  * optimisation and no logging is performed. If \p n is nonzero, then every \p n objective function evaluations the
  * status of the optimisation will be both printed to screen and recorded internally. See snopt7::log_line_type and
- * snopt7::log_type for information on the logging format. The internal log can be fetched via get_log().
+ * snopt7::log_type for information on the logging format. The internal log can be fetched via get_log() (and its
+ * size bounded via set_log_capacity()). In the
+ * ``"major"`` log mode (see set_log_mode()), major iterations are logged instead of objective function evaluations.
  *
  * @param n the desired verbosity level.
  *
@@ -347,12 +725,152 @@ void snopt7::set_verbosity(unsigned n)
  * See snopt7::log_type for a description of the optimisation log. Logging is turned on/off via
  * set_verbosity().
  *
+ * The log is stored column by column (see get_columnar_log()): the returned lines are built from the columns at the
+ * first call after each change of the log, and then kept until the next change. C++ code processing large logs
+ * should rather access the columns directly, via get_columnar_log(), which involves no copies.
+ *
  * @return a const reference to the log.
  */
 const snopt7::log_type &snopt7::get_log() const
+{
+    auto storage = m_log.storage();
+    if (storage != m_log_lines_storage) {
+        m_log_lines = m_log.lines();
+        m_log_lines_storage = std::move(storage);
+    }
+    return m_log_lines;
+}
+
+/// Get the columnar optimisation log.
+/**
+ * This is the optimisation log as it is stored internally (see snopt7::columnar_log_type), whose columns can be
+ * accessed without copies.
+ *
+ * @return a const reference to the columnar log.
+ */
+const snopt7::columnar_log_type &snopt7::get_columnar_log() const
 {
     return m_log;
 }
+
+/// Set the log capacity.
+/**
+ * By default, the optimisation log is unbounded, and its memory footprint grows with the number of objective
+ * function evaluations. If a capacity is set, the log columns are preallocated at the beginning of evolve(), and when
+ * the log is full every other line recorded so far is discarded: from then on, one line every 2 (4, 8, ...) lines
+ * is recorded. The log thus never holds more than \p n lines, which cover the whole optimisation in chronological
+ * order, and the log is kept without allocating memory during the optimisation. The lines printed to screen are not
+ * affected by the log capacity.
+ *
+ * @param n the log capacity (0 for an unbounded log).
+ *
+ * @throws std::invalid_argument if \p n is 1.
+ */
+void snopt7::set_log_capacity(unsigned n)
+{
+    if (n == 1u) {
+        pagmo_throw(std::invalid_argument, "The log capacity must be either 0 (unbounded) or at least 2");
+    }
+    m_log.set_capacity(n);
+}
+
+/// Get the log capacity.
+/**
+ * @return the log capacity (0 for an unbounded log, see set_log_capacity()).
+ */
+unsigned snopt7::get_log_capacity() const
+{
+    return static_cast<unsigned>(m_log.capacity());
+}
+
+/// Set the log mode.
+/**
+ * In the default ``"evaluation"`` log mode, the status of the optimisation is printed and recorded every
+ * \p n objective function evaluations, \p n being the verbosity (see set_verbosity()), including the trial points of
+ * the line searches. In the ``"major"`` log mode, it is instead printed and recorded every \p n major iterations,
+ * from the data SNOPT7 passes to its snLog hook (see snopt7::major_log_line_type), and the log can be fetched via
+ * get_major_log(). In this mode, no work is done for the log when evaluating the fitness.
+ *
+ * Example (verbosity 1):
+ * @code{.unparsed}
+ *     major:         merit:          step:    prim. inf.:     dual inf.:   superbasics:
+ *          0        48.9451              0            1.3           0.96              0
+ *          1         30.153              1            0.3           0.53              1
+ *          2        17.0142              1       0.000222         0.0141              1
+ *          3         17.014              1        1.1e-07        1.9e-05              1
+ * @endcode
+ *
+ * \verbatim embed:rst:leading-asterisk
+ * .. note::
+ *
+ *    The SNOPT7 screen output (see the constructor) is not affected by the log mode, as the snLog hook is not
+ *    installed when it is active.
+ *
+ * \endverbatim
+ *
+ * @param mode the log mode, either ``"evaluation"`` or ``"major"``.
+ *
+ * @throws std::invalid_argument if \p mode is not one of ``"evaluation"`` and ``"major"``.
+ */
+void snopt7::set_log_mode(const std::string &mode)
+{
+    if (mode != "evaluation" && mode != "major") {
+        pagmo_throw(std::invalid_argument,
+                    "The log mode must be either 'evaluation' or 'major', while '" + mode + "' was provided");
+    }
+    m_log_majors = mode == "major";
+}
+
+/// Get the log mode.
+/**
+ * @return the log mode, either ``"evaluation"`` or ``"major"`` (see set_log_mode()).
+ */
+std::string snopt7::get_log_mode() const
+{
+    return m_log_majors ? "major" : "evaluation";
+}
+
+/// Get the major iterations log.
+/**
+ * See snopt7::major_log_type for a description of the major iterations log.
+ *
+ * @return a const reference to the major iterations log.
+ */
+const snopt7::major_log_type &snopt7::get_major_log() const
+{
+    return m_major_log;
+}
+
+/// Set the screen output mode.
+/**
+ * This method selects how the screen output of the pagmo logging system (see set_verbosity()) is written:
+ * - in the default ``"sync"`` mode, each line is written to screen as soon as it is produced, from within the
+ *   callbacks of SNOPT7,
+ * - in the ``"async"`` mode, the callbacks only queue the data of each line, and a writer thread formats the queued
+ *   lines and writes them to screen in batches. All the lines are written before evolve() returns,
+ * - in the ``"null"`` mode, nothing is written to screen, while the log is still recorded.
+ *
+ * The ``"async"`` and ``"null"`` modes thus keep the screen output latency (e.g., when the standard output is piped
+ * to another process) off the optimisation. The SNOPT7 screen output (see the constructor) is not affected by the
+ * output mode.
+ *
+ * @param mode the screen output mode, one of ``"sync"``, ``"async"`` and ``"null"``.
+ *
+ * @throws std::invalid_argument if \p mode is not one of ``"sync"``, ``"async"`` and ``"null"``.
+ */
+void snopt7::set_output_mode(const std::string &mode)
+{
+    m_output_mode = detail::output_mode_from_string(mode);
+}
+
+/// Get the screen output mode.
+/**
+ * @return the screen output mode, one of ``"sync"``, ``"async"`` and ``"null"`` (see set_output_mode()).
+ */
+std::string snopt7::get_output_mode() const
+{
+    return detail::output_mode_to_string(m_output_mode);
+}
 /// Gets the verbosity level
 /**
  * @return the verbosity level
@@ -387,6 +905,19 @@ std::string snopt7::get_extra_info() const
     } else {
         pagmo::stream(ss, "\n\tScreen output: (snopt7)");
     }
+    pagmo::stream(ss, "\n\tLog mode: ", get_log_mode());
+    pagmo::stream(ss, "\n\tOutput mode: ", get_output_mode());
+    pagmo::stream(ss, "\n\tLog capacity: ", m_log.capacity() ? std::to_string(m_log.capacity()) : "unbounded");
+    pagmo::stream(ss, "\n\tPersistent workspace: ", m_persistent_workspace ? "active" : "inactive");
+    pagmo::stream(ss, "\n\tEvaluation cache size: ", m_cache_size);
+    pagmo::stream(ss, "\n\tBatch fitness evaluator: ", m_bfe ? m_bfe->get_name() : "none");
+    pagmo::stream(ss, "\n\tGradient sparsity detection: ", m_sparsity_detection ? "active" : "inactive");
+    pagmo::stream(ss, "\n\tConstant Jacobian detection: ", m_constant_jacobian_detection ? "active" : "inactive");
+    pagmo::stream(ss, "\n\tWarm start: ", m_warm_start ? "active" : "inactive");
+    pagmo::stream(ss, "\n\tWarm start database size: ", m_warm_start_db.capacity());
+    if (m_stop_criteria.size()) {
+        pagmo::stream(ss, "\n\tEarly termination criteria: ", pagmo::detail::to_string(m_stop_criteria));
+    }
     pagmo::stream(ss, "\n\tLast optimisation return code: ", detail::results.at(m_last_opt_res));
     pagmo::stream(ss, "\n\tIndividual selection ");
     if (boost::any_cast<pagmo::population::size_type>(&m_select)) {
@@ -506,6 +1037,406 @@ int snopt7::get_last_opt_result() const
     return m_last_opt_res;
 }
 
+/// Set the persistent workspace mode.
+/**
+ * By default, each call to evolve() initialises a new SNOPT7 workspace (calling snInit) and releases it at the end
+ * (calling deleteSNOPT). When solving many small problems this setup can dominate the solution time. In the persistent
+ * workspace mode, the initialised workspace is instead kept and re-used by the subsequent calls to evolve(), and
+ * the options are passed to SNOPT7 only when their values changed. The workspace is initialised anew, automatically,
+ * whenever the problem name, dimensions or gradient sparsity change, or when an option previously set is removed.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    Copies of this object share the same persistent workspace. If evolve() is called concurrently on two copies,
+ *    one of them will use a temporary workspace, as if the persistent workspace mode was not active.
+ *
+ * \endverbatim
+ *
+ * Changing the mode (in either direction) releases the persistent workspace, if any.
+ *
+ * @param flag ``true`` to activate the persistent workspace mode, ``false`` to deactivate it.
+ */
+void snopt7::set_persistent_workspace(bool flag)
+{
+    m_persistent_workspace = flag;
+    reset_workspace();
+}
+// Releases the persistent workspace, if any, and creates a new (empty) one if the persistent workspace mode is active.
+void snopt7::reset_workspace()
+{
+    m_workspace = m_persistent_workspace ? std::make_shared<detail::snopt7_workspace>() : nullptr;
+}
+/// Get the persistent workspace mode.
+/**
+ * @return ``true`` if the persistent workspace mode is active, ``false`` otherwise
+ * (see set_persistent_workspace()).
+ */
+bool snopt7::get_persistent_workspace() const
+{
+    return m_persistent_workspace;
+}
+
+/// Set the size of the evaluation caches.
+/**
+ * SNOPT7 may request the fitness and the gradient at points where they were already computed (e.g., when a line
+ * search goes back to a previous iterate). The fitness and the gradients computed by the problem during evolve()
+ * are thus stored in least-recently-used caches, each holding up to \p n points. The points are looked up via a
+ * hash and then compared exactly, so that the cached values are returned only for bitwise identical decision
+ * vectors. A size of zero disables the caches.
+ *
+ * The caches are emptied at each call to evolve(), and their efficiency can be inspected via get_cache_stats().
+ *
+ * @param n the number of points stored in each cache (defaults to 16).
+ */
+void snopt7::set_cache_size(unsigned n)
+{
+    m_cache_size = n;
+}
+
+/// Get the size of the evaluation caches.
+/**
+ * @return the number of points stored in each of the fitness and gradient caches (see set_cache_size()).
+ */
+unsigned snopt7::get_cache_size() const
+{
+    return m_cache_size;
+}
+
+/// Get the evaluation caches statistics.
+/**
+ * The statistics refer to the last call to evolve() and are stored in a map with the keys ``"fitness_hits"``,
+ * ``"fitness_misses"``, ``"gradient_hits"``, ``"gradient_misses"``, ``"hessians_hits"`` and
+ * ``"hessians_misses"`` (the latter two are always zero, as SNOPT7 does not use hessians). The hits count the
+ * values returned from the caches, the misses the values computed by the problem (see set_cache_size()). The map is
+ * empty if evolve() was never called.
+ *
+ * @return the hits and misses counters of the evaluation caches.
+ */
+std::map<std::string, unsigned long long> snopt7::get_cache_stats() const
+{
+    return m_cache_stats;
+}
+
+/// Set the batch fitness evaluator.
+/**
+ * When the problem does not provide the gradient, SNOPT7 estimates it by finite differences, evaluating one
+ * perturbed point at a time from within its callback. After a batch fitness evaluator has been set, the gradient is
+ * instead estimated by the plugin with forward differences: the columns of the gradient sparsity pattern are
+ * grouped via a Curtis-Powell-Reid coloring, so that all the columns in a group can be estimated from a single
+ * perturbed point, and the perturbed points of all the groups are evaluated in a single batch via \p b (thus, for
+ * instance, in parallel when using a pagmo::thread_bfe). The gradient is then passed to SNOPT7 as if it was
+ * provided by the problem. Problems providing the gradient are not affected.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    Each gradient costs as many fitness evaluations as the number of groups. This is smaller than the problem
+ *    dimension only if no row of the gradient sparsity (including the objective) is dense: otherwise, the gain
+ *    comes from the concurrent evaluation of the perturbed points.
+ *
+ * \endverbatim
+ *
+ * @param b the batch fitness evaluator that will be used to evaluate the perturbed points.
+ */
+void snopt7::set_bfe(const pagmo::bfe &b)
+{
+    m_bfe = b;
+}
+
+/// Set the gradient sparsity detection mode.
+/**
+ * When the problem does not provide the gradient sparsity, a dense one is assumed, so that SNOPT7 gets one gradient
+ * element per fitness component and variable. In the gradient sparsity detection mode, the plugin instead probes the
+ * problem at a few random points around the initial guess, in neighbourhoods of increasing radius (up to the magnitude
+ * of the variables, within the bounds): the nonzeros of the gradient, if provided by the problem, or
+ * else the fitness components changed by perturbing each variable are collected, and the resulting pattern is then
+ * validated at a further random point (if the validation fails, the dense pattern is used). The perturbed points are
+ * evaluated via the batch fitness evaluator, if set (see set_bfe()), or via the default pagmo::bfe otherwise.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The detection costs four gradient evaluations if the problem provides the gradient, and four times the
+ *    problem dimension (plus one) fitness evaluations otherwise. Its result is cached (per problem name, dimensions
+ *    and bounds), so that subsequent calls to evolve() on the same problem do not repeat it. As the cache key does
+ *    not identify the problem uniquely, a cached pattern is validated: if the problem provides the gradient, at no
+ *    extra cost, during the run (see below); otherwise, perturbing a few variables (at most eight, cycling through
+ *    all of them across the calls) at a further random point, which costs at most nine fitness evaluations. A
+ *    pattern failing the validation is detected again.
+ *
+ * .. warning::
+ *
+ *    The detection cannot see dependencies that do not manifest themselves at the probe points (e.g., behind
+ *    branches of the fitness function not taken there). If the problem provides the gradient, the elements outside
+ *    the detected pattern are verified to be zero at each gradient evaluation: otherwise, the optimisation is stopped
+ *    and started again with the dense pattern, which is then cached for the problem. If it does not, the missed
+ *    dependencies are silently ignored: problems whose sparsity changes across the search space should provide it
+ *    explicitly.
+ *
+ * \endverbatim
+ *
+ * Problems providing the gradient sparsity are not affected.
+ *
+ * @param flag ``true`` to activate the gradient sparsity detection mode, ``false`` to deactivate it.
+ */
+void snopt7::set_sparsity_detection(bool flag)
+{
+    m_sparsity_detection = flag;
+}
+
+/// Get the gradient sparsity detection mode.
+/**
+ * @return ``true`` if the gradient sparsity detection mode is active, ``false`` otherwise
+ * (see set_sparsity_detection()).
+ */
+bool snopt7::get_sparsity_detection() const
+{
+    return m_sparsity_detection;
+}
+
+/// Set the constant Jacobian detection mode.
+/**
+ * Elements of the gradient that are constant (e.g., those of linear constraints) are best passed to SNOPT7 as the
+ * linear part of the problem (the A arrays of the snOptA interface), so that they are neither requested nor copied at
+ * each iteration. A UDP can declare them (see ppnf::register_linear_jacobian()). In the constant Jacobian detection
+ * mode, the plugin instead finds them for problems providing the gradient but not declaring them: the gradient is
+ * evaluated at the initial guess and at a few random points near it, and the elements having the same value at all
+ * the points are deemed constant.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The detection costs four gradient evaluations. Its result is cached (per problem name, dimensions and bounds),
+ *    so that subsequent calls to evolve() on the same problem do not repeat it.
+ *
+ * .. warning::
+ *
+ *    Elements constant near the initial guess may not be constant elsewhere (e.g., those of piecewise linear
+ *    functions). The detected elements are thus verified at each gradient evaluation during the run: if one of them
+ *    changes, SNOPT7 is stopped, the detected elements are discarded (also for subsequent calls to evolve()) and the
+ *    optimisation is started again without a linear part.
+ *
+ * \endverbatim
+ *
+ * Problems declaring their linear part, or not providing the gradient, are not affected.
+ *
+ * @param flag ``true`` to activate the constant Jacobian detection mode, ``false`` to deactivate it.
+ */
+void snopt7::set_constant_jacobian_detection(bool flag)
+{
+    m_constant_jacobian_detection = flag;
+}
+
+/// Get the constant Jacobian detection mode.
+/**
+ * @return ``true`` if the constant Jacobian detection mode is active, ``false`` otherwise
+ * (see set_constant_jacobian_detection()).
+ */
+bool snopt7::get_constant_jacobian_detection() const
+{
+    return m_constant_jacobian_detection;
+}
+
+/// Set the warm start mode.
+/**
+ * At the end of each call to evolve(), the final number of superbasic variables and the final states and multipliers
+ * of the variables and of the fitness components are stored in this object (see get_warm_start_data()). In the warm
+ * start mode, a subsequent call to evolve() on a problem with the same name and dimensions starts SNOPT7 from them
+ * (a "Warm" start of the snOptA interface, rather than a "Cold" one), so that the basis and multipliers information
+ * is not lost. The initial decision vector is still the one selected from the population.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The warm start is most effective when the same object optimises neighbouring decision vectors of the same problem
+ *    over and over. Problems with different names or dimensions are always started cold.
+ *
+ * \endverbatim
+ *
+ * @param flag ``true`` to activate the warm start mode, ``false`` to deactivate it.
+ */
+void snopt7::set_warm_start(bool flag)
+{
+    m_warm_start = flag;
+}
+
+/// Get the warm start mode.
+/**
+ * @return ``true`` if the warm start mode is active, ``false`` otherwise (see set_warm_start()).
+ */
+bool snopt7::get_warm_start() const
+{
+    return m_warm_start;
+}
+
+/// Set the warm start data.
+/**
+ * Sets the data from which the next call to evolve() will be warm started, if the warm start mode is active (see
+ * set_warm_start()). This allows, e.g., to warm start the optimisation from the final state of a different snopt7
+ * object.
+ *
+ * @param data the warm start data (see snopt7::warm_start_data_type).
+ *
+ * @throws std::invalid_argument if the sizes of the states and of the multipliers are not consistent, or if the
+ * number of superbasic variables is negative.
+ */
+void snopt7::set_warm_start_data(const warm_start_data_type &data)
+{
+    if (std::get<2>(data).size() != std::get<3>(data).size() || std::get<4>(data).size() != std::get<5>(data).size()) {
+        pagmo_throw(std::invalid_argument,
+                    "The warm start data is inconsistent: the states of the variables have size "
+                        + std::to_string(std::get<2>(data).size()) + " and their multipliers have size "
+                        + std::to_string(std::get<3>(data).size()) + ", the states of the fitness components have size "
+                        + std::to_string(std::get<4>(data).size()) + " and their multipliers have size "
+                        + std::to_string(std::get<5>(data).size()));
+    }
+    if (std::get<1>(data) < 0) {
+        pagmo_throw(std::invalid_argument, "The warm start data is inconsistent: the number of superbasic variables is "
+                                               + std::to_string(std::get<1>(data)));
+    }
+    m_warm_start_data = data;
+}
+
+/// Set the size of the warm start database.
+/**
+ * In the warm start mode (see set_warm_start()), only the final state of the last optimisation is reused by default.
+ * With a nonzero size, the final states of the last \p n optimisations are instead stored (together with their final
+ * decision vectors) in a database, and each call to evolve() is warm started from the state stored at the decision
+ * vector nearest to the initial one, among those of the same problem (i.e., with the same name and dimensions). Each
+ * variable is scaled by the width of its bounds, if finite, in the distance computation. The final state of the last
+ * optimisation is used only if the database holds none for the problem.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The database is most effective in multi-start optimisations over clustered basins of attraction, where the
+ *    nearest stored state was likely found in the same basin. Its lookups scan the states stored for the problem,
+ *    and are thus meant for small sizes. When full, the oldest states are evicted.
+ *
+ * \endverbatim
+ *
+ * @param n the maximum number of states stored (zero to disable the database, which is then emptied).
+ */
+void snopt7::set_warm_start_db_size(unsigned n)
+{
+    m_warm_start_db.set_capacity(n);
+}
+
+/// Get the size of the warm start database.
+/**
+ * @return the maximum number of states stored in the warm start database (see set_warm_start_db_size()).
+ */
+unsigned snopt7::get_warm_start_db_size() const
+{
+    return static_cast<unsigned>(m_warm_start_db.capacity());
+}
+
+/// Get the warm start data.
+/**
+ * See snopt7::warm_start_data_type. Before the first call to evolve() (or to set_warm_start_data()), the problem name
+ * is empty, and so are the states and the multipliers.
+ *
+ * @return a const reference to the warm start data.
+ */
+const snopt7::warm_start_data_type &snopt7::get_warm_start_data() const
+{
+    return m_warm_start_data;
+}
+
+/// Set an early termination criterion.
+/**
+ * By default SNOPT7 runs until one of its own stopping conditions is met. The early termination criteria are checked
+ * by the plugin at the end of each major iteration (via the snSTOP hook of SNOPT7), from the data SNOPT7 provides,
+ * and they stop the optimisation as soon as one of them is met, in which case get_last_opt_result() returns 74. They
+ * are meant to cut short the local optimisations that are not promising (e.g., in multi-start schemes), and are:
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * - ``"Target objective"``: stop when the current point is feasible (in the pagmo sense) and its objective is not
+ *   greater than the value set.
+ * - ``"Primal feasibility"``: if nonzero, stop when SNOPT7 deems the current point primal feasible (regardless of the
+ *   optimality conditions).
+ * - ``"Max primal infeasibility"``, ``"Max dual infeasibility"``: stop when the primal (dual) infeasibility computed by
+ *   SNOPT7 exceeds the value set, from the major iteration ``"Infeasibility check iteration"`` (zero if not set) on.
+ * - ``"Stall iterations"``: stop when the merit function did not decrease by more than ``"Stall tolerance"``
+ *   (zero if not set, and relative to the merit function if greater than one in absolute value) over the number of
+ *   major iterations set. Zero deactivates the criterion.
+ *
+ * .. note::
+ *
+ *    The target objective requires the fitness at the current point, which is looked up in the evaluation cache (see
+ *    set_cache_size()) and computed if missing.
+ *
+ * \endverbatim
+ *
+ * @param name the name of the criterion.
+ * @param value the value of the criterion.
+ *
+ * @throws std::invalid_argument if \p name is not one of the criteria above, if \p value is NaN, or if \p value is
+ * negative (or not integral) for the criteria expecting a non-negative (integral) value.
+ */
+void snopt7::set_stop_criterion(const std::string &name, double value)
+{
+    const auto in = [&name](const std::vector<std::string> &names) {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    };
+    const bool iteration = in(detail::stop_iteration_criteria);
+    const bool nonnegative = in(detail::stop_nonnegative_criteria);
+    if (!iteration && !nonnegative && !in(detail::stop_other_criteria)) {
+        pagmo_throw(std::invalid_argument, "The early termination criterion '" + name + "' is not valid");
+    }
+    if (std::isnan(value)) {
+        pagmo_throw(std::invalid_argument, "The early termination criterion '" + name + "' cannot be set to NaN");
+    }
+    if ((iteration || nonnegative) && value < 0.) {
+        pagmo_throw(std::invalid_argument, "The early termination criterion '" + name
+                                               + "' must be non-negative, but it was set to "
+                                               + std::to_string(value));
+    }
+    if (iteration && (value != std::floor(value) || value > std::numeric_limits<int>::max())) {
+        pagmo_throw(std::invalid_argument, "The early termination criterion '" + name
+                                               + "' must be an iteration count, but it was set to "
+                                               + std::to_string(value));
+    }
+    m_stop_criteria[name] = value;
+}
+/// Set early termination criteria.
+/**
+ * This method will set the early termination criteria contained in \p m.
+ * It is equivalent to calling set_stop_criterion() passing all the name-value pairs in \p m
+ * as arguments.
+ *
+ * @param m the name-value map that will be used to set the criteria.
+ *
+ * @throws unspecified any exception thrown by set_stop_criterion().
+ */
+void snopt7::set_stop_criteria(const std::map<std::string, double> &m)
+{
+    for (const auto &p : m) {
+        set_stop_criterion(p.first, p.second);
+    }
+}
+/// Get early termination criteria.
+/**
+ * @return the name-value map of the early termination criteria.
+ */
+std::map<std::string, double> snopt7::get_stop_criteria() const
+{
+    return m_stop_criteria;
+}
+/// Clear all early termination criteria.
+void snopt7::reset_stop_criteria()
+{
+    m_stop_criteria.clear();
+}
+
 // This is the evolve which will be version dependent via the template argument (snProblem declaration is)
 template <typename snProblem>
 pagmo::population snopt7::evolve_version(pagmo::population &pop) const
@@ -535,63 +1466,29 @@ pagmo::population snopt7::evolve_version(pagmo::population &pop) const
     // ---------------------------------------------------------------------------------------------------------
 
     // ------------------------- SNOPT7 PLUGIN (we attempt loading the snopt7 library at run-time)--------------
-    // We first declare the prototypes of the functions used from the library
-    std::function<void(snProblem *, char *, char *, int)> snInit;
-    std::function<int(snProblem *, char[], int)> setIntParameter;
-    std::function<int(snProblem *, char[], double)> setRealParameter;
-    std::function<void(snProblem *)> deleteSNOPT;
-    std::function<int(snProblem *, int, int, int, double, int, snFunA, int, int *, int *, double *, int, int *, int *,
-                      double *, double *, double *, double *, double *, int *, double *, double *, int *, double *,
-                      int *, int *, double *)>
-        solveA;
-    // We then try to load the library at run time and locate the symbols used.
-    try {
-        // Here we import at runtime the snopt7_c library and protect the whole try block with a mutex
-        std::lock_guard<std::mutex> lock(detail::library_load_mutex);
-        boost::filesystem::path path_to_lib(m_snopt7_c_library);
-        if (!boost::filesystem::is_regular_file(path_to_lib)) {
-            pagmo_throw(std::invalid_argument, "The snopt7_c library path was constructed to be: "
-                                                   + path_to_lib.string() + " and it does not appear to be a file");
-        }
-        boost::dll::shared_library libsnopt7_c(path_to_lib);
-        // We then load the symbols we need for the SNOPT7 plugin
-        snInit = boost::dll::import<void(snProblem *, char *, char *,
-                                         int)>( // type of the function to import
-            libsnopt7_c,                        // the library
-            "snInit"                            // name of the function to import
-        );
-
-        setIntParameter = boost::dll::import<int(snProblem *, char[], int)>( // type of the function to import
-            libsnopt7_c,                                                     // the library
-            "setIntParameter"                                                // name of the function to import
-        );
-
-        setRealParameter = boost::dll::import<int(snProblem *, char[], double)>( // type of the function to import
-            libsnopt7_c,                                                         // the library
-            "setRealParameter"                                                   // name of the function to import
-        );
-
-        deleteSNOPT = boost::dll::import<void(snProblem *)>( // type of the function to import
-            libsnopt7_c,                                     // the library
-            "deleteSNOPT"                                    // name of the function to import
-        );
-
-        solveA = boost::dll::import<int(snProblem *, int, int, int, double, int, snFunA, int, int *, int *, double *,
-                                        int, int *, int *, double *, double *, double *, double *, double *, int *,
-                                        double *, double *, int *, double *, int *, int *,
-                                        double *)>( // type of the function to import
-            libsnopt7_c,                            // the library
-            "solveA"                                // name of the function to import
-        );
-    } catch (const std::exception &e) {
-        std::string message(
-            R"(
+    // The library is loaded and its symbols are resolved only once per process (and API version): subsequent
+    // calls will get the very same symbol table without any file system access or locking.
+    const auto &symbols = detail::library_registry<detail::snopt7_symbols<snProblem>>::get(
+        m_snopt7_c_library, m_minor_version > 6 ? 7u : 6u, [this]() {
+            // We try to load the library at run time and locate the symbols used.
+            try {
+                boost::filesystem::path path_to_lib(m_snopt7_c_library);
+                if (!boost::filesystem::is_regular_file(path_to_lib)) {
+                    pagmo_throw(std::invalid_argument, "The snopt7_c library path was constructed to be: "
+                                                           + path_to_lib.string()
+                                                           + " and it does not appear to be a file");
+                }
+                boost::dll::shared_library libsnopt7_c(path_to_lib);
+                return std::make_shared<const detail::snopt7_symbols<snProblem>>(libsnopt7_c);
+            } catch (const std::exception &e) {
+                std::string message(
+                    R"(
 An error occurred while loading the snopt7_c library at run-time. This is typically caused by one of the following
 reasons:
 
 - The file declared to be the snopt7_c library, i.e. )"
-            + m_snopt7_c_library
-            + R"(, is not a shared library containing the necessary C interface symbols (is the file path really pointing to
+                    + m_snopt7_c_library
+                    + R"(, is not a shared library containing the necessary C interface symbols (is the file path really pointing to
 a valid shared library?)
  - The library is found and it does contain the C interface symbols, but it needs linking to some additional libraries that are not found
 at run-time.
@@ -599,70 +1496,43 @@ at run-time.
 We report the exact text of the original exception thrown:
 
  )" + std::string(e.what()));
-        pagmo_throw(std::invalid_argument, message);
-    }
+                pagmo_throw(std::invalid_argument, message);
+            }
+        });
+    const auto solveA = symbols.solveA;
     // ------------------------- END SNOPT7 PLUGIN -------------------------------------------------------------
 
-    // We init and set up SNOPT options
-    // We init the SNOPT workspace suppressing the file output. TODO: should we allow the file output?
-    snProblem snopt7_problem;
-    char empty_string[] = "";
-
-    auto problem_name = detail::s_to_C(prob.get_name());
-
-    // Here we call snInit and ensure deleteSNOPT will be called whenever the object spr is destroyed.
-    detail::sn_problem_raii<snProblem> spr(&snopt7_problem, problem_name.data(), empty_string, m_screen_output, snInit,
-                                           deleteSNOPT);
+    // We prevent to set the "Derivative option" option as pagmo sets it according to the value of
+    // prob.has_gradient() (and to the presence of a bfe)
+    if (m_integer_opts.count("Derivative option")) {
+        pagmo_throw(
+            std::invalid_argument,
+            R"(The option "Derivative option" was set by the user. In pagmo that is not allowed, as its value is automatically set according to the value returned by has_gradient() (true -> 3, false -> 0))");
+    }
+    // We assemble the options that will be applied to the SNOPT workspace: those set by the user plus the ones
+    // pagmo decides.
+    auto integer_opts = m_integer_opts;
+    auto numeric_opts = m_numeric_opts;
+    // When the problem does not provide the gradient but a bfe was set, the gradient is computed by the plugin
+    // and passed to SNOPT7 as if it was provided by the user.
+    const bool fd = !prob.has_gradient() && m_bfe;
+    integer_opts["Derivative option"] = (prob.has_gradient() || fd) ? 3 : 0;
     // Logic for the handling of constraints tolerances. The logic is as follows:
     // - if the user provides the "Major feasibility tolerance" option, use that *unconditionally*. Otherwise,
     // - compute the minimum tolerance min_tol among those returned by  problem.c_tol(). If zero, ignore
     //   it and use the SNOPT7 default value for "Major feasibility tolerance" (1e-6). Otherwise, use min_tol as
     //   the value for "Major feasibility tolerance".
-    int res = 0;
     if (prob.get_nc() && !m_numeric_opts.count("Major feasibility tolerance")) {
         const auto c_tol = prob.get_c_tol();
         assert(!c_tol.empty());
         const double min_tol = *std::min_element(c_tol.begin(), c_tol.end());
         if (min_tol > 0.) {
-            auto option_name = detail::s_to_C("Major feasibility tolerance");
-            res = setRealParameter(&snopt7_problem, option_name.data(), min_tol);
-            assert(res == 0);
-        }
-    }
-    // We prevent to set the "Derivative option" option as pagmo sets it according to the value of
-    // prob.has_gradient()
-    if (m_integer_opts.count("Derivative option")) {
-        pagmo_throw(
-            std::invalid_argument,
-            R"(The option "Derivative option" was set by the user. In pagmo that is not allowed, as its value is automatically set according to the value returned by has_gradient() (true -> 3, false -> 0))");
-    }
-    res = 0;
-    // We set all the other user defined options
-    for (const auto &p : m_numeric_opts) {
-        auto option_name = detail::s_to_C(p.first);
-        double option_value(p.second);
-        res = setRealParameter(&snopt7_problem, option_name.data(), option_value);
-        if (res > 0) {
-            pagmo_throw(std::invalid_argument,
-                        "The option '" + p.first + "' was requested by the user to be set to the float value "
-                            + std::to_string(option_value)
-                            + ", but SNOPT7 interface returned an error. Did you mispell the option name?");
-        }
-    }
-    for (const auto &p : m_integer_opts) {
-        auto option_name = detail::s_to_C(p.first);
-        int option_value(p.second);
-        res = setIntParameter(&snopt7_problem, option_name.data(), option_value);
-        if (res > 0) {
-            pagmo_throw(std::invalid_argument,
-                        "The option '" + p.first + "' was requested by the user to be set to the int value "
-                            + std::to_string(option_value)
-                            + ", but SNOPT7 interface returned an error. Did you mispell the option name?");
+            numeric_opts["Major feasibility tolerance"] = min_tol;
         }
     }
 
     // ------- We define various inputs to call the snOptA interface
-    int Cold = 0;            // Cold start
+    int start = 0;           // Cold start (see below for the warm start)
     auto nF = prob.get_nf(); // Fitness dimension
     auto n = prob.get_nx();  // Decision vector dimension
 
@@ -707,25 +1577,134 @@ We report the exact text of the original exception thrown:
     // ------- Some inits for quantities needed by the snOptA interface
     int ObjRow = 0;
     double ObjAdd = 0;
-    int nS, nInf;
+    int nS = 0, nInf;
+    // In the warm start mode, the states and the multipliers of a previous optimisation of the same problem are
+    // reused: those found nearest to x0 in the warm start database, if active, or else those of the last one.
+    const detail::warm_start_db<warm_start_data_type>::key_type ws_key{prob.get_name(), n, nF};
+    const warm_start_data_type *ws_data = nullptr;
+    if (m_warm_start) {
+        ws_data = m_warm_start_db.nearest(ws_key, x0, detail::warm_start_scale(lb, ub));
+        if (!ws_data && std::get<0>(m_warm_start_data) == prob.get_name()) {
+            ws_data = &m_warm_start_data;
+        }
+    }
+    const bool warm = ws_data && std::get<2>(*ws_data).size() == n && std::get<4>(*ws_data).size() == nF;
+    if (warm) {
+        start = 2;
+        nS = std::get<1>(*ws_data);
+        xstate = std::get<2>(*ws_data);
+        xmul = std::get<3>(*ws_data);
+        Fstate = std::get<4>(*ws_data);
+        Fmul = std::get<5>(*ws_data);
+    }
     double sInf;
     // We use the user workspace (iu variable) to hide a pointer to user_data,
     // so that it may be accessed in the user-defined function.
     detail::user_data info;
     info.m_prob = prob;
     info.m_verbosity = m_verbosity;
+    info.m_log_majors = m_log_majors;
+    // The log is preallocated, if bounded.
+    info.m_log = columnar_log_type(m_log.capacity());
     info.m_dv = pagmo::vector_double(dim);
-    snopt7_problem.iu = reinterpret_cast<int *>(&info);
+    info.m_fitness_and_gradient = detail::get_fitness_and_gradient(prob);
+    detail::evaluation_cache cache(m_cache_size);
+    info.m_cache = &cache;
 
-    // -------- Linear Part Of the Problem. As pagmo does not support linear problems we do not use this -------
-    int neA = 0;        // We switch off the linear part of the fitness
-    unsigned lenA = 1u; // Thats the minimum length allowed
+    // -------- Gradient sparsity. ------------------------------------------------------------------------------
+    // When requested, the gradient sparsity not provided by the problem is detected by the plugin.
+    const bool detect = m_sparsity_detection && !prob.has_gradient_sparsity();
+    const auto full_sparsity = detect ? *detail::cached_gradient_sparsity(prob, x0, m_bfe ? *m_bfe : pagmo::bfe{})
+                                      : prob.gradient_sparsity();
+
+    // -------- Linear Part Of the Problem. ---------------------------------------------------------------------
+    // pagmo has no notion of linear problems: the linear part is passed to SNOPT7 only if declared by the UDP
+    // (see ppnf::register_linear_jacobian()) or, when requested, detected by the plugin, and it is then subtracted
+    // from the fitness in the usrfun.
+    std::pair<pagmo::sparsity_pattern, pagmo::vector_double> linear;
+    // The position of each detected constant element in the gradient computed by the problem, for their verification.
+    std::vector<pagmo::vector_double::size_type> linear_pos;
+    if (const auto lj = detail::get_linear_jacobian(prob)) {
+        linear = detail::linear_jacobian(prob, lj);
+    } else if (m_constant_jacobian_detection && prob.has_gradient()) {
+        std::vector<pagmo::vector_double::size_type> pos(full_sparsity.size());
+        if (detect) {
+            pos = detail::dense_gradient_positions(full_sparsity, dim);
+        } else {
+            std::iota(pos.begin(), pos.end(), pagmo::vector_double::size_type(0u));
+        }
+        const auto cj = detail::cached_constant_jacobian(prob, x0, full_sparsity, pos);
+        // NOTE: the cached elements might have been detected on a different sparsity pattern (e.g., before the
+        // gradient sparsity detection was activated), so only those in full_sparsity are kept.
+        std::vector<std::tuple<std::pair<pagmo::vector_double::size_type, pagmo::vector_double::size_type>, double,
+                               pagmo::vector_double::size_type>>
+            elems;
+        for (decltype(full_sparsity.size()) k = 0u; k < full_sparsity.size(); ++k) {
+            const auto it = std::lower_bound(cj->first.begin(), cj->first.end(), full_sparsity[k]);
+            if (it != cj->first.end() && *it == full_sparsity[k]) {
+                elems.emplace_back(full_sparsity[k], cj->second[static_cast<decltype(k)>(it - cj->first.begin())],
+                                   pos[k]);
+            }
+        }
+        std::sort(elems.begin(), elems.end());
+        for (const auto &e : elems) {
+            linear.first.push_back(std::get<0>(e));
+            linear.second.push_back(std::get<1>(e));
+            linear_pos.push_back(std::get<2>(e));
+        }
+        if (!linear_pos.empty()) {
+            info.m_linear_pos = &linear_pos;
+        }
+    }
+    int neA = static_cast<int>(linear.first.size());
+    auto lenA = std::max(decltype(linear.first.size())(1u), linear.first.size()); // 1 is the minimum length allowed
     std::vector<int> iAfun(lenA);
     std::vector<int> jAvar(lenA);
     pagmo::vector_double A(lenA);
+    for (decltype(linear.first.size()) i = 0u; i < linear.first.size(); ++i) {
+        iAfun[i] = static_cast<int>(linear.first[i].first);
+        jAvar[i] = static_cast<int>(linear.first[i].second);
+        A[i] = linear.second[i];
+    }
+    if (neA > 0) {
+        info.m_linear_sp = &linear.first;
+        info.m_linear_vals = &linear.second;
+    }
 
     // -------- Non Linear Part Of the Problem. ----------------------------------------------------------------
-    auto sparsity = prob.gradient_sparsity();
+    // The elements of the linear part are not in G (SNOPT7 requires the two to be disjoint).
+    pagmo::sparsity_pattern sparsity;
+    std::vector<pagmo::vector_double::size_type> kept;
+    for (decltype(full_sparsity.size()) k = 0u; k < full_sparsity.size(); ++k) {
+        if (!std::binary_search(linear.first.begin(), linear.first.end(), full_sparsity[k])) {
+            sparsity.push_back(full_sparsity[k]);
+            kept.push_back(k);
+        }
+    }
+    // The gradient computed by the problem (if any) follows the full (or, if it was detected, the dense) pattern,
+    // and G is gathered from it.
+    std::vector<pagmo::vector_double::size_type> grad_idx;
+    if (prob.has_gradient() && (detect || kept.size() != full_sparsity.size())) {
+        grad_idx = kept;
+        if (detect) {
+            const auto pos = detail::dense_gradient_positions(full_sparsity, dim);
+            for (auto &idx : grad_idx) {
+                idx = pos[idx];
+            }
+        }
+        info.m_grad_idx = &grad_idx;
+    }
+    // The gradient sparsity detected by probing might miss some nonzeros: they are checked at each gradient
+    // evaluation.
+    std::vector<pagmo::vector_double::size_type> dropped_pos;
+    if (detect && prob.has_gradient()) {
+        dropped_pos = detail::dropped_gradient_positions(full_sparsity, prob.get_nf(), dim);
+        if (!dropped_pos.empty()) {
+            info.m_dropped_pos = &dropped_pos;
+        }
+    }
+    info.m_grad_size
+        = prob.has_gradient() ? (detect ? prob.get_nf() * dim : full_sparsity.size()) : sparsity.size();
     int neG = static_cast<int>(sparsity.size());
     auto lenG = sparsity.size();
     std::vector<int> iGfun(lenG);
@@ -734,43 +1713,137 @@ We report the exact text of the original exception thrown:
         iGfun[i] = static_cast<int>(sparsity[i].first);
         jGvar[i] = static_cast<int>(sparsity[i].second);
     }
-    if (prob.has_gradient()) {
-        res = setIntParameter(&snopt7_problem, &std::string("Derivative option")[0], 3);
-        assert(res == 0);
-    } else {
-        res = setIntParameter(&snopt7_problem, &std::string("Derivative option")[0], 0);
-        assert(res == 0);
+    boost::optional<detail::fd_gradient> fd_grad;
+    if (fd) {
+        fd_grad.emplace(prob, sparsity, *m_bfe);
+        info.m_fd_gradient = &*fd_grad;
     }
 
+    // -------- Early termination criteria. ---------------------------------------------------------------------
+    // When set, they are checked at each major iteration by the snSTOP hook.
+    boost::optional<detail::stop_data> stop;
+    if (!m_stop_criteria.empty()) {
+        stop.emplace(m_stop_criteria);
+        info.m_stop = &*stop;
+    }
+
+    // ------- We init and set up the SNOPT workspace ----------------------------------------------------------
+    // In the persistent workspace mode the workspace stored in m_workspace is re-used, unless it is being used
+    // by a concurrent evolve() of a copy of this object, in which case we fall back to a temporary workspace.
+    detail::sn_workspace<snProblem> tmp_ws(symbols);
+    auto *ws = &tmp_ws;
+    std::unique_lock<std::mutex> ws_lock;
+    if (m_workspace) {
+        ws_lock = std::unique_lock<std::mutex>(m_workspace->m_mutex, std::try_to_lock);
+        if (ws_lock.owns_lock()) {
+            auto *pws = dynamic_cast<detail::sn_workspace<snProblem> *>(m_workspace->m_ws.get());
+            if (!pws || pws->m_symbols != &symbols) {
+                // First use, or the workspace was created by a different library / API version.
+                m_workspace->m_ws = std::make_unique<detail::sn_workspace<snProblem>>(symbols);
+                pws = static_cast<detail::sn_workspace<snProblem> *>(m_workspace->m_ws.get());
+            }
+            ws = pws;
+        }
+    }
+    ws->setup(detail::snopt7_signature{prob.get_name(), m_screen_output, static_cast<int>(n), static_cast<int>(nF),
+                                       iGfun, jGvar},
+              integer_opts, numeric_opts);
+    auto &snopt7_problem = ws->m_prob;
+    snopt7_problem.iu = reinterpret_cast<int *>(&info);
+    detail::set_stop_hook(snopt7_problem, static_cast<bool>(stop));
+    // NOTE: the hook would replace the SNOPT7 screen output.
+    detail::set_log_hook(snopt7_problem, m_log_majors && m_verbosity > 0u && !m_screen_output);
+
     // ------- We call the snOptA interface.
+    // The screen output goes through the sink, which in the async mode writes it from a separate thread.
+    detail::output_sink sink(m_output_mode);
+    info.m_sink = &sink;
     if (m_verbosity > 0u) {
-        pagmo::print("SNOPT7 plugin for pagmo/pygmo: \n");
+        sink.print("SNOPT7 plugin for pagmo/pygmo: \n");
         if (prob.has_gradient_sparsity()) {
-            pagmo::print("The gradient sparsity is provided by the user: ", neG, " components detected.\n");
+            sink.print("The gradient sparsity is provided by the user: ", neG, " components detected.\n");
+        } else if (detect) {
+            sink.print("The gradient sparsity is detected by the plugin: ", neG, " components detected.\n");
         } else {
-            pagmo::print("The gradient sparsity is assumed dense: ", neG, " components detected.\n");
+            sink.print("The gradient sparsity is assumed dense: ", neG, " components detected.\n");
+        }
+        if (!linear_pos.empty()) {
+            sink.print("The linear part of the problem is detected by the plugin: ", neA, " components detected.\n");
+        } else if (neA > 0) {
+            sink.print("The linear part of the problem is provided by the user: ", neA, " components detected.\n");
         }
         if (prob.has_gradient()) {
-            pagmo::print("The gradient is provided by the user.\n");
+            sink.print("The gradient is provided by the user.\n");
+        } else if (fd) {
+            sink.print("The gradient is computed numerically by the plugin, evaluating ", fd_grad->get_ncolors(),
+                       " perturbed points per gradient via the batch fitness evaluator.\n");
         } else {
-            pagmo::print("The gradient is computed numerically by SNOPT7.\n");
+            sink.print("The gradient is computed numerically by SNOPT7.\n");
+        }
+        if (warm) {
+            sink.print("Warm start from the final state of the previous optimisation.\n");
         }
     }
-    m_last_opt_res = solveA(&snopt7_problem, Cold, static_cast<int>(nF), static_cast<int>(n), ObjAdd, ObjRow,
+    m_last_opt_res = solveA(&snopt7_problem, start, static_cast<int>(nF), static_cast<int>(n), ObjAdd, ObjRow,
                             detail::snopt_fitness_wrapper, neA, iAfun.data(), jAvar.data(), A.data(), neG, iGfun.data(),
                             jGvar.data(), xlow.data(), xupp.data(), Flow.data(), Fupp.data(), x.data(), xstate.data(),
                             xmul.data(), F.data(), Fstate.data(), Fmul.data(), &nS, &nInf, &sInf);
+    // info is about to go out of scope, while the workspace might survive this call.
+    snopt7_problem.iu = nullptr;
+    detail::set_stop_hook(snopt7_problem, false);
+    detail::set_log_hook(snopt7_problem, false);
 
     if (m_verbosity > 0u) {
-        pagmo::print("\n", detail::results.at(m_last_opt_res), "\n");
+        sink.print("\n", detail::results.at(m_last_opt_res), "\n");
+        if (stop && !stop->m_reason.empty()) {
+            sink.print("Early termination: ", stop->m_reason, ".\n");
+        }
+    }
+    if (info.m_sparsity_mismatch) {
+        // A nonzero outside the detected gradient sparsity was found: the gradient is assumed dense from now on, and
+        // the optimisation is started again.
+        if (m_verbosity > 0u) {
+            sink.print("\nThe detected gradient sparsity of the problem is incomplete: restarting with a dense one.\n");
+        }
+        sink.flush();
+        detail::discard_gradient_sparsity(prob);
+        if (ws_lock.owns_lock()) {
+            ws_lock.unlock();
+        }
+        return evolve_version<snProblem>(pop);
+    }
+    if (info.m_linear_mismatch) {
+        // A detected constant element changed during the run: the detection is discarded and the optimisation is
+        // started again.
+        if (m_verbosity > 0u) {
+            sink.print("\nThe detected linear part of the problem is not constant: restarting without it.\n");
+        }
+        sink.flush();
+        detail::discard_constant_jacobian(prob);
+        if (ws_lock.owns_lock()) {
+            ws_lock.unlock();
+        }
+        return evolve_version<snProblem>(pop);
     }
     // ------- We reinsert the solution if better -----------------------------------------------------------
+    // F may not include the linear part of the problem, in which case the fitness is recovered from the cache
+    // (and computed only if missing).
+    if (neA > 0 && !info.m_eptr) {
+        F = cache.m_f.get(x, [&prob](const pagmo::vector_double &y) { return prob.fitness(y); });
+    }
     // Store the new individual into the population, but only if it is improved.
     if (pagmo::compare_fc(F, fit0, prob.get_nec(), prob.get_c_tol())) {
         replace_individual(pop, x, F);
     }
-    // ------- Store the log --------------------------------------------------------------------------------
+    // ------- Store the log and (unless the optimisation failed) the warm start data --------------------
     m_log = std::move(info.m_log);
+    m_major_log = std::move(info.m_major_log);
+    if (!info.m_eptr) {
+        m_warm_start_data = warm_start_data_type{prob.get_name(), nS, std::move(xstate), std::move(xmul),
+                                                 std::move(Fstate), std::move(Fmul)};
+        m_warm_start_db.insert(ws_key, x, m_warm_start_data);
+    }
+    m_cache_stats = cache.stats();
     // ------- Handle any exception that might have been thrown during the evolve call. ---------------------
     if (info.m_eptr) {
         std::rethrow_exception(info.m_eptr);
@@ -0,0 +1,456 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <pagmo/bfe.hpp>
+#include <pagmo/exceptions.hpp>
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/sparsity_detection.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+
+namespace
+{
+using size_type = pagmo::vector_double::size_type;
+
+// The number of probe points (besides the validation one).
+constexpr unsigned n_probes = 3u;
+// The radius (relative to the magnitude of the variables) of the neighbourhood of x0 in which each probe point of the
+// gradient sparsity detection is taken: increasing radii, so that the dependencies vanishing near x0 are still
+// likely to be found.
+constexpr double probe_radii[n_probes] = {1e-2, 1e-1, 1.};
+// The maximum number of perturbed points evaluated in a single batch.
+constexpr size_type max_batch = 256u;
+// The number of variables perturbed to validate a cached pattern, for problems not providing the gradient.
+constexpr size_type revalidation_vars = 8u;
+
+// The nonzeros found probing p at x, as a dense nf x nx boolean matrix (row-major). If p provides the gradient, the
+// nonzeros of the gradient at x are collected. Otherwise, each variable is perturbed (by a randomised relative step,
+// within the bounds) and the fitness components whose value changes are collected: all of them, or only count
+// variables starting from first (cyclically).
+std::vector<char> probe(const pagmo::problem &p, const pagmo::vector_double &x, const pagmo::bfe &b,
+                        std::mt19937 &rng, size_type first = 0u, size_type count = static_cast<size_type>(-1))
+{
+    const auto nx = p.get_nx();
+    const auto nf = p.get_nf();
+    const auto &lb = p.get_lb();
+    const auto &ub = p.get_ub();
+    std::vector<char> retval(nf * nx, 0);
+    if (p.has_gradient()) {
+        const auto g = p.gradient(x);
+        for (size_type k = 0u; k < g.size(); ++k) {
+            // NOTE: NaNs are counted as nonzeros.
+            retval[k] = !(g[k] == 0.);
+        }
+        return retval;
+    }
+    std::uniform_real_distribution<double> u(0.5, 1.);
+    // The perturbed variable of each point of the batch.
+    std::vector<size_type> vars;
+    pagmo::vector_double dvs;
+    const auto f = p.fitness(x);
+    const auto flush = [&]() {
+        if (vars.empty()) {
+            return;
+        }
+        const auto fs = b(p, dvs);
+        if (fs.size() != vars.size() * nf) {
+            pagmo_throw(std::invalid_argument, "The batch fitness evaluation returned " + std::to_string(fs.size())
+                                                   + " values, while " + std::to_string(vars.size() * nf)
+                                                   + " were expected in the gradient sparsity detection");
+        }
+        for (size_type k = 0u; k < vars.size(); ++k) {
+            for (size_type i = 0u; i < nf; ++i) {
+                const auto fi = fs[k * nf + i];
+                if (!(fi == f[i])) {
+                    retval[i * nx + vars[k]] = 1;
+                }
+            }
+        }
+        vars.clear();
+        dvs.clear();
+    };
+    for (size_type c = 0u; c < std::min(count, nx); ++c) {
+        const auto j = (first + c) % nx;
+        // A step much larger than the finite-difference ones, so that weak dependencies are not lost in the rounding.
+        auto h = 1e-3 * std::max(1., std::abs(x[j])) * u(rng);
+        if (x[j] + h > ub[j]) {
+            h = (x[j] - lb[j] > ub[j] - x[j]) ? std::max(-h, lb[j] - x[j]) : ub[j] - x[j];
+        }
+        if (x[j] + h == x[j]) {
+            // The variable cannot be perturbed: it is assumed to affect all the fitness components.
+            for (size_type i = 0u; i < nf; ++i) {
+                retval[i * nx + j] = 1;
+            }
+            continue;
+        }
+        vars.push_back(j);
+        dvs.insert(dvs.end(), x.begin(), x.end());
+        dvs[dvs.size() - nx + j] = x[j] + h;
+        if (vars.size() == max_batch) {
+            flush();
+        }
+    }
+    flush();
+    return retval;
+}
+
+// A random point near x0 (within the given relative radius), within the bounds of p.
+pagmo::vector_double probe_point(const pagmo::problem &p, const pagmo::vector_double &x0, std::mt19937 &rng,
+                                 double radius = 1e-2)
+{
+    const auto &lb = p.get_lb();
+    const auto &ub = p.get_ub();
+    std::uniform_real_distribution<double> u(-1., 1.);
+    auto x = x0;
+    for (size_type j = 0u; j < x.size(); ++j) {
+        x[j] = std::min(ub[j], std::max(lb[j], x0[j] + radius * std::max(1., std::abs(x0[j])) * u(rng)));
+    }
+    return x;
+}
+
+// Whether the gradient sparsity sp, detected for a problem identified as p, is valid also for p itself: p is probed
+// at a random point near x0, perturbing only revalidation_vars variables starting from first, and sp is deemed valid
+// if no nonzero outside sp is found. NOTE: the problems of the same type (with the same bounds) might not share the
+// same sparsity, e.g., if they are parametrised.
+bool gradient_sparsity_holds(const pagmo::problem &p, const pagmo::vector_double &x0, const pagmo::bfe &b,
+                             const pagmo::sparsity_pattern &sp, size_type first)
+{
+    const auto nx = p.get_nx();
+    const auto nf = p.get_nf();
+    if (sp.size() == nf * nx) {
+        // Dense.
+        return true;
+    }
+    std::vector<char> nz(nf * nx, 0);
+    for (const auto &rc : sp) {
+        nz[rc.first * nx + rc.second] = 1;
+    }
+    // NOTE: a seed different from the one of the detection, so that the probe point is a new one.
+    std::mt19937 rng(43u);
+    const auto found = probe(p, probe_point(p, x0, rng), b, rng, first, revalidation_vars);
+    for (size_type k = 0u; k < nz.size(); ++k) {
+        if (found[k] && !nz[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+pagmo::sparsity_pattern detect_gradient_sparsity(const pagmo::problem &p, const pagmo::vector_double &x0,
+                                                 const pagmo::bfe &b)
+{
+    if (x0.size() != p.get_nx()) {
+        pagmo_throw(std::invalid_argument, "The gradient sparsity detection was requested at a point of dimension "
+                                               + std::to_string(x0.size()) + ", while the problem has dimension "
+                                               + std::to_string(p.get_nx()));
+    }
+    const auto nx = p.get_nx();
+    const auto nf = p.get_nf();
+    // NOTE: a fixed seed, so that the detected pattern (and thus the solver runs) are reproducible.
+    std::mt19937 rng(42u);
+    std::vector<char> nz(nf * nx, 0);
+    for (unsigned r = 0u; r < n_probes; ++r) {
+        const auto found = probe(p, probe_point(p, x0, rng, probe_radii[r]), b, rng);
+        std::transform(nz.begin(), nz.end(), found.begin(), nz.begin(), [](char a, char c) { return a || c; });
+    }
+    // Validation, near x0.
+    const auto found = probe(p, probe_point(p, x0, rng), b, rng);
+    for (size_type k = 0u; k < nz.size(); ++k) {
+        if (found[k] && !nz[k]) {
+            return pagmo::detail::dense_gradient(nf, nx);
+        }
+    }
+    pagmo::sparsity_pattern retval;
+    for (size_type i = 0u; i < nf; ++i) {
+        for (size_type j = 0u; j < nx; ++j) {
+            if (nz[i * nx + j]) {
+                retval.emplace_back(i, j);
+            }
+        }
+    }
+    return retval;
+}
+
+namespace
+{
+using gradient_sparsity_key = std::tuple<std::string, size_type, bool, pagmo::vector_double, pagmo::vector_double>;
+// The key, the pattern and the first variable to be perturbed at the next validation (see
+// cached_gradient_sparsity()).
+using gradient_sparsity_entry
+    = std::tuple<gradient_sparsity_key, std::shared_ptr<const pagmo::sparsity_pattern>, size_type>;
+
+// The patterns detected for the most recently used problems, the most recent first.
+std::mutex gradient_sparsity_mutex;
+std::list<gradient_sparsity_entry> gradient_sparsity_cache;
+
+gradient_sparsity_key gradient_sparsity_key_of(const pagmo::problem &p)
+{
+    return gradient_sparsity_key{p.get_name(), p.get_nf(), p.has_gradient(), p.get_lb(), p.get_ub()};
+}
+
+void insert_gradient_sparsity(gradient_sparsity_key key, std::shared_ptr<const pagmo::sparsity_pattern> sp)
+{
+    std::lock_guard<std::mutex> lock(gradient_sparsity_mutex);
+    auto &cache = gradient_sparsity_cache;
+    cache.remove_if([&key](const gradient_sparsity_entry &e) { return std::get<0>(e) == key; });
+    cache.emplace_front(std::move(key), std::move(sp), size_type(0u));
+    if (cache.size() > 16u) {
+        cache.pop_back();
+    }
+}
+} // namespace
+
+std::shared_ptr<const pagmo::sparsity_pattern> cached_gradient_sparsity(const pagmo::problem &p,
+                                                                        const pagmo::vector_double &x0,
+                                                                        const pagmo::bfe &b)
+{
+    auto key = gradient_sparsity_key_of(p);
+    std::shared_ptr<const pagmo::sparsity_pattern> cached;
+    size_type first = 0u;
+    {
+        std::lock_guard<std::mutex> lock(gradient_sparsity_mutex);
+        auto &cache = gradient_sparsity_cache;
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (std::get<0>(*it) == key) {
+                cache.splice(cache.begin(), cache, it);
+                cached = std::get<1>(cache.front());
+                // The next validation perturbs the following variables, so that all of them are eventually covered.
+                first = std::get<2>(cache.front());
+                std::get<2>(cache.front()) = (first + revalidation_vars) % p.get_nx();
+                break;
+            }
+        }
+    }
+    // The key does not identify the problem uniquely, so a cached pattern must be validated. If the problem provides
+    // the gradient, the solvers verify the pattern at each gradient evaluation, at no extra cost. Otherwise, the
+    // problem is probed at a further point, perturbing only a few variables (a different subset at each call). The
+    // validation and the detection run without holding the lock: two threads might detect the same pattern
+    // concurrently, which is harmless.
+    if (cached && (p.has_gradient() || gradient_sparsity_holds(p, x0, b, *cached, first))) {
+        return cached;
+    }
+    auto sp = std::make_shared<const pagmo::sparsity_pattern>(detect_gradient_sparsity(p, x0, b));
+    insert_gradient_sparsity(std::move(key), sp);
+    return sp;
+}
+
+void discard_gradient_sparsity(const pagmo::problem &p)
+{
+    insert_gradient_sparsity(gradient_sparsity_key_of(p),
+                             std::make_shared<const pagmo::sparsity_pattern>(
+                                 pagmo::detail::dense_gradient(p.get_nf(), p.get_nx())));
+}
+
+std::vector<pagmo::vector_double::size_type> dropped_gradient_positions(const pagmo::sparsity_pattern &sp,
+                                                                       pagmo::vector_double::size_type nf,
+                                                                       pagmo::vector_double::size_type nx)
+{
+    std::vector<char> nz(nf * nx, 0);
+    for (const auto &rc : sp) {
+        nz[rc.first * nx + rc.second] = 1;
+    }
+    std::vector<pagmo::vector_double::size_type> retval;
+    for (size_type k = 0u; k < nz.size(); ++k) {
+        if (!nz[k]) {
+            retval.push_back(k);
+        }
+    }
+    return retval;
+}
+
+std::vector<pagmo::vector_double::size_type> dense_gradient_positions(const pagmo::sparsity_pattern &sp,
+                                                                     pagmo::vector_double::size_type nx)
+{
+    std::vector<pagmo::vector_double::size_type> retval(sp.size());
+    for (decltype(sp.size()) k = 0u; k < sp.size(); ++k) {
+        retval[k] = sp[k].first * nx + sp[k].second;
+    }
+    return retval;
+}
+
+std::pair<pagmo::sparsity_pattern, pagmo::vector_double>
+detect_constant_jacobian(const pagmo::problem &p, const pagmo::vector_double &x0, const pagmo::sparsity_pattern &sp,
+                         const std::vector<pagmo::vector_double::size_type> &pos)
+{
+    if (x0.size() != p.get_nx()) {
+        pagmo_throw(std::invalid_argument, "The constant Jacobian detection was requested at a point of dimension "
+                                               + std::to_string(x0.size()) + ", while the problem has dimension "
+                                               + std::to_string(p.get_nx()));
+    }
+    if (pos.size() != sp.size()) {
+        pagmo_throw(std::invalid_argument, "The constant Jacobian detection was requested for "
+                                               + std::to_string(sp.size()) + " elements, but "
+                                               + std::to_string(pos.size()) + " positions were provided");
+    }
+    std::vector<size_type> cand(sp.size());
+    std::iota(cand.begin(), cand.end(), size_type(0u));
+    const auto g0 = p.gradient(x0);
+    // The candidates are filtered at each probe point, stopping early if none is left.
+    std::mt19937 rng(42u);
+    for (unsigned r = 0u; r < n_probes && !cand.empty(); ++r) {
+        const auto g = p.gradient(probe_point(p, x0, rng));
+        cand.erase(std::remove_if(cand.begin(), cand.end(),
+                                  [&g, &g0, &pos](size_type k) {
+                                      // NOTE: NaNs are never constant.
+                                      return !(g[pos[k]] == g0[pos[k]]);
+                                  }),
+                   cand.end());
+    }
+    std::sort(cand.begin(), cand.end(), [&sp](size_type a, size_type b) { return sp[a] < sp[b]; });
+    std::pair<pagmo::sparsity_pattern, pagmo::vector_double> retval;
+    for (auto k : cand) {
+        retval.first.push_back(sp[k]);
+        retval.second.push_back(g0[pos[k]]);
+    }
+    return retval;
+}
+
+namespace
+{
+using constant_jacobian_ptr = std::shared_ptr<const std::pair<pagmo::sparsity_pattern, pagmo::vector_double>>;
+using constant_jacobian_key = std::tuple<std::string, size_type, pagmo::vector_double, pagmo::vector_double>;
+
+// The elements detected for the most recently used problems, the most recent first.
+std::mutex constant_jacobian_mutex;
+std::list<std::pair<constant_jacobian_key, constant_jacobian_ptr>> constant_jacobian_cache;
+
+constant_jacobian_key constant_jacobian_key_of(const pagmo::problem &p)
+{
+    return constant_jacobian_key{p.get_name(), p.get_nf(), p.get_lb(), p.get_ub()};
+}
+
+void insert_constant_jacobian(constant_jacobian_key key, constant_jacobian_ptr cj)
+{
+    std::lock_guard<std::mutex> lock(constant_jacobian_mutex);
+    auto &cache = constant_jacobian_cache;
+    cache.remove_if([&key](const auto &e) { return e.first == key; });
+    cache.emplace_front(std::move(key), std::move(cj));
+    if (cache.size() > 16u) {
+        cache.pop_back();
+    }
+}
+
+// Whether the constant elements cj, detected for a problem identified as p, are valid also for p itself: each of
+// them must be among the candidates sp and have the same value (bitwise) in the gradient of p at x0.
+bool constant_jacobian_holds(const pagmo::problem &p, const pagmo::vector_double &x0, const pagmo::sparsity_pattern &sp,
+                             const std::vector<pagmo::vector_double::size_type> &pos,
+                             const std::pair<pagmo::sparsity_pattern, pagmo::vector_double> &cj)
+{
+    if (cj.first.empty()) {
+        return true;
+    }
+    // The candidates, sorted.
+    std::vector<size_type> idx(sp.size());
+    std::iota(idx.begin(), idx.end(), size_type(0u));
+    std::sort(idx.begin(), idx.end(), [&sp](size_type a, size_type b) { return sp[a] < sp[b]; });
+    const auto g0 = p.gradient(x0);
+    for (decltype(cj.first.size()) k = 0u; k < cj.first.size(); ++k) {
+        const auto it = std::lower_bound(
+            idx.begin(), idx.end(), cj.first[k],
+            [&sp](size_type a, const pagmo::sparsity_pattern::value_type &rc) { return sp[a] < rc; });
+        if (it == idx.end() || sp[*it] != cj.first[k] || !(g0[pos[*it]] == cj.second[k])) {
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+std::shared_ptr<const std::pair<pagmo::sparsity_pattern, pagmo::vector_double>>
+cached_constant_jacobian(const pagmo::problem &p, const pagmo::vector_double &x0, const pagmo::sparsity_pattern &sp,
+                         const std::vector<pagmo::vector_double::size_type> &pos)
+{
+    auto key = constant_jacobian_key_of(p);
+    constant_jacobian_ptr cached;
+    {
+        std::lock_guard<std::mutex> lock(constant_jacobian_mutex);
+        auto &cache = constant_jacobian_cache;
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->first == key) {
+                cache.splice(cache.begin(), cache, it);
+                cached = cache.front().second;
+                break;
+            }
+        }
+    }
+    // As in cached_gradient_sparsity(), the cached elements are re-used only if they are valid for p, and the
+    // validation and the detection run without holding the lock.
+    if (cached && constant_jacobian_holds(p, x0, sp, pos, *cached)) {
+        return cached;
+    }
+    auto cj = std::make_shared<const std::pair<pagmo::sparsity_pattern, pagmo::vector_double>>(
+        detect_constant_jacobian(p, x0, sp, pos));
+    insert_constant_jacobian(std::move(key), cj);
+    return cj;
+}
+
+void discard_constant_jacobian(const pagmo::problem &p)
+{
+    insert_constant_jacobian(constant_jacobian_key_of(p),
+                             std::make_shared<const std::pair<pagmo::sparsity_pattern, pagmo::vector_double>>());
+}
+
+} // namespace detail
+} // namespace ppnf
@@ -0,0 +1,200 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <pagmo/exceptions.hpp>
+#include <pagmo/problem.hpp>
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/udp_extensions.hpp>
+
+namespace ppnf
+{
+namespace detail
+{
+namespace
+{
+// The registry of the methods of an extension (of type Ptr). The lookups are performed once per evolve() call, so
+// a plain mutex is all we need.
+template <typename Ptr>
+struct udp_registry {
+    void insert(const std::type_index &t, Ptr f)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_map[t] = f;
+    }
+    Ptr find(const std::type_index &t)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_map.find(t);
+        return it == m_map.end() ? nullptr : it->second;
+    }
+    std::mutex m_mutex;
+    std::unordered_map<std::type_index, Ptr> m_map;
+};
+
+udp_registry<fitness_and_gradient_ptr> &get_fitness_and_gradient_registry()
+{
+    static udp_registry<fitness_and_gradient_ptr> registry;
+    return registry;
+}
+
+udp_registry<linear_jacobian_ptr> &get_linear_jacobian_registry()
+{
+    static udp_registry<linear_jacobian_ptr> registry;
+    return registry;
+}
+} // namespace
+
+void register_fitness_and_gradient(const std::type_index &t, fitness_and_gradient_ptr f)
+{
+    get_fitness_and_gradient_registry().insert(t, f);
+}
+
+// Returns the registered fitness_and_gradient() of the UDP of p, or nullptr if there is none or if p does not
+// provide a gradient (in which case the gradient is never computed by the solvers).
+fitness_and_gradient_ptr get_fitness_and_gradient(const pagmo::problem &p)
+{
+    if (!p.has_gradient()) {
+        return nullptr;
+    }
+    return get_fitness_and_gradient_registry().find(p.get_type_index());
+}
+
+std::pair<pagmo::vector_double, pagmo::vector_double> fitness_and_gradient(const pagmo::problem &p,
+                                                                           fitness_and_gradient_ptr f,
+                                                                           const pagmo::vector_double &x,
+                                                                           pagmo::vector_double::size_type grad_size)
+{
+    if (x.size() != p.get_nx()) {
+        pagmo_throw(std::invalid_argument, "A decision vector is incompatible with a problem of type '" + p.get_name()
+                                               + "': the number of dimensions of the problem is "
+                                               + std::to_string(p.get_nx())
+                                               + ", while the decision vector has a size of "
+                                               + std::to_string(x.size()) + " (the two values should be equal)");
+    }
+    auto retval = f(p.get_ptr(), x);
+    if (retval.first.size() != p.get_nf()) {
+        pagmo_throw(std::invalid_argument, "The fitness computed by fitness_and_gradient() of the problem of type '"
+                                               + p.get_name() + "' has a size of "
+                                               + std::to_string(retval.first.size())
+                                               + ", while the expected size is " + std::to_string(p.get_nf()));
+    }
+    if (retval.second.size() != grad_size) {
+        pagmo_throw(std::invalid_argument, "The gradient computed by fitness_and_gradient() of the problem of type '"
+                                               + p.get_name() + "' has a size of "
+                                               + std::to_string(retval.second.size())
+                                               + ", while the expected size (the size of the gradient sparsity) is "
+                                               + std::to_string(grad_size));
+    }
+    p.increment_fevals(1u);
+    return retval;
+}
+
+void register_linear_jacobian(const std::type_index &t, linear_jacobian_ptr f)
+{
+    get_linear_jacobian_registry().insert(t, f);
+}
+
+// Returns the registered linear_jacobian() of the UDP of p, or nullptr if there is none.
+linear_jacobian_ptr get_linear_jacobian(const pagmo::problem &p)
+{
+    return get_linear_jacobian_registry().find(p.get_type_index());
+}
+
+std::pair<pagmo::sparsity_pattern, pagmo::vector_double> linear_jacobian(const pagmo::problem &p, linear_jacobian_ptr f)
+{
+    auto retval = f(p.get_ptr());
+    auto &sp = retval.first;
+    auto &vals = retval.second;
+    if (sp.size() != vals.size()) {
+        pagmo_throw(std::invalid_argument, "The linear Jacobian returned by linear_jacobian() of the problem of type '"
+                                               + p.get_name() + "' has " + std::to_string(sp.size())
+                                               + " elements in its sparsity pattern, but "
+                                               + std::to_string(vals.size()) + " values");
+    }
+    for (const auto &ij : sp) {
+        if (ij.first >= p.get_nf() || ij.second >= p.get_nx()) {
+            pagmo_throw(std::invalid_argument,
+                        "The linear Jacobian returned by linear_jacobian() of the problem of type '" + p.get_name()
+                            + "' contains the index pair (" + std::to_string(ij.first) + ", "
+                            + std::to_string(ij.second) + "), which is out of bounds for a problem with "
+                            + std::to_string(p.get_nf()) + " fitness components and " + std::to_string(p.get_nx())
+                            + " variables");
+        }
+    }
+    // Sort the elements (and the values along with them), and check that there are no repetitions.
+    std::vector<pagmo::vector_double::size_type> idx(sp.size());
+    std::iota(idx.begin(), idx.end(), pagmo::vector_double::size_type(0));
+    std::sort(idx.begin(), idx.end(), [&sp](pagmo::vector_double::size_type a, pagmo::vector_double::size_type b) {
+        return sp[a] < sp[b];
+    });
+    pagmo::sparsity_pattern sorted_sp(sp.size());
+    pagmo::vector_double sorted_vals(sp.size());
+    for (decltype(idx.size()) k = 0u; k < idx.size(); ++k) {
+        sorted_sp[k] = sp[idx[k]];
+        sorted_vals[k] = vals[idx[k]];
+        if (k > 0u && sorted_sp[k] == sorted_sp[k - 1u]) {
+            pagmo_throw(std::invalid_argument,
+                        "The linear Jacobian returned by linear_jacobian() of the problem of type '" + p.get_name()
+                            + "' contains the index pair (" + std::to_string(sorted_sp[k].first) + ", "
+                            + std::to_string(sorted_sp[k].second) + ") more than once");
+        }
+    }
+    return {std::move(sorted_sp), std::move(sorted_vals)};
+}
+
+} // namespace detail
+} // namespace ppnf
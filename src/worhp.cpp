@@ -45,12 +45,12 @@ GNU Lesser General Public License along with the "pagmo plugins nonfree" library
 see https://www.gnu.org/licenses/. */
 
 #include <algorithm> // std::min_element, std::sort, std::remove_if
-#include <boost/dll/import.hpp>
 #include <boost/dll/shared_library.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/functional/hash.hpp>
 #include <boost/serialization/map.hpp>
+#include <fstream>
 #include <iomanip>
+#include <memory>
 #include <mutex>
 #include <numeric>
 #include <pagmo/algorithm.hpp>
@@ -71,6 +71,14 @@ see https://www.gnu.org/licenses/. */
 #include <vector>
 
 #include "../include/pagmo_plugins_nonfree/bogus_libs/worhp_lib/worhp_bogus.h"
+#include <pagmo_plugins_nonfree/detail/eval_cache.hpp>
+#include <pagmo_plugins_nonfree/detail/fd_gradient.hpp>
+#include <pagmo_plugins_nonfree/detail/hm_structure.hpp>
+#include <pagmo_plugins_nonfree/detail/library_registry.hpp>
+#include <pagmo_plugins_nonfree/detail/output_sink.hpp>
+#include <pagmo_plugins_nonfree/detail/parallel_for.hpp>
+#include <pagmo_plugins_nonfree/detail/sparsity_detection.hpp>
+#include <pagmo_plugins_nonfree/udp_extensions.hpp>
 #include <pagmo_plugins_nonfree/worhp.hpp>
 
 // MINGW-specific warnings.
@@ -86,38 +94,209 @@ namespace ppnf
 {
 namespace detail
 {
-// We use this to ensure WorhpFree is called also if exceptions occur.
-struct worhp_raii {
-    worhp_raii(OptVar *o, Workspace *w, Params *p, Control *c,
-               std::function<void(OptVar *, Workspace *, Params *, Control *)> &WorhpInit,
-               std::function<void(OptVar *, Workspace *, Params *, Control *)> &WorhpFree)
-        : m_o(o), m_w(w), m_p(p), m_c(c), m_WorhpFree(WorhpFree)
+// The symbols of the worhp library used by the plugin, as plain C function pointers. An instance of this
+// struct is created only once per library (see detail::library_registry) and it is then shared, immutable,
+// among all the evolve() calls. The struct also holds a handle to the library, so that the pointers
+// stay valid for its whole lifetime.
+struct worhp_symbols {
+    using usi_t = void (*)(OptVar *, Workspace *, Params *, Control *);
+    using ReadParams_t = void (*)(int *, const char[], Params *);
+    using GetUserAction_t = bool (*)(const Control *, int);
+    using DoneUserAction_t = void (*)(Control *, int);
+    using StatusMsgString_t = void (*)(OptVar *, Workspace *, Params *, Control *, char message[]);
+    using WorhpSetBoolParam_t = bool (*)(Params *, const char *, bool);
+    using WorhpSetIntParam_t = bool (*)(Params *, const char *, int);
+    using WorhpSetDoubleParam_t = bool (*)(Params *, const char *, double);
+    using WorhpVersion_t = void (*)(int *major, int *minor, char patch[PATCH_STRING_LENGTH]);
+    using SetWorhpPrint_t = void (*)(worhp_print_t);
+
+    explicit worhp_symbols(const boost::dll::shared_library &libworhp)
+        : m_lib(libworhp),
+          // We load the symbols we need for the WORHP plugin
+          ReadParams(get<ReadParams_t>("ReadParams")), WorhpPreInit(get<usi_t>("WorhpPreInit")),
+          WorhpInit(get<usi_t>("WorhpInit")), WorhpDiag(get<usi_t>("WorhpDiag")),
+          GetUserAction(get<GetUserAction_t>("GetUserAction")),
+          DoneUserAction(get<DoneUserAction_t>("DoneUserAction")), IterationOutput(get<usi_t>("IterationOutput")),
+          Worhp(get<usi_t>("Worhp")), StatusMsg(get<usi_t>("StatusMsg")),
+          StatusMsgString(get<StatusMsgString_t>("StatusMsgString")), WorhpFree(get<usi_t>("WorhpFree")),
+          WorhpFidif(get<usi_t>("WorhpFidif")), WorhpSetBoolParam(get<WorhpSetBoolParam_t>("WorhpSetBoolParam")),
+          WorhpSetIntParam(get<WorhpSetIntParam_t>("WorhpSetIntParam")),
+          WorhpSetDoubleParam(get<WorhpSetDoubleParam_t>("WorhpSetDoubleParam")),
+          WorhpVersion(get<WorhpVersion_t>("WorhpVersion")), SetWorhpPrint(get<SetWorhpPrint_t>("SetWorhpPrint")),
+          // WorhpRestart is used only by the persistent workspace mode and it is not required.
+          WorhpRestart(m_lib.has("WorhpRestart") ? get<usi_t>("WorhpRestart") : nullptr)
     {
-        WorhpInit(m_o, m_w, m_p, m_c);
     }
-    ~worhp_raii()
+    // Locates the symbol name in the library and returns it as a function pointer of type FuncPtr.
+    template <typename FuncPtr>
+    FuncPtr get(const char *name) const
     {
-        m_WorhpFree(m_o, m_w, m_p, m_c);
+        return &m_lib.get<std::remove_pointer_t<FuncPtr>>(name);
     }
-    OptVar *m_o;
-    Workspace *m_w;
-    Params *m_p;
-    Control *m_c;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> m_WorhpFree;
+    boost::dll::shared_library m_lib;
+    ReadParams_t ReadParams;
+    usi_t WorhpPreInit;
+    usi_t WorhpInit;
+    usi_t WorhpDiag;
+    GetUserAction_t GetUserAction;
+    DoneUserAction_t DoneUserAction;
+    usi_t IterationOutput;
+    usi_t Worhp;
+    usi_t StatusMsg;
+    StatusMsgString_t StatusMsgString;
+    usi_t WorhpFree;
+    usi_t WorhpFidif;
+    WorhpSetBoolParam_t WorhpSetBoolParam;
+    WorhpSetIntParam_t WorhpSetIntParam;
+    WorhpSetDoubleParam_t WorhpSetDoubleParam;
+    WorhpVersion_t WorhpVersion;
+    SetWorhpPrint_t SetWorhpPrint;
+    usi_t WorhpRestart;
 };
+
+// Everything that, if changed, requires the WORHP data structures to be initialised anew: the problem dimensions,
+// the sparsity patterns of the gradient (split in its objective and constraints parts) and of the hessian of the
+// lagrangian, and all the inputs determining the parameters (availability of derivatives, constraints tolerances,
+// user options and parameter source).
+using worhp_signature
+    = std::tuple<int, int, sparsity_pattern, sparsity_pattern, sparsity_pattern, bool, bool, vector_double,
+                 std::map<std::string, double>, std::map<std::string, int>, std::map<std::string, bool>, std::string>;
+
+// The WORHP data structures, together with the information needed to decide whether they can be re-used.
+// The destructor ensures WorhpFree is called (if needed) also if exceptions occur.
+struct worhp_solver {
+    explicit worhp_solver(const worhp_symbols &symbols) : m_symbols(&symbols) {}
+    worhp_solver(const worhp_solver &) = delete;
+    worhp_solver &operator=(const worhp_solver &) = delete;
+    ~worhp_solver()
+    {
+        reset();
+    }
+    void reset()
+    {
+        if (m_initialized) {
+            m_symbols->WorhpFree(&m_opt, &m_wsp, &m_par, &m_cnt);
+            m_initialized = false;
+        }
+        m_reusable = false;
+    }
+    OptVar m_opt;
+    Workspace m_wsp;
+    Params m_par;
+    Control m_cnt;
+    // WorhpInit was called.
+    bool m_initialized = false;
+    // The last run terminated normally, and the structures were set up for the problem identified by m_signature.
+    bool m_reusable = false;
+    const worhp_symbols *m_symbols;
+    worhp_signature m_signature;
+    // The value of the InitialLMest parameter set by the user (or by default), which is overridden by warm starts.
+    bool m_initial_lm_est = true;
+};
+
+// The persistent solver context, shared among copies of a worhp object. The mutex guarantees exclusive use:
+// an evolve() finding it already in use will fall back to temporary data structures.
+struct worhp_context {
+    std::mutex m_mutex;
+    std::unique_ptr<worhp_solver> m_solver;
+};
+// The parameters parsed from a parameter source, shared among copies of a worhp object. They are parsed only once
+// and then copied into each run.
+struct worhp_params {
+    std::mutex m_mutex;
+    // The source m_par was parsed from, if m_parsed.
+    bool m_parsed = false;
+    std::string m_source;
+    Params m_par;
+};
+
 namespace
 {
 // Used to suppress screen output from worhp
 void no_screen_output(int, const char[]) {}
-// Mutex to protect the library loading.
-std::mutex library_load_mutex;
+
+// Reads the WORHP parameters from source into par (see the constructor of worhp for the meaning of source).
+void read_params(worhp_symbols::ReadParams_t ReadParams, const std::string &source, Params *par)
+{
+    // The number of parameters that are not getting default values will be stored in n_xml_param
+    int n_xml_param;
+    const auto first = source.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        // Note that a file named "param.xml" will be searched in the current directory only if the environment
+        // variable WORHP_PARAM_FILE is not set. Otherwise the WORHP_PARAM_FILE will be used.
+        ReadParams(&n_xml_param, const_cast<char *>("param.xml"), par);
+    } else if (source[first] == '<') {
+        // The WORHP API can only read parameters from a file, so the xml content is written to a temporary one.
+        const auto path = boost::filesystem::temp_directory_path()
+                          / boost::filesystem::unique_path("ppnf_worhp_params_%%%%-%%%%-%%%%-%%%%.xml");
+        {
+            std::ofstream ofs(path.string());
+            ofs << source;
+            if (!ofs) {
+                pagmo_throw(std::invalid_argument, "Could not write the WORHP parameters to the temporary file: "
+                                                       + path.string());
+            }
+        }
+        ReadParams(&n_xml_param, path.string().c_str(), par);
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+    } else {
+        if (!boost::filesystem::is_regular_file(boost::filesystem::path(source))) {
+            pagmo_throw(std::invalid_argument,
+                        "The WORHP parameter file was declared to be: " + source + " and it does not appear to be a file");
+        }
+        ReadParams(&n_xml_param, source.c_str(), par);
+    }
+}
+
+// The gradient of prob at x, from the cache or computed either by the problem or, if fd_grad is not null,
+// by the plugin via finite differences.
+const vector_double &cached_gradient(evaluation_cache &cache, const problem &prob, const vector_double &x,
+                                     const fd_gradient *fd_grad)
+{
+    return cache.m_g.get(x, [&](const vector_double &y) {
+        if (fd_grad) {
+            const auto &f = cache.m_f.get(y, [&prob](const vector_double &z) { return prob.fitness(z); });
+            return (*fd_grad)(prob, y, f);
+        }
+        return prob.gradient(y);
+    });
+}
+
+// When WORHP approximates the hessian of the lagrangian itself and the problem does not provide the hessians
+// sparsity, the HM structure is dense up to this dimension. Above it, a block diagonal structure is used, as a
+// dense one would need O(dim^2) memory.
+constexpr vector_double::size_type hm_dense_max_dim = 1000u;
+// The default size of the diagonal blocks (see above), if the BFGSmaxblockSize option is not set.
+constexpr vector_double::size_type hm_default_block_size = 50u;
+// The values of the BFGSmethod option (WORHP 1.12) selecting the dense BFGS update and the block BFGS update on
+// non-overlapping diagonal blocks of size BFGSmaxblockSize.
+constexpr int bfgs_dense = 0;
+constexpr int bfgs_block = 1;
+
+// The lower triangular pattern of a block diagonal matrix of dimension dim, with blocks of size block (the last one
+// possibly smaller).
+sparsity_pattern block_diagonal_hessian(vector_double::size_type dim, vector_double::size_type block)
+{
+    sparsity_pattern retval;
+    for (vector_double::size_type start = 0u; start < dim; start += block) {
+        const auto end = std::min(dim, start + block);
+        for (auto i = start; i < end; ++i) {
+            for (auto j = start; j <= i; ++j) {
+                retval.emplace_back(i, j);
+            }
+        }
+    }
+    return retval;
+}
+
 } // namespace
 
 } // end of namespace detail
 
-worhp::worhp(bool screen_output, std::string worhp_library)
+worhp::worhp(bool screen_output, std::string worhp_library, std::string param_source)
     : m_worhp_library(worhp_library), m_integer_opts(), m_numeric_opts(), m_bool_opts(), m_screen_output(screen_output),
-      m_verbosity(0), m_log()
+      m_verbosity(0), m_log(), m_param_source(param_source), m_params(std::make_shared<detail::worhp_params>())
 {
 }
 
@@ -134,12 +313,22 @@ worhp::worhp(bool screen_output, std::string worhp_library)
  *
  * .. warning::
  *
- *    All options passed to the WORHP interface are determined first by the xml parameter file, or (if not found) by
- *    the default options. Then FGtogether is set to true (for constrained problems) and UserDF, UserDG , UserHM to
+ *    All options passed to the WORHP interface are determined first by the parameter source (parsed only once, see
+ *    worhp::worhp()), or (if not found) by the default options. Then FGtogether is set to true (for constrained problems) and UserDF, UserDG , UserHM to
  *    the values detected by the pagmo::has_gradient, pagmo::has_hessians methods. TolFeas is then set to be the
  *    minimum of prob.get_c_tol() if not 0. All the other options, contained in the data members m_integer_opts,
  *    m_numeric_opts and m_bool_opts are set after and thus overwrite the above rules.
  *
+ * .. note::
+ *
+ *    When WORHP approximates the hessian of the lagrangian itself (i.e., UserHM is false) and the problem does not
+ *    provide the hessians sparsity, the structure passed to WORHP is dense only for problems with up to 1000
+ *    decision variables. For larger problems, a block diagonal structure is used (with blocks of the size given by
+ *    the integer option BFGSmaxblockSize, if set, or 50 otherwise), avoiding the quadratic memory cost of a dense
+ *    structure. In this case, unless the integer option BFGSmethod is set, the block BFGS update
+ *    (BFGSmethod = 1) is selected, with BFGSmaxblockSize matching the blocks. If the dense BFGS update
+ *    (BFGSmethod = 0) is requested via the integer options, the structure is dense whatever the dimension.
+ *
  * \endverbatim
  *
  * @param pop the population to be optimised.
@@ -178,125 +367,28 @@ population worhp::evolve(population pop) const
     }
     // ---------------------------------------------------------------------------------------------------------
     // ------------------------- WORHP PLUGIN (we attempt loading the worhp library at run-time)--------------
-    // We first declare the prototypes of the functions used from the library
-    std::function<void(int *, const char[], Params *)> ReadParams;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> WorhpPreInit;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> WorhpInit;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> WorhpDiag;
-    std::function<bool(const Control *, int)> GetUserAction;
-    std::function<void(Control *, int)> DoneUserAction;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> IterationOutput;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> Worhp;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> StatusMsg;
-    std::function<void(OptVar *, Workspace *, Params *, Control *, char message[])> StatusMsgString;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> WorhpFree;
-    std::function<void(OptVar *, Workspace *, Params *, Control *)> WorhpFidif;
-    std::function<bool(Params *, const char *, bool)> WorhpSetBoolParam;
-    std::function<bool(Params *, const char *, int)> WorhpSetIntParam;
-    std::function<bool(Params *, const char *, double)> WorhpSetDoubleParam;
-    std::function<void(int *major, int *minor, char patch[PATCH_STRING_LENGTH])> WorhpVersion;
-    std::function<void(worhp_print_t)> SetWorhpPrint;
-
     boost::filesystem::path library_filename(m_worhp_library);
-    // We then try to load the library at run time and locate the symbols used.
-    try {
-        // Here we import at runtime the worhp library and protect the whole try block with a mutex
-        std::lock_guard<std::mutex> lock(detail::library_load_mutex);
-        if (!boost::filesystem::is_regular_file(library_filename)) {
-            pagmo_throw(std::invalid_argument,
-                        "The worhp library file name was constructed to be: " + library_filename.string()
-                            + " and it does not appear to be a file");
-        }
-        boost::dll::shared_library libworhp(library_filename);
-        // We then load the symbols we need for the WORHP plugin
-        WorhpPreInit = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                               Control *)>( // type of the function to import
-            libworhp,                                       // the library
-            "WorhpPreInit"                                  // name of the function to import
-        );
-        WorhpInit = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                            Control *)>( // type of the function to import
-            libworhp,                                    // the library
-            "WorhpInit"                                  // name of the function to import
-        );
-        WorhpDiag = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                            Control *)>( // type of the function to import
-            libworhp,                                    // the library
-            "WorhpDiag"                                  // name of the function to import
-        );
-        ReadParams = boost::dll::import<void(int *, const char[], Params *)>( // type of the function to import
-            libworhp,                                                   // the library
-            "ReadParams"                                                // name of the function to import
-        );
-        SetWorhpPrint = boost::dll::import<void(worhp_print_t)>( // type of the function to import
-            libworhp,                                            // the library
-            "SetWorhpPrint"                                      // name of the function to import
-        );
-        GetUserAction = boost::dll::import<bool(const Control *, int)>( // type of the function to import
-            libworhp,                                                   // the library
-            "GetUserAction"                                             // name of the function to import
-        );
-        DoneUserAction = boost::dll::import<void(Control *, int)>( // type of the function to import
-            libworhp,                                              // the library
-            "DoneUserAction"                                       // name of the function to import
-        );
-        IterationOutput = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                                  Control *)>( // type of the function to import
-            libworhp,                                          // the library
-            "IterationOutput"                                  // name of the function to import
-        );
-        Worhp = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                        Control *)>( // type of the function to import
-            libworhp,                                // the library
-            "Worhp"                                  // name of the function to import
-        );
-        StatusMsg = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                            Control *)>( // type of the function to import
-            libworhp,                                    // the library
-            "StatusMsg"                                  // name of the function to import
-        );
-        StatusMsgString = boost::dll::import<void(OptVar *, Workspace *, Params *, Control *,
-                                                  char message[])>( // type of the function to import
-            libworhp,                                               // the library
-            "StatusMsgString"                                       // name of the function to import
-        );
-        WorhpSetBoolParam = boost::dll::import<bool(Params *, const char *, bool)>( // type of the function to import
-            libworhp,                                                               // the library
-            "WorhpSetBoolParam"                                                     // name of the function to import
-        );
-        WorhpSetIntParam = boost::dll::import<bool(Params *, const char *, int)>( // type of the function to import
-            libworhp,                                                             // the library
-            "WorhpSetIntParam"                                                    // name of the function to import
-        );
-        WorhpSetDoubleParam
-            = boost::dll::import<bool(Params *, const char *, double)>( // type of the function to import
-                libworhp,                                               // the library
-                "WorhpSetDoubleParam"                                   // name of the function to import
-            );
-        WorhpFree = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                            Control *)>( // type of the function to import
-            libworhp,                                    // the library
-            "WorhpFree"                                  // name of the function to import
-        );
-        WorhpFidif = boost::dll::import<void(OptVar *, Workspace *, Params *,
-                                             Control *)>( // type of the function to import
-            libworhp,                                     // the library
-            "WorhpFidif"                                  // name of the function to import
-        );
-        WorhpVersion = boost::dll::import<void(int *major, int *minor,
-                                               char patch[PATCH_STRING_LENGTH])>( // type of the function to import
-            libworhp,                                                             // the library
-            "WorhpVersion"                                                        // name of the function to import
-        );
-    } catch (const std::exception &e) {
-        std::string message(
-            R"(
+    // The library is loaded and its symbols are resolved only once per process: subsequent calls will get
+    // the very same symbol table without any file system access or locking.
+    const auto &symbols = detail::library_registry<detail::worhp_symbols>::get(m_worhp_library, 0u, [&]() {
+        // We try to load the library at run time and locate the symbols used.
+        try {
+            if (!boost::filesystem::is_regular_file(library_filename)) {
+                pagmo_throw(std::invalid_argument,
+                            "The worhp library file name was constructed to be: " + library_filename.string()
+                                + " and it does not appear to be a file");
+            }
+            boost::dll::shared_library libworhp(library_filename);
+            return std::make_shared<const detail::worhp_symbols>(libworhp);
+        } catch (const std::exception &e) {
+            std::string message(
+                R"(
 An error occurred while loading the worhp library at run-time. This is typically caused by one of the following
 reasons:
 
 - The file declared to be the worhp library, i.e. )"
-            + m_worhp_library
-            + R"(, is not found or is found but it is not a shared library containing the necessary symbols 
+                + m_worhp_library
+                + R"(, is not found or is found but it is not a shared library containing the necessary symbols 
 (is the file really a valid shared library?)
  - The library is found and it does contain the symbols, but it needs linking to some additional libraries that are not found
 at run-time.
@@ -304,8 +396,23 @@ at run-time.
 We report the exact text of the original exception thrown:
 
  )" + std::string(e.what()));
-        pagmo_throw(std::invalid_argument, message);
-    }
+            pagmo_throw(std::invalid_argument, message);
+        }
+    });
+    const auto ReadParams = symbols.ReadParams;
+    const auto WorhpPreInit = symbols.WorhpPreInit;
+    const auto GetUserAction = symbols.GetUserAction;
+    const auto DoneUserAction = symbols.DoneUserAction;
+    const auto IterationOutput = symbols.IterationOutput;
+    const auto Worhp = symbols.Worhp;
+    const auto StatusMsg = symbols.StatusMsg;
+    const auto StatusMsgString = symbols.StatusMsgString;
+    const auto WorhpFidif = symbols.WorhpFidif;
+    const auto WorhpSetBoolParam = symbols.WorhpSetBoolParam;
+    const auto WorhpSetIntParam = symbols.WorhpSetIntParam;
+    const auto WorhpSetDoubleParam = symbols.WorhpSetDoubleParam;
+    const auto WorhpVersion = symbols.WorhpVersion;
+    const auto SetWorhpPrint = symbols.SetWorhpPrint;
     // ------------------------- END WORHP PLUGIN -------------------------------------------------------------
 
     // We check for a version mismatch
@@ -323,43 +430,43 @@ We report the exact text of the original exception thrown:
     }
 
     // All is good, proceed
-    m_log.clear();
+    // The log is preallocated, if bounded.
+    m_log = columnar_log_type(m_log.capacity());
+    m_major_log.clear();
+    m_cache_stats.clear();
+    // The screen output goes through the sink, which in the async mode writes it from a separate thread.
+    detail::output_sink sink(m_output_mode);
     auto fevals0 = prob.get_fevals();
 
-    // With reference to the worhp User Manual (V1.12)
-    // USI-0:  Call WorhpPreInit to properly initialise the (empty) data structures.
-    OptVar opt;
-    Workspace wsp;
-    Params par;
-    Control cnt;
-    WorhpPreInit(&opt, &wsp, &par, &cnt);
-
-    // USI-1: Read parameters from XML
-    // Note that a file named "param.xml" will be searched in the current directory only if the environment variable
-    // WORHP_PARAM_FILE is not set. Otherwise the WORHP_PARAM_FILE will be used. The number of parameters that are
-    // not getting default values will be stored in n_xml_param
-    int n_xml_param;
-    if (m_verbosity) { // pagmo log is active
-        ReadParams(&n_xml_param, const_cast<char *>("param.xml"), &par);
-        SetWorhpPrint(detail::no_screen_output);
-    } else {
-        if (!m_screen_output) { // pagmo log is active
-            SetWorhpPrint(detail::no_screen_output);
-        }
-        ReadParams(&n_xml_param, const_cast<char *>("param.xml"), &par);
-    }
-
-    // USI-2: Specify problem dimensions
-    opt.n = static_cast<int>(dim);
-    opt.m = static_cast<int>(prob.get_nc()); // number of constraints
     auto n_eq = prob.get_nec();
-    // Get the sparsity pattern of the gradient
-    auto pagmo_gs = prob.gradient_sparsity();
+    // We define the initial value for the chromosome
+    // We init the starting point using the inherited methods from not_population_based
+    auto sel_xf = select_individual(pop);
+    vector_double x0(std::move(sel_xf.first)), f0(std::move(sel_xf.second)); // TODO: is f0 useful to worhp?
+    // Get the sparsity pattern of the gradient. When requested, the gradient sparsity not provided by the problem
+    // is detected by the plugin.
+    const bool detect = m_sparsity_detection && !prob.has_gradient_sparsity();
+    const auto pagmo_gs = detect ? *detail::cached_gradient_sparsity(prob, x0, m_bfe ? *m_bfe : pagmo::bfe{})
+                                 : prob.gradient_sparsity();
     // Determine where the gradients of the constraints start in the fitness gradient.
     const auto it = std::lower_bound(pagmo_gs.begin(), pagmo_gs.end(), sparsity_pattern::value_type(1u, 0u));
     // Split the sparsity into f and g parts
     sparsity_pattern fs(pagmo_gs.begin(), it);
     sparsity_pattern gs(it, pagmo_gs.end());
+    // When the problem does not provide the gradient but a bfe was set, the gradient is computed by the plugin
+    // and passed to WORHP as if it was provided by the user.
+    const bool fd = !prob.has_gradient() && m_bfe;
+    boost::optional<detail::fd_gradient> fd_grad;
+    if (fd) {
+        fd_grad.emplace(prob, pagmo_gs, *m_bfe);
+    }
+    // When requested, and the problem provides the gradient but not the hessians, the hessians are computed by the
+    // plugin differencing the gradient, and passed to WORHP as if they were provided by the user.
+    const bool fd_hm = m_fd_hessians && prob.has_gradient() && !prob.has_hessians();
+    boost::optional<detail::fd_hessians> fd_hess;
+    if (fd_hm) {
+        fd_hess.emplace(prob);
+    }
     // Create the corresponding index map between pagmo and worhp sparse representation of the gradient
     std::vector<vector_double::size_type> gs_idx_map(gs.size());
     std::iota(gs_idx_map.begin(), gs_idx_map.end(), 0);
@@ -369,133 +476,226 @@ We report the exact text of the original exception thrown:
                   return (gs[idx1].second < gs[idx2].second
                           || (!(gs[idx2].second < gs[idx1].second) && gs[idx1].first < gs[idx2].first));
               });
+    // The position of the elements of DF and DG in the gradient computed by the problem (or by the plugin). If the
+    // gradient sparsity was detected, the gradient computed by the problem is dense.
+    const auto grad_idx = (detect && prob.has_gradient()) ? detail::dense_gradient_positions(pagmo_gs, dim)
+                                                          : std::vector<vector_double::size_type>{};
+    const auto grad_pos = [&grad_idx](vector_double::size_type k) { return grad_idx.empty() ? k : grad_idx[k]; };
+    // The gradient sparsity detected by probing might miss some nonzeros: they are checked at each gradient
+    // evaluation.
+    const auto dropped_pos = grad_idx.empty() ? std::vector<vector_double::size_type>{}
+                                              : detail::dropped_gradient_positions(pagmo_gs, prob.get_nf(), dim);
+    bool sparsity_mismatch = false;
+    std::vector<vector_double::size_type> df_idx_map(fs.size()), dg_idx_map(gs.size());
+    for (decltype(fs.size()) i = 0u; i < fs.size(); ++i) {
+        df_idx_map[i] = grad_pos(i);
+    }
+    for (decltype(gs.size()) i = 0u; i < gs.size(); ++i) {
+        dg_idx_map[i] = grad_pos(fs.size() + gs_idx_map[i]);
+    }
 
     // NOTE: Worhp requires a single sparsity pattern for the hessian of the lagrangian (that is,
     // the pattern must be valid for objfun and all constraints), but we provide a separate sparsity pattern for
     // objfun and every constraint. We will thus need to merge our sparsity patterns in a single sparsity
     // pattern.
-    sparsity_pattern merged_hs;
-    // Store the original hessians sparsity only if it is user-provided.
-    auto hs = prob.hessians_sparsity();
-    if (prob.has_hessians_sparsity()) {
-        for (const auto &sp : hs) {
-            // NOTE: we need to create a separate copy each time as std::set_union() requires distinct ranges.
-            const auto old_merged_hs(merged_hs);
-            merged_hs.clear();
-            std::set_union(old_merged_hs.begin(), old_merged_hs.end(), sp.begin(), sp.end(),
-                           std::back_inserter(merged_hs));
-        }
+    // NOTE: the hessians sparsity is needed only if WORHP uses the hessians computed by pagmo or, when WORHP
+    // approximates the hessian of the lagrangian itself, if it is user-provided. Otherwise, the HM structure is
+    // dense for small problems and block diagonal for large ones, and the (dense) hessians sparsity, which would
+    // need O(nf * dim^2) memory, is not materialised.
+    const bool user_hm = prob.has_hessians() || fd_hm;
+    vector_double::size_type hm_block = 0u;
+    std::vector<sparsity_pattern> hs;
+    if (user_hm || prob.has_hessians_sparsity()) {
+        hs = prob.hessians_sparsity();
+    } else if (dim <= detail::hm_dense_max_dim
+               || (m_integer_opts.count("BFGSmethod") && m_integer_opts.at("BFGSmethod") == detail::bfgs_dense)) {
+        // NOTE: a dense BFGS update explicitly requested by the user needs the dense structure, whatever the
+        // dimension.
+        hs.push_back(pagmo::detail::dense_hessian(dim));
     } else {
-        // If the hessians sparsity is not user-provided, dense patterns are assumed.
-        merged_hs = pagmo::detail::dense_hessian(prob.get_nx());
+        const auto it_block = m_integer_opts.find("BFGSmaxblockSize");
+        hm_block = (it_block != m_integer_opts.end() && it_block->second > 0)
+                       ? static_cast<vector_double::size_type>(it_block->second)
+                       : detail::hm_default_block_size;
+        hs.push_back(detail::block_diagonal_hessian(dim, hm_block));
     }
-    // -------------------------------------------------------------------------------------------------------------------------
     /*
      * In WORHP the HM sparsity requires lower triangular entries first,
      * then all the diagonal elements (also the zeros) (cani maledetti^2)
      */
-    // Create the corresponding index map between pagmo and worhp sparse representation of the lower triangular part
-    // of the hessian of the lagrangian
-    std::vector<vector_double::size_type> hs_idx_map(merged_hs.size());
-    std::iota(hs_idx_map.begin(), hs_idx_map.end(), 0);
-    // Sort the resulting hessian of the lagrangian sparsity according to worhp twisted choice.
-    // Lexicographic from right to left, i.e. ((1,0),(2,0),(0,1), )
-    std::sort(hs_idx_map.begin(), hs_idx_map.end(),
-              [&merged_hs](const vector_double::size_type &idx1, const vector_double::size_type &idx2) -> bool {
-                  return (merged_hs[idx1].second < merged_hs[idx2].second
-                          || (!(merged_hs[idx2].second < merged_hs[idx1].second)
-                              && merged_hs[idx1].first < merged_hs[idx2].first));
-              });
-
-    // We remove the diagonal entries from the hessian sparsity as merged from pagmo (if present)
-    auto it2 = std::remove_if(hs_idx_map.begin(), hs_idx_map.end(),
-                              [&merged_hs](std::vector<vector_double::size_type>::size_type &idx) -> bool {
-                                  return (merged_hs[idx].first == merged_hs[idx].second);
-                              });
-    hs_idx_map.erase(it2, hs_idx_map.end());
-
-    wsp.DF.nnz = static_cast<int>(fs.size());
-    wsp.DG.nnz = static_cast<int>(gs.size());
-    wsp.HM.nnz = static_cast<int>(hs_idx_map.size() + dim); // lower triangular sparse + full diagonal
-
-    // USI-3 (and 8): Allocate solver memory (and deallocate upon destruction of wr)
-    detail::worhp_raii wr(&opt, &wsp, &par, &cnt, WorhpInit, WorhpFree);
-
-    // This flag informs Worhp that f and g should not be evaluated seperately. pagmo fitness always computes both
-    // so that if only the objfun is needed also the constraints are computed. This flag signals to worhp that this
-    // is the case. Since the flag makes sense only for constrained problems, we set it only if necessary (worhp
-    // would otherwise print a warning)
-    if (prob.get_nc() > 0) {
-        par.FGtogether = true;
+    // The merged pattern, the index map between its pagmo and worhp sparse representations (lower triangular part
+    // only) and the scatter plan used to assemble the hessian of the lagrangian in UserHM.
+    const auto hm_str = detail::cached_hm_structure(hs, dim);
+    const auto &merged_hs = hm_str->m_merged;
+    const auto &hs_idx_map = hm_str->m_idx_map;
+    const auto &hm_plan = hm_str->m_plan;
+    // When requested, the hessian of the lagrangian is assembled in parallel via the gather plan.
+    const auto hm_threads = m_hm_threads == 0u ? detail::default_nthreads() : std::size_t(m_hm_threads);
+    boost::optional<detail::hm_gather> hm_gather;
+    if (hm_threads > 1u && user_hm) {
+        hm_gather.emplace(hm_plan, hs, hs_idx_map.size() + dim, hm_threads);
     }
 
-    // We deal with the gradient
-    if (prob.has_gradient()) {
-        WorhpSetBoolParam(&par, "UserDF", true);
-        WorhpSetBoolParam(&par, "UserDG", true);
-    } else {
-        WorhpSetBoolParam(&par, "UserDF", false);
-        WorhpSetBoolParam(&par, "UserDG", false);
-    }
-    if (prob.has_hessians()) {
-        WorhpSetBoolParam(&par, "UserHM", true);
-    } else {
-        WorhpSetBoolParam(&par, "UserHM", false);
+    // -------------------------------------------------------------------------------------------------------------------------
+    // We get the WORHP data structures. In the persistent workspace mode those stored in m_context are re-used,
+    // unless they are being used by a concurrent evolve() of a copy of this object, in which case we fall back to
+    // temporary data structures.
+    detail::worhp_solver tmp_solver(symbols);
+    auto *solver = &tmp_solver;
+    std::unique_lock<std::mutex> context_lock;
+    if (m_context) {
+        context_lock = std::unique_lock<std::mutex>(m_context->m_mutex, std::try_to_lock);
+        if (context_lock.owns_lock()) {
+            if (!m_context->m_solver || m_context->m_solver->m_symbols != &symbols) {
+                // First use, or the data structures were created by a different library.
+                m_context->m_solver = std::make_unique<detail::worhp_solver>(symbols);
+            }
+            solver = m_context->m_solver.get();
+        }
     }
+    auto &opt = solver->m_opt;
+    auto &wsp = solver->m_wsp;
+    auto &par = solver->m_par;
+    auto &cnt = solver->m_cnt;
+    // If the previous run was made on a problem with the very same signature, the data structures (and the
+    // parameters) are still valid and WORHP needs only to be restarted (see USI-7 below).
+    detail::worhp_signature signature{static_cast<int>(dim),
+                                      static_cast<int>(prob.get_nc()),
+                                      fs,
+                                      gs,
+                                      merged_hs,
+                                      prob.has_gradient() || fd,
+                                      user_hm,
+                                      prob.get_c_tol(),
+                                      m_numeric_opts,
+                                      m_integer_opts,
+                                      m_bool_opts,
+                                      m_param_source};
+    const bool restart = symbols.WorhpRestart && solver->m_reusable && solver->m_signature == signature;
+
+    if (!restart) {
+        solver->reset();
+        // With reference to the worhp User Manual (V1.12)
+        // USI-0:  Call WorhpPreInit to properly initialise the (empty) data structures.
+        WorhpPreInit(&opt, &wsp, &par, &cnt);
+
+        // USI-1: Read parameters from XML
+        // The parameter source is parsed only at the first run: the parameters are then copied from the
+        // snapshot taken. NOTE: when the pagmo log is active, the output of ReadParams is not suppressed.
+        if (!m_verbosity && !m_screen_output) {
+            SetWorhpPrint(detail::no_screen_output);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_params->m_mutex);
+            if (!m_params->m_parsed || m_params->m_source != m_param_source) {
+                detail::read_params(ReadParams, m_param_source, &par);
+                m_params->m_par = par;
+                m_params->m_source = m_param_source;
+                m_params->m_parsed = true;
+            } else {
+                par = m_params->m_par;
+            }
+        }
+        if (m_verbosity) { // pagmo log is active
+            SetWorhpPrint(detail::no_screen_output);
+        }
 
-    // Logic for the handling of constraints tolerances. The logic is as follows:
-    // - if the user provides the "TolFeas" option, use that *unconditionally*. Otherwise,
-    // - compute the minimum tolerance min_tol among those returned by  problem.c_tol(). If zero, ignore
-    //   it and use the WORHP default value for "TolFeas" (1e-6). Otherwise, use min_tol as
-    //   the value for "TolFeas" and min_tol/2 for AcceptTolFeas
-    if (prob.get_nc() && !m_numeric_opts.count("TolFeas")) {
-        const auto c_tol = prob.get_c_tol();
-        assert(!c_tol.empty());
-        const double min_tol = *std::min_element(c_tol.begin(), c_tol.end());
-        if (min_tol > 0.) {
-            auto res = WorhpSetDoubleParam(&par, "TolFeas", min_tol);
-            res = WorhpSetDoubleParam(&par, "AcceptTolFeas", min_tol / 2);
-            assert(res == true);
+        // USI-2: Specify problem dimensions
+        opt.n = static_cast<int>(dim);
+        opt.m = static_cast<int>(prob.get_nc()); // number of constraints
+        wsp.DF.nnz = static_cast<int>(fs.size());
+        wsp.DG.nnz = static_cast<int>(gs.size());
+        wsp.HM.nnz = static_cast<int>(hs_idx_map.size() + dim); // lower triangular sparse + full diagonal
+
+        // USI-3 (and 8): Allocate solver memory (deallocated upon destruction, or reset, of solver)
+        symbols.WorhpInit(&opt, &wsp, &par, &cnt);
+        solver->m_initialized = true;
+
+        // This flag informs Worhp that f and g should not be evaluated seperately. pagmo fitness always computes both
+        // so that if only the objfun is needed also the constraints are computed. This flag signals to worhp that this
+        // is the case. Since the flag makes sense only for constrained problems, we set it only if necessary (worhp
+        // would otherwise print a warning)
+        if (prob.get_nc() > 0) {
+            par.FGtogether = true;
         }
-    }
 
-    // We now set the user defined options
-    // floats
-    for (const auto &p : m_numeric_opts) {
-        auto success = WorhpSetDoubleParam(&par, p.first.c_str(), p.second);
-        if (!success) {
-            pagmo_throw(std::invalid_argument,
-                        "The option '" + p.first + "' was requested by the user to be set to the float value "
-                            + std::to_string(p.second)
-                            + ", but WORHP interface returned an error. Did you mispell the option name?");
+        // We deal with the gradient (computed by the plugin, if not provided by the problem and a bfe was set)
+        if (prob.has_gradient() || fd) {
+            WorhpSetBoolParam(&par, "UserDF", true);
+            WorhpSetBoolParam(&par, "UserDG", true);
+        } else {
+            WorhpSetBoolParam(&par, "UserDF", false);
+            WorhpSetBoolParam(&par, "UserDG", false);
         }
-    }
-    // int
-    for (const auto &p : m_integer_opts) {
-        auto success = WorhpSetIntParam(&par, p.first.c_str(), p.second);
-        if (!success) {
-            pagmo_throw(std::invalid_argument,
-                        "The option '" + p.first + "' was requested by the user to be set to the integer value "
-                            + std::to_string(p.second)
-                            + ", but WORHP interface returned an error. Did you mispell the option name?");
+        if (user_hm) {
+            WorhpSetBoolParam(&par, "UserHM", true);
+        } else {
+            WorhpSetBoolParam(&par, "UserHM", false);
         }
-    }
-    // bool
-    for (const auto &p : m_bool_opts) {
-        auto success = WorhpSetBoolParam(&par, p.first.c_str(), p.second);
-        if (!success) {
-            pagmo_throw(std::invalid_argument,
-                        "The option '" + p.first + "' was requested by the user to be set to the bool value "
-                            + std::to_string(p.second)
-                            + ", but WORHP interface returned an error. Did you mispell the option name?");
+        // The block diagonal HM structure needs the block BFGS update, with matching blocks, unless the user
+        // requested a BFGS method.
+        if (hm_block && !m_integer_opts.count("BFGSmethod")) {
+            WorhpSetIntParam(&par, "BFGSmethod", detail::bfgs_block);
+            WorhpSetIntParam(&par, "BFGSmaxblockSize", static_cast<int>(hm_block));
+        }
+
+        // Logic for the handling of constraints tolerances. The logic is as follows:
+        // - if the user provides the "TolFeas" option, use that *unconditionally*. Otherwise,
+        // - compute the minimum tolerance min_tol among those returned by  problem.c_tol(). If zero, ignore
+        //   it and use the WORHP default value for "TolFeas" (1e-6). Otherwise, use min_tol as
+        //   the value for "TolFeas" and min_tol/2 for AcceptTolFeas
+        if (prob.get_nc() && !m_numeric_opts.count("TolFeas")) {
+            const auto c_tol = prob.get_c_tol();
+            assert(!c_tol.empty());
+            const double min_tol = *std::min_element(c_tol.begin(), c_tol.end());
+            if (min_tol > 0.) {
+                auto res = WorhpSetDoubleParam(&par, "TolFeas", min_tol);
+                res = WorhpSetDoubleParam(&par, "AcceptTolFeas", min_tol / 2);
+                assert(res == true);
+            }
+        }
+
+        // We now set the user defined options
+        // floats
+        for (const auto &p : m_numeric_opts) {
+            auto success = WorhpSetDoubleParam(&par, p.first.c_str(), p.second);
+            if (!success) {
+                pagmo_throw(std::invalid_argument,
+                            "The option '" + p.first + "' was requested by the user to be set to the float value "
+                                + std::to_string(p.second)
+                                + ", but WORHP interface returned an error. Did you mispell the option name?");
+            }
+        }
+        // int
+        for (const auto &p : m_integer_opts) {
+            auto success = WorhpSetIntParam(&par, p.first.c_str(), p.second);
+            if (!success) {
+                pagmo_throw(std::invalid_argument,
+                            "The option '" + p.first + "' was requested by the user to be set to the integer value "
+                                + std::to_string(p.second)
+                                + ", but WORHP interface returned an error. Did you mispell the option name?");
+            }
+        }
+        // bool
+        for (const auto &p : m_bool_opts) {
+            auto success = WorhpSetBoolParam(&par, p.first.c_str(), p.second);
+            if (!success) {
+                pagmo_throw(std::invalid_argument,
+                            "The option '" + p.first + "' was requested by the user to be set to the bool value "
+                                + std::to_string(p.second)
+                                + ", but WORHP interface returned an error. Did you mispell the option name?");
+            }
         }
+        solver->m_initial_lm_est = par.InitialLMest;
+    } else if (m_verbosity || !m_screen_output) {
+        // The parameters are already set, but the print function is global and might have been changed.
+        SetWorhpPrint(detail::no_screen_output);
     }
+    // The data structures will be reusable only if this run terminates normally.
+    solver->m_reusable = false;
 
     // USI-5: Set initial values and deal with gradients / hessians
-    // We define the initial value for the chromosome
-    // We init the starting point using the inherited methods from not_population_based
-    auto sel_xf = select_individual(pop);
-    vector_double x0(std::move(sel_xf.first)), f0(std::move(sel_xf.second)); // TODO: is f0 useful to worhp?
+    // The starting point (x0, f0) was selected above.
     for (vector_double::size_type i = 0u; i < static_cast<vector_double::size_type>(opt.n); ++i) {
         opt.X[i] = x0[i];
     }
@@ -523,15 +723,36 @@ We report the exact text of the original exception thrown:
         opt.GL[i] = -par.Infty;
         opt.GU[i] = 0;
     }
+    // In the warm start mode, the final multipliers of a previous run on the same problem are the initial ones: those
+    // found nearest to x0 in the warm start database, if active, or else those of the last run. WORHP must then not
+    // replace them with its own initial estimate.
+    const detail::warm_start_db<warm_start_data_type>::key_type ws_key{prob.get_name(), dim, prob.get_nf()};
+    const warm_start_data_type *ws_data = nullptr;
+    if (m_warm_start) {
+        ws_data = m_warm_start_db.nearest(ws_key, x0, detail::warm_start_scale(lb, ub));
+        if (!ws_data && std::get<0>(m_warm_start_data) == prob.get_name()) {
+            ws_data = &m_warm_start_data;
+        }
+    }
+    const bool warm
+        = ws_data && std::get<2>(*ws_data).size() == dim && std::get<3>(*ws_data).size() == prob.get_nc();
+    if (warm) {
+        std::copy(std::get<2>(*ws_data).begin(), std::get<2>(*ws_data).end(), opt.Lambda);
+        std::copy(std::get<3>(*ws_data).begin(), std::get<3>(*ws_data).end(), opt.Mu);
+        if (m_verbosity) {
+            sink.print("Warm start from the final multipliers of a previous optimisation.\n");
+        }
+    }
+    par.InitialLMest = warm ? false : solver->m_initial_lm_est;
 
     /*
      * Specify matrix structures in CS format, using Fortran indexing,
      * i.e. 1...N instead of 0...N-1, to describe the matrix structure.
-     * Only if the declared size is not dense.
+     * Only if the declared size is not dense and the structures were not already assigned in a previous run.
      */
     // -------------------------------------------------------------------------------------------------------------------------
     // Assign sparsity structure to DF
-    if (wsp.DF.NeedStructure) {
+    if (!restart && wsp.DF.NeedStructure) {
         for (decltype(fs.size()) i = 0; i < fs.size(); ++i) {
             // NOTE: the +1 is because of fortran notation is required by WORHP (maledetti).
             wsp.DF.row[i] = static_cast<int>(fs[i].second + 1);
@@ -539,7 +760,7 @@ We report the exact text of the original exception thrown:
     }
     // -------------------------------------------------------------------------------------------------------------------------
     // Assign sparsity structure to DG if not dense.
-    if (wsp.DG.NeedStructure) {
+    if (!restart && wsp.DG.NeedStructure) {
         for (decltype(gs_idx_map.size()) i = 0u; i < gs_idx_map.size(); ++i) {
             // NOTE: no need for +1 here as in pagmo 0 is the objfun already stripped from here.
             wsp.DG.row[i] = static_cast<int>(gs[gs_idx_map[i]].first);
@@ -550,7 +771,7 @@ We report the exact text of the original exception thrown:
     // -------------------------------------------------------------------------------------------------------------------------
     // Assign sparsity structure to HM if not dense. (this requires to perform the same operations as above,
     // but directly on the merged_hs not on the iota)
-    if (wsp.HM.NeedStructure) {
+    if (!restart && wsp.HM.NeedStructure) {
         // Strict lower triangle
         for (decltype(hs_idx_map.size()) i = 0u; i < hs_idx_map.size(); ++i) {
             // NOTE: the +1 is because fortran notation is required by WORHP (maledetti).
@@ -568,53 +789,85 @@ We report the exact text of the original exception thrown:
     // -------------------------------------------------------------------------------------------------------------------------
 
     if (m_verbosity) {
-        print("WORHP version is (library): ", major, ".", minor, ".", patchstr, "\n");
-        print("WORHP version is (plugin headers): ", WORHP_VERSION, "\n");
-        print("\nWORHP plugin for pagmo/pygmo: \n");
+        sink.print("WORHP version is (library): ", major, ".", minor, ".", patchstr, "\n");
+        sink.print("WORHP version is (plugin headers): ", WORHP_VERSION, "\n");
+        sink.print("\nWORHP plugin for pagmo/pygmo: \n");
         if (prob.has_gradient_sparsity()) {
-            print("\tThe gradient sparsity is provided by the user: ", pagmo_gs.size(), " components detected.\n");
+            sink.print("\tThe gradient sparsity is provided by the user: ", pagmo_gs.size(), " components detected.\n");
+        } else if (detect) {
+            sink.print("\tThe gradient sparsity is detected by the plugin: ", pagmo_gs.size(),
+                       " components detected.\n");
         } else {
-            print("\tThe gradient sparsity is assumed dense: ", pagmo_gs.size(), " components detected.\n");
+            sink.print("\tThe gradient sparsity is assumed dense: ", pagmo_gs.size(), " components detected.\n");
         }
         if (prob.has_gradient()) {
-            print("\tThe gradient is provided by the user.\n");
+            sink.print("\tThe gradient is provided by the user.\n");
+        } else if (fd) {
+            sink.print("\tThe gradient is computed numerically by the plugin, evaluating ", fd_grad->get_ncolors(),
+                       " perturbed points per gradient via the batch fitness evaluator.\n");
         } else {
-            print("\tThe gradient is computed numerically by WORHP.\n");
+            sink.print("\tThe gradient is computed numerically by WORHP.\n");
         }
-        print("\tThe hessian of the lagrangian sparsity has: ", merged_hs.size(), " components.\n");
+        sink.print("\tThe hessian of the lagrangian sparsity has: ", merged_hs.size(), " components.\n");
 
         if (prob.has_hessians()) {
-            print("\tThe hessians are provided by the user.\n");
+            sink.print("\tThe hessians are provided by the user.\n");
+        } else if (fd_hm) {
+            sink.print("\tThe hessians are computed numerically by the plugin, evaluating ", fd_hess->get_ncolors(),
+                       " perturbed gradients per hessian.\n");
         } else {
-            print("\tThe hessian of the lagrangian is computed numerically by WORHP.\n");
+            sink.print("\tThe hessian of the lagrangian is computed numerically by WORHP.\n");
+            if (hm_block) {
+                sink.print("\tThe hessian of the lagrangian sparsity is assumed block diagonal, with blocks of size ",
+                           hm_block, ".\n");
+            }
+        }
+        sink.print("\nThe following parameters have been set by pagmo to values other than their xml provided ones (or "
+                   "their default ones): \n");
+        sink.print("\tpar.FGtogether: ", par.FGtogether, "\n");
+        sink.print("\tpar.UserDF: ", par.UserDF, "\n");
+        sink.print("\tpar.UserDG: ", par.UserDG, "\n");
+        sink.print("\tpar.UserHM: ", par.UserHM, "\n");
+        if (hm_block && !m_integer_opts.count("BFGSmethod")) {
+            sink.print("\tpar.BFGSmethod: ", detail::bfgs_block, "\n");
+            sink.print("\tpar.BFGSmaxblockSize: ", hm_block, "\n");
         }
-        print("\nThe following parameters have been set by pagmo to values other than their xml provided ones (or "
-              "their default ones): \n");
-        print("\tpar.FGtogether: ", par.FGtogether, "\n");
-        print("\tpar.UserDF: ", par.UserDF, "\n");
-        print("\tpar.UserDG: ", par.UserDG, "\n");
-        print("\tpar.UserHM: ", par.UserHM, "\n");
-        print("\tpar.TolFeas: ", par.UserHM, "\n");
-        print("\tpar.AcceptTolFeas: ", par.UserHM, "\n");
+        sink.print("\tpar.TolFeas: ", par.UserHM, "\n");
+        sink.print("\tpar.AcceptTolFeas: ", par.UserHM, "\n");
         // floats
         for (const auto &p : m_numeric_opts) {
-            print("\tpar.", p.first, ": ", p.second, "\n");
+            sink.print("\tpar.", p.first, ": ", p.second, "\n");
         }
         // int
         for (const auto &p : m_integer_opts) {
-            print("\tpar.", p.first, ": ", p.second, "\n");
+            sink.print("\tpar.", p.first, ": ", p.second, "\n");
         }
         // bool
         for (const auto &p : m_bool_opts) {
-            print("\tpar.", p.first, ": ", p.second, "\n");
+            sink.print("\tpar.", p.first, ": ", p.second, "\n");
         }
 
-        print("\n", std::setw(10), "objevals:", std::setw(15), "objval:", std::setw(15), "violated:", std::setw(15),
-              "viol. norm:", '\n');
+        if (m_log_majors) {
+            sink.print("\n", std::setw(10), "major:", std::setw(15), "objval:", std::setw(15), "viol. norm:",
+                       std::setw(15), "optimality:", std::setw(15), "step:", '\n');
+        } else {
+            sink.print("\n", std::setw(10), "objevals:", std::setw(15), "objval:", std::setw(15), "violated:",
+                       std::setw(15), "viol. norm:", '\n');
+        }
     }
 
+    // The fitness_and_gradient() of the UDP, if registered (see ppnf::has_fitness_and_gradient)
+    const auto fitness_and_gradient = detail::get_fitness_and_gradient(prob);
+    // The fitness, gradient and hessians caches, as WORHP repeatedly requests the values at the same points
+    // (e.g., the objective and the constraints separately, or at a previous iterate after a line search backtracking).
+    detail::evaluation_cache cache(m_cache_size);
+
     // -------------------------------------------------------------------------------------------------------------------------
     // USI-7: Run the solver
+    // When re-using the data structures of a previous run, WORHP is restarted from the new initial values and bounds.
+    if (restart) {
+        symbols.WorhpRestart(&opt, &wsp, &par, &cnt);
+    }
     /*
      * WORHP Reverse Communication loop.
      * In every iteration poll GetUserAction for the requested action, i.e. one
@@ -639,15 +892,47 @@ We report the exact text of the original exception thrown:
          */
         if (GetUserAction(&cnt, iterOutput)) {
             IterationOutput(&opt, &wsp, &par, &cnt);
+            if (m_log_majors && m_verbosity) {
+                update_major_log(opt, wsp, sink);
+            }
             DoneUserAction(&cnt, iterOutput);
         }
 
+        /*
+         * If the fitness and the gradient are both requested at the current point, and the UDP can compute them
+         * together, we do so. The results are stored in the caches, where UserF, UserG, UserDF and UserDG will find
+         * them.
+         */
+        if (fitness_and_gradient && (GetUserAction(&cnt, evalF) || GetUserAction(&cnt, evalG))
+            && (GetUserAction(&cnt, evalDF) || GetUserAction(&cnt, evalDG))) {
+            vector_double x(opt.X, opt.X + dim);
+            if (!cache.m_f.contains(x) && !cache.m_g.contains(x)) {
+                auto fg = detail::fitness_and_gradient(prob, fitness_and_gradient, x,
+                                                       grad_idx.empty() ? pagmo_gs.size() : prob.get_nf() * dim);
+                cache.m_f.insert(x, std::move(fg.first));
+                cache.m_g.insert(x, std::move(fg.second));
+            }
+        }
+
+        /*
+         * If the gradient sparsity was detected, the elements of the gradient outside it must be zero. Otherwise,
+         * the run is stopped and started again with a dense gradient sparsity.
+         */
+        if (!dropped_pos.empty() && (GetUserAction(&cnt, evalDF) || GetUserAction(&cnt, evalDG))) {
+            const auto &g = detail::cached_gradient(cache, prob, vector_double(opt.X, opt.X + dim), fd_grad.get_ptr());
+            sparsity_mismatch = std::any_of(dropped_pos.begin(), dropped_pos.end(),
+                                            [&g](vector_double::size_type k) { return !(g[k] == 0.); });
+            if (sparsity_mismatch) {
+                break;
+            }
+        }
+
         /*
          * Evaluate the objective function.
          * The call to UserF may be replaced by user-defined code.
          */
         if (GetUserAction(&cnt, evalF)) {
-            UserF(&opt, &wsp, &par, &cnt, pop, fevals0);
+            UserF(&opt, &wsp, &par, &cnt, pop, fevals0, cache, sink);
             DoneUserAction(&cnt, evalF);
         }
 
@@ -656,7 +941,7 @@ We report the exact text of the original exception thrown:
          * The call to UserG may be replaced by user-defined code.
          */
         if (GetUserAction(&cnt, evalG)) {
-            UserG(&opt, &wsp, &par, &cnt, pop);
+            UserG(&opt, &wsp, &par, &cnt, pop, cache);
             DoneUserAction(&cnt, evalG);
         }
 
@@ -665,7 +950,7 @@ We report the exact text of the original exception thrown:
          * The call to UserDF may be replaced by user-defined code.
          */
         if (GetUserAction(&cnt, evalDF)) {
-            UserDF(&opt, &wsp, &par, &cnt, pop);
+            UserDF(&opt, &wsp, &par, &cnt, pop, df_idx_map, cache, fd_grad.get_ptr());
             DoneUserAction(&cnt, evalDF);
         }
 
@@ -674,7 +959,7 @@ We report the exact text of the original exception thrown:
          * The call to UserHM may be replaced by user-defined code.
          */
         if (GetUserAction(&cnt, evalHM)) {
-            UserHM(&opt, &wsp, &par, &cnt, pop, hs, merged_hs, hs_idx_map);
+            UserHM(&opt, &wsp, &par, &cnt, pop, hm_plan, hm_gather.get_ptr(), cache, fd_hess.get_ptr());
             DoneUserAction(&cnt, evalHM);
         }
 
@@ -683,7 +968,7 @@ We report the exact text of the original exception thrown:
          * The call to UserDG may be replaced by user-defined code.
          */
         if (GetUserAction(&cnt, evalDG)) {
-            UserDG(&opt, &wsp, &par, &cnt, pop, gs_idx_map);
+            UserDG(&opt, &wsp, &par, &cnt, pop, dg_idx_map, cache, fd_grad.get_ptr());
             DoneUserAction(&cnt, evalDG);
         }
 
@@ -696,6 +981,27 @@ We report the exact text of the original exception thrown:
             // No DoneUserAction!
         }
     }
+    if (sparsity_mismatch) {
+        // NOTE: the data structures are not reusable, as the run did not terminate normally.
+        if (m_verbosity) {
+            sink.print("\nThe detected gradient sparsity of the problem is incomplete: restarting with a dense one.\n");
+        }
+        sink.flush();
+        detail::discard_gradient_sparsity(prob);
+        if (context_lock.owns_lock()) {
+            context_lock.unlock();
+        }
+        return evolve(pop);
+    }
+    solver->m_signature = std::move(signature);
+    solver->m_reusable = true;
+    // The final primal-dual solution is stored, unless WORHP terminated with an error.
+    if (cnt.status >= TerminateSuccess) {
+        m_warm_start_data = warm_start_data_type{prob.get_name(), vector_double(opt.X, opt.X + opt.n),
+                                                 vector_double(opt.Lambda, opt.Lambda + opt.n),
+                                                 vector_double(opt.Mu, opt.Mu + opt.m)};
+        m_warm_start_db.insert(ws_key, std::get<1>(m_warm_start_data), m_warm_start_data);
+    }
     // ------- We reinsert the solution if better -----------------------------------------------------------
     // Store the new individual into the population, but only if it is improved.
     vector_double x_final(dim, 0);
@@ -704,7 +1010,9 @@ We report the exact text of the original exception thrown:
         x_final[i] = opt.X[i];
     }
 
-    f_final = prob.fitness(x_final);
+    // The final point is typically the last one evaluated.
+    f_final = cache.m_f.get(x_final, [&prob](const vector_double &x) { return prob.fitness(x); });
+    m_cache_stats = cache.stats();
 
     if (compare_fc(f_final, f0, prob.get_nec(), prob.get_c_tol())) {
         replace_individual(pop, x_final, f_final);
@@ -718,7 +1026,11 @@ We report the exact text of the original exception thrown:
 
     // And print it to screen if requested
     if (m_verbosity) {
-        print(m_last_opt_res, "\n");
+        sink.print(m_last_opt_res, "\n");
+        if (fd_hess && fd_hess->get_copies_gevals()) {
+            sink.print("Gradient evaluations made by the copies of the problem (not counted by the problem): ",
+                       fd_hess->get_copies_gevals(), "\n");
+        }
     } else if (m_screen_output) {
         StatusMsg(&opt, &wsp, &par, &cnt);
     }
@@ -732,7 +1044,8 @@ We report the exact text of the original exception thrown:
  * optimisation by pagmo and no logging is performed. If \p n is nonzero, then every \p n objective function
  * evaluations the status of the optimisation will be both printed to screen and recorded internally. See
  * worhp::log_line_type and worhp::log_type for information on the logging format. The internal log can be fetched
- * via get_log().
+ * via get_log() (and its size bounded via set_log_capacity()). In the ``"major"`` log mode (see set_log_mode()),
+ * major iterations are logged instead of objective function evaluations.
  *
  * @param n the desired verbosity level.
  *
@@ -787,12 +1100,139 @@ void worhp::set_verbosity(unsigned n)
  * See worhp::log_type for a description of the optimisation log. Logging is turned on/off via
  * set_verbosity().
  *
+ * The log is stored column by column (see get_columnar_log()): the returned lines are built from the columns at the
+ * first call after each change of the log, and then kept until the next change. C++ code processing large logs
+ * should rather access the columns directly, via get_columnar_log(), which involves no copies.
+ *
  * @return a const reference to the log.
  */
 const worhp::log_type &worhp::get_log() const
+{
+    auto storage = m_log.storage();
+    if (storage != m_log_lines_storage) {
+        m_log_lines = m_log.lines();
+        m_log_lines_storage = std::move(storage);
+    }
+    return m_log_lines;
+}
+/// Get the columnar optimisation log.
+/**
+ * This is the optimisation log as it is stored internally (see worhp::columnar_log_type), whose columns can be
+ * accessed without copies.
+ *
+ * @return a const reference to the columnar log.
+ */
+const worhp::columnar_log_type &worhp::get_columnar_log() const
 {
     return m_log;
 }
+/// Set the log capacity.
+/**
+ * By default, the optimisation log is unbounded, and its memory footprint grows with the number of objective
+ * function evaluations. If a capacity is set, the log columns are preallocated at the beginning of evolve(), and when
+ * the log is full every other line recorded so far is discarded: from then on, one line every 2 (4, 8, ...) lines
+ * is recorded. The log thus never holds more than \p n lines, which cover the whole optimisation in chronological
+ * order, and the log is kept without allocating memory during the optimisation. The lines printed to screen are not
+ * affected by the log capacity, and neither is the major iterations log (see set_log_mode()), whose size is bounded
+ * by the maximum number of major iterations.
+ *
+ * @param n the log capacity (0 for an unbounded log).
+ *
+ * @throws std::invalid_argument if \p n is 1.
+ */
+void worhp::set_log_capacity(unsigned n)
+{
+    if (n == 1u) {
+        pagmo_throw(std::invalid_argument, "The log capacity must be either 0 (unbounded) or at least 2");
+    }
+    m_log.set_capacity(n);
+}
+/// Get the log capacity.
+/**
+ * @return the log capacity (0 for an unbounded log, see set_log_capacity()).
+ */
+unsigned worhp::get_log_capacity() const
+{
+    return static_cast<unsigned>(m_log.capacity());
+}
+/// Set the log mode.
+/**
+ * In the default ``"evaluation"`` log mode, the status of the optimisation is printed and recorded every
+ * \p n objective function evaluations, \p n being the verbosity (see set_verbosity()), testing the constraints of
+ * each logged evaluation against the problem's tolerances. In the ``"major"`` log mode, it is instead printed and
+ * recorded every \p n major iterations, when WORHP requests the iteration output, reading the current iterate's data
+ * from the WORHP workspace (see worhp::major_log_line_type), and the log can be fetched via get_major_log(). In this
+ * mode, no work is done for the log when evaluating the fitness.
+ *
+ * Example (verbosity 1):
+ * @code{.unparsed}
+ *     major:        objval:    viol. norm:    optimality:          step:
+ *          0        48.9451           1.25           2.41              0 i
+ *          1         30.153          0.717           1.33              1 i
+ *          2        17.0142       0.000188         0.0141              1 i
+ *          3         17.014              0        1.9e-05              1
+ * @endcode
+ * The ``i`` at the end of some rows indicates that WORHP deems the iterate infeasible.
+ *
+ * @param mode the log mode, either ``"evaluation"`` or ``"major"``.
+ *
+ * @throws std::invalid_argument if \p mode is not one of ``"evaluation"`` and ``"major"``.
+ */
+void worhp::set_log_mode(const std::string &mode)
+{
+    if (mode != "evaluation" && mode != "major") {
+        pagmo_throw(std::invalid_argument,
+                    "The log mode must be either 'evaluation' or 'major', while '" + mode + "' was provided");
+    }
+    m_log_majors = mode == "major";
+}
+/// Get the log mode.
+/**
+ * @return the log mode, either ``"evaluation"`` or ``"major"`` (see set_log_mode()).
+ */
+std::string worhp::get_log_mode() const
+{
+    return m_log_majors ? "major" : "evaluation";
+}
+/// Get the major iterations log.
+/**
+ * See worhp::major_log_type for a description of the major iterations log.
+ *
+ * @return a const reference to the major iterations log.
+ */
+const worhp::major_log_type &worhp::get_major_log() const
+{
+    return m_major_log;
+}
+/// Set the screen output mode.
+/**
+ * This method selects how the screen output of the pagmo logging system (see set_verbosity()) is written:
+ * - in the default ``"sync"`` mode, each line is written to screen as soon as it is produced, i.e., within the
+ *   reverse communication loop of WORHP,
+ * - in the ``"async"`` mode, the loop only queues the data of each line, and a writer thread formats the queued
+ *   lines and writes them to screen in batches. All the lines are written before evolve() returns,
+ * - in the ``"null"`` mode, nothing is written to screen, while the log is still recorded.
+ *
+ * The ``"async"`` and ``"null"`` modes thus keep the screen output latency (e.g., when the standard output is piped
+ * to another process) off the optimisation. The WORHP screen output (see the constructor) is not affected by the
+ * output mode.
+ *
+ * @param mode the screen output mode, one of ``"sync"``, ``"async"`` and ``"null"``.
+ *
+ * @throws std::invalid_argument if \p mode is not one of ``"sync"``, ``"async"`` and ``"null"``.
+ */
+void worhp::set_output_mode(const std::string &mode)
+{
+    m_output_mode = detail::output_mode_from_string(mode);
+}
+/// Get the screen output mode.
+/**
+ * @return the screen output mode, one of ``"sync"``, ``"async"`` and ``"null"`` (see set_output_mode()).
+ */
+std::string worhp::get_output_mode() const
+{
+    return detail::output_mode_to_string(m_output_mode);
+}
 /// Gets the verbosity level
 /**
  * @return the verbosity level
@@ -825,6 +1265,25 @@ std::string worhp::get_extra_info() const
     } else {
         stream(ss, "\n\tScreen output: (worhp)");
     }
+    stream(ss, "\n\tLog mode: ", get_log_mode());
+    stream(ss, "\n\tLog capacity: ", m_log.capacity() ? std::to_string(m_log.capacity()) : "unbounded");
+    stream(ss, "\n\tOutput mode: ", get_output_mode());
+    stream(ss, "\n\tPersistent workspace: ", m_persistent_workspace ? "active" : "inactive");
+    stream(ss, "\n\tEvaluation cache size: ", m_cache_size);
+    stream(ss, "\n\tBatch fitness evaluator: ", m_bfe ? m_bfe->get_name() : "none");
+    stream(ss, "\n\tFinite-difference hessians: ", m_fd_hessians ? "active" : "inactive");
+    stream(ss, "\n\tHessian assembly threads: ", m_hm_threads);
+    stream(ss, "\n\tGradient sparsity detection: ", m_sparsity_detection ? "active" : "inactive");
+    stream(ss, "\n\tWarm start: ", m_warm_start ? "active" : "inactive");
+    stream(ss, "\n\tWarm start database size: ", m_warm_start_db.capacity());
+    const auto first = m_param_source.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        stream(ss, "\n\tParameters source: default (WORHP_PARAM_FILE or param.xml)");
+    } else if (m_param_source[first] == '<') {
+        stream(ss, "\n\tParameters source: xml string");
+    } else {
+        stream(ss, "\n\tParameters source: ", m_param_source);
+    }
     stream(ss, "\n\tIndividual selection ");
     if (boost::any_cast<population::size_type>(&m_select)) {
         stream(ss, "idx: ", std::to_string(boost::any_cast<population::size_type>(m_select)));
@@ -986,11 +1445,357 @@ std::string worhp::get_last_opt_result() const
     return m_last_opt_res;
 }
 
+/// Get the parameter source.
+/**
+ * @return the source of the WORHP parameters, as passed to the constructor.
+ */
+std::string worhp::get_param_source() const
+{
+    return m_param_source;
+}
+
+/// Set the persistent workspace mode.
+/**
+ * By default, each call to evolve() initialises the WORHP data structures (calling WorhpPreInit, ReadParams and
+ * WorhpInit) and releases them at the end (calling WorhpFree), so that all the solver memory is allocated anew and the
+ * parameters are set again. When repeatedly solving problems of the same shape, as when an island keeps polishing
+ * individuals of the same problem, this setup can be avoided. In the persistent workspace mode, the data structures
+ * are instead kept and, if the problem dimensions, the gradient and hessian sparsity patterns, the constraints
+ * tolerances and the options are unchanged, the subsequent calls to evolve() only restart WORHP (calling
+ * WorhpRestart) from the new initial values. Otherwise, the data structures are initialised anew, automatically.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    Copies of this object share the same persistent data structures. If evolve() is called concurrently on two
+ *    copies, one of them will use temporary data structures, as if the persistent workspace mode was not active.
+ *
+ * .. note::
+ *
+ *    The parameters file is read only when the data structures are initialised, so changes made to it will not be
+ *    seen by runs that restart WORHP. Libraries not exporting WorhpRestart are supported, but the data structures
+ *    will then be initialised at each call, as if the persistent workspace mode was not active.
+ *
+ * \endverbatim
+ *
+ * Changing the mode (in either direction) releases the persistent data structures, if any.
+ *
+ * @param flag ``true`` to activate the persistent workspace mode, ``false`` to deactivate it.
+ */
+void worhp::set_persistent_workspace(bool flag)
+{
+    m_persistent_workspace = flag;
+    reset_context();
+}
+// Releases the persistent data structures, if any, and creates a new (empty) context if the persistent workspace mode
+// is active.
+void worhp::reset_context()
+{
+    m_context = m_persistent_workspace ? std::make_shared<detail::worhp_context>() : nullptr;
+}
+/// Get the persistent workspace mode.
+/**
+ * @return ``true`` if the persistent workspace mode is active, ``false`` otherwise
+ * (see set_persistent_workspace()).
+ */
+bool worhp::get_persistent_workspace() const
+{
+    return m_persistent_workspace;
+}
+
+/// Set the size of the evaluation caches.
+/**
+ * During evolve(), WORHP often requests the objective, the constraints and their derivatives at points where they
+ * were already computed (the objective and the constraints are requested separately, a line search may go back to a
+ * previous iterate, and the final point is evaluated once more to be inserted in the population). The fitness,
+ * gradients and hessians computed by the problem are thus stored in least-recently-used caches, each holding up to
+ * \p n points. The points are looked up via a hash and then compared exactly, so that the cached values are
+ * returned only for bitwise identical decision vectors. A size of zero disables the caches.
+ *
+ * The caches are emptied at each call to evolve(), and their efficiency can be inspected via get_cache_stats().
+ *
+ * @param n the number of points stored in each cache (defaults to 16).
+ */
+void worhp::set_cache_size(unsigned n)
+{
+    m_cache_size = n;
+}
+
+/// Get the size of the evaluation caches.
+/**
+ * @return the number of points stored in each of the fitness, gradient and hessians caches (see set_cache_size()).
+ */
+unsigned worhp::get_cache_size() const
+{
+    return m_cache_size;
+}
+
+/// Get the evaluation caches statistics.
+/**
+ * The statistics refer to the last call to evolve() and are stored in a map with the keys ``"fitness_hits"``,
+ * ``"fitness_misses"``, ``"gradient_hits"``, ``"gradient_misses"``, ``"hessians_hits"`` and
+ * ``"hessians_misses"``. The hits count the values returned from the caches, the misses the values
+ * computed by the problem (see set_cache_size()). The map is empty if evolve() was never successfully called.
+ *
+ * @return the hits and misses counters of the evaluation caches.
+ */
+std::map<std::string, unsigned long long> worhp::get_cache_stats() const
+{
+    return m_cache_stats;
+}
+
+/// Set the batch fitness evaluator.
+/**
+ * When the problem does not provide the gradient, WORHP estimates it by finite differences, requesting one
+ * perturbed evaluation at a time. After a batch fitness evaluator has been set, the gradient is instead estimated by
+ * the plugin with forward differences: the columns of the gradient sparsity pattern are grouped via a
+ * Curtis-Powell-Reid coloring, so that all the columns in a group can be estimated from a single perturbed point,
+ * and the perturbed points of all the groups are evaluated in a single batch via \p b (thus, for instance, in
+ * parallel when using a pagmo::thread_bfe). The gradient is then passed to WORHP as if it was provided by the
+ * problem (i.e., UserDF and UserDG are set to ``true``). Problems providing the gradient are not affected.
+ *
+ * @param b the batch fitness evaluator that will be used to evaluate the perturbed points.
+ */
+void worhp::set_bfe(const pagmo::bfe &b)
+{
+    m_bfe = b;
+}
+
+/// Set the finite-difference hessians mode.
+/**
+ * When the problem provides the gradient but not the hessians, WORHP approximates the hessian of the Lagrangian
+ * via quasi-Newton (BFGS) updates or via its own finite differences, evaluating one perturbed point at a time.
+ * In the finite-difference hessians mode, the hessians are instead computed by the plugin, differencing the
+ * gradient along the directions given by a Curtis-Powell-Reid coloring of the hessians sparsity patterns, so that
+ * each hessian costs as many gradient evaluations as the number of colors. The perturbed gradients are evaluated
+ * concurrently, using as many threads as the hardware supports, and the hessians are then passed to WORHP as if they
+ * were provided by the problem (i.e., UserHM is set to ``true``), retaining second-order convergence.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    Problems whose thread safety is ``basic`` are copied once per thread (at the start of evolve()), and the
+ *    gradient evaluations made by the copies are not counted by the problem in the population, which thus
+ *    under-reports the cost of the finite differences. Their number is printed at the end of evolve() when the
+ *    verbosity is nonzero. Problems whose thread safety is ``none`` are evaluated serially.
+ *
+ * \endverbatim
+ *
+ * Problems providing the hessians, or not providing the gradient, are not affected.
+ *
+ * @param flag ``true`` to activate the finite-difference hessians mode, ``false`` to deactivate it.
+ */
+void worhp::set_fd_hessians(bool flag)
+{
+    m_fd_hessians = flag;
+}
+
+/// Get the finite-difference hessians mode.
+/**
+ * @return ``true`` if the finite-difference hessians mode is active, ``false`` otherwise
+ * (see set_fd_hessians()).
+ */
+bool worhp::get_fd_hessians() const
+{
+    return m_fd_hessians;
+}
+
+/// Set the number of threads assembling the hessian of the lagrangian.
+/**
+ * At each request of WORHP, the hessian of the lagrangian is assembled summing the hessians of the objective and
+ * of the constraints, weighted by the corresponding multipliers. By default, this is done sequentially. With
+ * \p n threads, the nonzeros of the hessian of the lagrangian are instead partitioned among the threads in
+ * chunks having about the same number of contributions, and each thread computes its own chunk. Each nonzero is
+ * summed by a single thread in the same order as in the sequential assembly, so that the result is bitwise
+ * identical regardless of the number of threads.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The threads are started once per call to evolve() and reused at each request of the hessian. Still, their
+ *    synchronisation has a cost, so the parallel assembly pays off only for problems whose hessians have a large
+ *    number of nonzeros (e.g., many constraints).
+ *
+ * \endverbatim
+ *
+ * @param n the number of threads: 1 (the default) for the sequential assembly, 0 to use as many threads as the
+ * hardware supports.
+ */
+void worhp::set_hm_threads(unsigned n)
+{
+    m_hm_threads = n;
+}
+
+/// Get the number of threads assembling the hessian of the lagrangian.
+/**
+ * @return the number of threads assembling the hessian of the lagrangian (see set_hm_threads()).
+ */
+unsigned worhp::get_hm_threads() const
+{
+    return m_hm_threads;
+}
+
+/// Set the gradient sparsity detection mode.
+/**
+ * When the problem does not provide the gradient sparsity, a dense one is assumed, and WORHP gets fully dense DF and
+ * DG matrices. In the gradient sparsity detection mode, the plugin instead infers the pattern probing the problem at a
+ * few random points around the initial guess, in neighbourhoods of increasing radius up to the magnitude of the
+ * variables (looking at the nonzeros of the gradient, if provided by the problem, or
+ * else at the fitness components changed by perturbing each variable), and validates it at a further random point,
+ * falling back to the dense pattern if the validation fails. The perturbed points are evaluated via the batch fitness
+ * evaluator, if set (see set_bfe()), or via the default pagmo::bfe otherwise.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The detected pattern is cached (per problem name, dimensions and bounds), so that the detection, which costs
+ *    four gradient evaluations or four times the problem dimension (plus one) fitness evaluations, runs only once
+ *    per problem. As the cache key does not identify the problem uniquely, a cached pattern is validated: if the
+ *    problem provides the gradient, at no extra cost, during the run (see below); otherwise, perturbing a few
+ *    variables (at most eight, cycling through all of them across the calls) at a further random point, which costs
+ *    at most nine fitness evaluations. A pattern failing the validation is detected again.
+ *
+ * .. warning::
+ *
+ *    Dependencies that do not manifest themselves at the probe points cannot be detected. If the problem provides
+ *    the gradient, the elements outside the detected pattern are verified to be zero at each gradient evaluation:
+ *    otherwise, the optimisation is stopped and started again with the dense pattern, which is then cached for the
+ *    problem. If it does not, the missed dependencies are silently ignored: problems whose sparsity changes across
+ *    the search space should provide it explicitly.
+ *
+ * \endverbatim
+ *
+ * Problems providing the gradient sparsity are not affected.
+ *
+ * @param flag ``true`` to activate the gradient sparsity detection mode, ``false`` to deactivate it.
+ */
+void worhp::set_sparsity_detection(bool flag)
+{
+    m_sparsity_detection = flag;
+}
+
+/// Get the gradient sparsity detection mode.
+/**
+ * @return ``true`` if the gradient sparsity detection mode is active, ``false`` otherwise
+ * (see set_sparsity_detection()).
+ */
+bool worhp::get_sparsity_detection() const
+{
+    return m_sparsity_detection;
+}
+
+/// Set the warm start mode.
+/**
+ * At the end of each call to evolve() terminating without errors, the final decision vector and the final multipliers
+ * of the box constraints and of the constraints are stored in this object (see get_warm_start_data()). In the warm
+ * start mode, a subsequent call to evolve() on a problem with the same name and dimensions uses the stored multipliers
+ * as the initial ones, instead of zeros (and the initial Lagrange multipliers estimate of WORHP, i.e. the
+ * "InitialLMest" parameter, is disabled). The initial decision vector is still the one selected from the population.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The warm start is most effective when the same object optimises neighbouring decision vectors of the same problem
+ *    over and over. Since the warm start data is serialized, it also survives the migration of the algorithm (e.g.,
+ *    between the islands of an archipelago).
+ *
+ * \endverbatim
+ *
+ * @param flag ``true`` to activate the warm start mode, ``false`` to deactivate it.
+ */
+void worhp::set_warm_start(bool flag)
+{
+    m_warm_start = flag;
+}
+
+/// Get the warm start mode.
+/**
+ * @return ``true`` if the warm start mode is active, ``false`` otherwise (see set_warm_start()).
+ */
+bool worhp::get_warm_start() const
+{
+    return m_warm_start;
+}
+
+/// Set the warm start data.
+/**
+ * Sets the data from which the next call to evolve() will be warm started, if the warm start mode is active (see
+ * set_warm_start()).
+ *
+ * @param data the warm start data (see worhp::warm_start_data_type).
+ *
+ * @throws std::invalid_argument if the sizes of the decision vector and of the multipliers of the box constraints
+ * differ.
+ */
+void worhp::set_warm_start_data(const warm_start_data_type &data)
+{
+    if (std::get<1>(data).size() != std::get<2>(data).size()) {
+        pagmo_throw(std::invalid_argument, "The warm start data is inconsistent: the decision vector has size "
+                                               + std::to_string(std::get<1>(data).size())
+                                               + ", while the multipliers of the box constraints have size "
+                                               + std::to_string(std::get<2>(data).size()));
+    }
+    m_warm_start_data = data;
+}
+
+/// Set the size of the warm start database.
+/**
+ * In the warm start mode (see set_warm_start()), only the final multipliers of the last optimisation are reused by
+ * default. With a nonzero size, the final primal-dual solutions of the last \p n optimisations are instead stored in a
+ * database, and each call to evolve() is warm started from the multipliers stored at the decision vector nearest to
+ * the initial one, among those of the same problem (i.e., with the same name and dimensions). Each variable is scaled
+ * by the width of its bounds, if finite, in the distance computation. The last primal-dual solution is used only if
+ * the database holds none for the problem.
+ *
+ * \verbatim embed:rst:leading-asterisk
+ *
+ * .. note::
+ *
+ *    The database is most effective in multi-start optimisations over clustered basins of attraction, where the
+ *    nearest stored solution was likely found in the same basin. Its lookups scan the solutions stored for the problem,
+ *    and are thus meant for small sizes. When full, the oldest solutions are evicted.
+ *
+ * \endverbatim
+ *
+ * @param n the maximum number of solutions stored (zero to disable the database, which is then emptied).
+ */
+void worhp::set_warm_start_db_size(unsigned n)
+{
+    m_warm_start_db.set_capacity(n);
+}
+
+/// Get the size of the warm start database.
+/**
+ * @return the maximum number of solutions stored in the warm start database (see set_warm_start_db_size()).
+ */
+unsigned worhp::get_warm_start_db_size() const
+{
+    return static_cast<unsigned>(m_warm_start_db.capacity());
+}
+
+/// Get the warm start data.
+/**
+ * See worhp::warm_start_data_type. Before the first call to evolve() (or to set_warm_start_data()), the problem name
+ * is empty, and so are the decision vector and the multipliers.
+ *
+ * @return a const reference to the warm start data.
+ */
+const worhp::warm_start_data_type &worhp::get_warm_start_data() const
+{
+    return m_warm_start_data;
+}
+
 // Log update and print to screen
-void worhp::update_log(const problem &prob, const vector_double &fit, long long unsigned fevals0) const
+void worhp::update_log(const problem &prob, const vector_double &fit, long long unsigned fevals0,
+                       detail::output_sink &sink) const
 {
     unsigned fevals = static_cast<unsigned>(prob.get_fevals() - fevals0);
-    if (m_verbosity && !(fevals % m_verbosity)) {
+    if (m_verbosity && !m_log_majors && !(fevals % m_verbosity)) {
         // Constraints bits.
         const auto ctol = prob.get_c_tol();
         const auto c1eq
@@ -1006,126 +1811,113 @@ void worhp::update_log(const problem &prob, const vector_double &fit, long long
 
         if (!(fevals / m_verbosity % 50u)) {
             // Every 50 lines print the column names.
-            print("\n", std::setw(10), "objevals:", std::setw(15), "objval:", std::setw(15), "violated:", std::setw(15),
-                  "viol. norm:", '\n');
+            sink.print("\n", std::setw(10), "objevals:", std::setw(15), "objval:", std::setw(15), "violated:",
+                       std::setw(15), "viol. norm:", '\n');
         }
         // Print to screen the log line.
-        print(std::setw(10), fevals, std::setw(15), fit[0], std::setw(15), nv, std::setw(15), l, feas ? "" : " i",
-              '\n');
+        sink.print(std::setw(10), fevals, std::setw(15), fit[0], std::setw(15), nv, std::setw(15), l,
+                   feas ? "" : " i", '\n');
         // Record the log.
-        m_log.emplace_back(fevals, fit[0], nv, l, feas);
+        m_log.push_back(fevals, fit[0], nv, l, feas);
     }
 }
 
+// Major iterations log update and print to screen
+void worhp::update_major_log(const OptVar &opt, const Workspace &wsp, detail::output_sink &sink) const
+{
+    const auto iter = static_cast<unsigned>(wsp.MajorIter);
+    if (iter % m_verbosity) {
+        return;
+    }
+    // NOTE: opt.F is the objective scaled by WORHP (see UserF()).
+    const double f = wsp.ScaleObj != 0. ? opt.F / wsp.ScaleObj : opt.F;
+    if (iter && !(iter / m_verbosity % 50u)) {
+        // Every 50 lines print the column names.
+        sink.print("\n", std::setw(10), "major:", std::setw(15), "objval:", std::setw(15), "viol. norm:",
+                   std::setw(15), "optimality:", std::setw(15), "step:", '\n');
+    }
+    // Print to screen the log line.
+    sink.print(std::setw(10), iter, std::setw(15), f, std::setw(15), wsp.NormMax_CV, std::setw(15), wsp.OptiMax,
+               std::setw(15), wsp.ArmijoAlpha, wsp.Feasible ? "" : " i", '\n');
+    // Record the log.
+    m_major_log.emplace_back(wsp.MajorIter, f, wsp.NormMax_CV, wsp.OptiMax, wsp.ArmijoAlpha, wsp.Feasible);
+}
+
 // Objective function
 void worhp::UserF(OptVar *opt, Workspace *wsp, Params *, Control *, const population &pop,
-                  long long unsigned fevals0) const
+                  long long unsigned fevals0, detail::evaluation_cache &cache, detail::output_sink &sink) const
 {
     double *X = opt->X; // Abbreviate notation
     const auto &prob = pop.get_problem();
     auto dim = prob.get_nx();
     vector_double x(X, X + dim);
-    auto fit = fitness_with_cache(x, prob);
-    update_log(prob, fit, fevals0);
+    const auto &fit = cache.m_f.get(x, [&prob](const vector_double &y) { return prob.fitness(y); });
+    update_log(prob, fit, fevals0, sink);
     opt->F = wsp->ScaleObj * fit[0];
 }
 // Constraints
-void worhp::UserG(OptVar *opt, Workspace *, Params *, Control *, const population &pop) const
+void worhp::UserG(OptVar *opt, Workspace *, Params *, Control *, const population &pop,
+                  detail::evaluation_cache &cache) const
 {
     double *X = opt->X; // Abbreviate notation
     const auto &prob = pop.get_problem();
     auto dim = prob.get_nx();
     vector_double x(X, X + dim);
-    auto fit = fitness_with_cache(x, prob);
+    const auto &fit = cache.m_f.get(x, [&prob](const vector_double &y) { return prob.fitness(y); });
     for (decltype(prob.get_nc()) i = 0; i < prob.get_nc(); ++i) {
         opt->G[i] = fit[i + 1];
     }
 }
 // Gradient for the objective function
-void worhp::UserDF(OptVar *opt, Workspace *wsp, Params *, Control *, const population &pop) const
+void worhp::UserDF(OptVar *opt, Workspace *wsp, Params *, Control *, const population &pop,
+                   const std::vector<vector_double::size_type> &df_idx_map, detail::evaluation_cache &cache,
+                   const detail::fd_gradient *fd_grad) const
 {
     const auto &prob = pop.get_problem();
     auto dim = prob.get_nx();
     vector_double x(opt->X, opt->X + dim);
-    auto g = gradient_with_cache(x, prob);
+    const auto &g = detail::cached_gradient(cache, prob, x, fd_grad);
     for (vector_double::size_type i = 0u; i < static_cast<vector_double::size_type>(wsp->DF.nnz); ++i) {
-        wsp->DF.val[i] = g[i];
+        wsp->DF.val[i] = g[df_idx_map[i]];
     }
 }
 
 // Gradient for the constraints
 void worhp::UserDG(OptVar *opt, Workspace *wsp, Params *, Control *, const population &pop,
-                   const std::vector<vector_double::size_type> &gs_idx_map) const
+                   const std::vector<vector_double::size_type> &dg_idx_map, detail::evaluation_cache &cache,
+                   const detail::fd_gradient *fd_grad) const
 {
     const auto &prob = pop.get_problem();
     auto dim = prob.get_nx();
     vector_double x(opt->X, opt->X + dim);
-    auto g = gradient_with_cache(x, prob);
+    const auto &g = detail::cached_gradient(cache, prob, x, fd_grad);
     for (vector_double::size_type i = 0u; i < static_cast<vector_double::size_type>(wsp->DG.nnz); ++i) {
-        wsp->DG.val[i] = g[static_cast<vector_double::size_type>(wsp->DF.nnz) + gs_idx_map[i]];
+        wsp->DG.val[i] = g[dg_idx_map[i]];
     }
 }
 
 // The Hessian of the Lagrangian L = f + mu * g
 void worhp::UserHM(OptVar *opt, Workspace *wsp, Params *, Control *, const population &pop,
-                   const std::vector<sparsity_pattern> &pagmo_hsp, const sparsity_pattern &pagmo_merged_hsp,
-                   const std::vector<vector_double::size_type> &hs_idx_map) const
+                   const std::vector<vector_double::size_type> &hm_plan, const detail::hm_gather *hm_gather,
+                   detail::evaluation_cache &cache, const detail::fd_hessians *fd_hess) const
 {
     const auto &prob = pop.get_problem();
     auto dim = prob.get_nx();
     vector_double x(opt->X, opt->X + dim);
-    auto pagmo_h = prob.hessians(x);
-    // Compute the hessian of the lagrangian. Logic: first we assemble the Hessian of the Lagrangian
-    // as represented by an unordered map (i,j) - > valij. We do so looping on the pagmo hessians
-    // and inserting the various contributions where they belong. Later we transform this representation
-    // into the worhp representation.
-    std::unordered_map<std::pair<vector_double::size_type, vector_double::size_type>, double, pair_hash> pagmo_merged_h;
-    // First we deal with the objective
-    for (decltype(pagmo_hsp[0].size()) j = 0u; j < pagmo_hsp[0].size(); ++j) {
-        // These will all be insertions in the map as all keys will not be there.
-        pagmo_merged_h[pagmo_hsp[0][j]] = pagmo_h[0][j] * wsp->ScaleObj;
-    }
-    // Then with the constraints
-    for (decltype(pagmo_hsp.size()) i = 1u; i < pagmo_hsp.size(); ++i) {
-        for (decltype(pagmo_hsp[i].size()) j = 0u; j < pagmo_hsp[i].size(); ++j) {
-            // If the key is there, great! Otherwise a 0 will be created and pagmo_h[i][j] * opt->Mu[i-1] summed
-            // over.
-            pagmo_merged_h[pagmo_hsp[i][j]] = pagmo_merged_h[pagmo_hsp[i][j]] + pagmo_h[i][j] * opt->Mu[i - 1];
+    const auto &pagmo_h = cache.m_h.get(x, [&](const vector_double &y) {
+        if (fd_hess) {
+            // The hessians are computed by the plugin, differencing the gradient at y.
+            return (*fd_hess)(prob, y, detail::cached_gradient(cache, prob, y, nullptr));
         }
-    }
-    // At this point the hessian of the lagrangian is assembled in pagmo_merged_h
-    // but we still need to translate it into the WORHP format.
-    // lower triangular
-    for (decltype(hs_idx_map.size()) i = 0u; i < hs_idx_map.size(); ++i) {
-        wsp->HM.val[i] = pagmo_merged_h[pagmo_merged_hsp[hs_idx_map[i]]];
-    }
-    // diagonal
-    for (decltype(dim) i = 0u; i < dim; ++i) {
-        wsp->HM.val[hs_idx_map.size() + i] = pagmo_merged_h[{i, i}];
-    }
-}
-
-// We cache the last call to fitness as it will be repeated by worhp
-vector_double worhp::fitness_with_cache(const vector_double &x, const problem &prob) const
-{
-    if (x == m_f_cache.first) {
-        return m_f_cache.second;
-    } else {
-        vector_double fit = prob.fitness(x);
-        m_f_cache = std::pair<vector_double, vector_double>{x, fit};
-        return fit;
-    }
-}
-
-// We cache the last call to gradient as it will be repeated by worhp
-vector_double worhp::gradient_with_cache(const vector_double &x, const problem &prob) const
-{
-    if (x == m_g_cache.first) {
-        return m_g_cache.second;
+        return prob.hessians(y);
+    });
+    // The hessian of the lagrangian is computed directly in the WORHP representation, the objective weighted by
+    // ScaleObj and the constraints by their multipliers.
+    if (hm_gather) {
+        (*hm_gather)(pagmo_h, wsp->ScaleObj, opt->Mu, wsp->HM.val);
     } else {
-        vector_double grad = prob.gradient(x);
-        m_g_cache = std::pair<vector_double, vector_double>{x, grad};
-        return grad;
+        detail::hm_scatter(hm_plan, pagmo_h, wsp->ScaleObj, opt->Mu, wsp->HM.val,
+                           static_cast<vector_double::size_type>(wsp->HM.nnz));
     }
 }
 
@@ -0,0 +1,151 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#define BOOST_TEST_MODULE columnar_log_test
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <cstddef>
+#include <pagmo/s11n.hpp>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#include <pagmo_plugins_nonfree/detail/columnar_log.hpp>
+
+using log_type = ppnf::detail::columnar_log<unsigned long, double, bool>;
+
+BOOST_AUTO_TEST_CASE(unbounded)
+{
+    log_type log;
+    BOOST_CHECK_EQUAL(log.capacity(), 0u);
+    BOOST_CHECK(log.empty());
+    for (auto i = 0ul; i < 1000ul; ++i) {
+        log.push_back(i, 0.5 * static_cast<double>(i), i % 2ul == 0ul);
+    }
+    BOOST_CHECK_EQUAL(log.size(), 1000u);
+    BOOST_CHECK_EQUAL(log.stride(), 1u);
+    BOOST_CHECK(log[3] == std::make_tuple(3ul, 1.5, false));
+    BOOST_CHECK_EQUAL(log.column<0>()[999], 999ul);
+    BOOST_CHECK_EQUAL(log.column<2>()[998], 1u);
+    const auto lines = log.lines();
+    BOOST_CHECK_EQUAL(lines.size(), 1000u);
+    BOOST_CHECK(lines[10] == std::make_tuple(10ul, 5., true));
+    log.clear();
+    BOOST_CHECK(log.empty());
+}
+
+BOOST_AUTO_TEST_CASE(bounded)
+{
+    log_type log(8u);
+    BOOST_CHECK_EQUAL(log.capacity(), 8u);
+    // The columns are preallocated.
+    const auto *data = log.column<0>().data();
+    for (auto n = 1ul; n <= 1000ul; ++n) {
+        log.push_back(n - 1ul, 0., true);
+        BOOST_CHECK(log.size() <= 8u);
+        BOOST_CHECK(log.column<0>().data() == data);
+        // The lines kept are those offered at multiples of the stride, in chronological order.
+        for (std::size_t i = 0u; i < log.size(); ++i) {
+            BOOST_CHECK_EQUAL(log.column<0>()[i], i * log.stride());
+        }
+        BOOST_CHECK((n - 1ul) / log.stride() + 1ul == log.size());
+    }
+    BOOST_CHECK_EQUAL(log.stride(), 128u);
+    // Reducing the capacity downsamples the lines recorded.
+    log.set_capacity(3u);
+    BOOST_CHECK(log.size() <= 3u);
+    BOOST_CHECK_EQUAL(log.column<0>()[1], log.stride());
+    // Clearing resets the stride.
+    log.clear();
+    BOOST_CHECK(log.empty());
+    BOOST_CHECK_EQUAL(log.stride(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(shared_storage)
+{
+    log_type log(4u);
+    log.push_back(0ul, 1., true);
+    // The storage handed out is not modified anymore.
+    const auto storage = log.storage();
+    const auto &col = log.column<1>();
+    const auto *data = col.data();
+    log.push_back(1ul, 2., false);
+    BOOST_CHECK(log.column<1>().data() != data);
+    BOOST_CHECK_EQUAL(data[0], 1.);
+    BOOST_CHECK_EQUAL(log.size(), 2u);
+    // Copies share the storage until modified.
+    auto log2 = log;
+    BOOST_CHECK(log2.column<1>().data() == log.column<1>().data());
+    log2.push_back(2ul, 3., true);
+    BOOST_CHECK_EQUAL(log.size(), 2u);
+    BOOST_CHECK_EQUAL(log2.size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+    log_type log(4u);
+    for (auto i = 0ul; i < 10ul; ++i) {
+        log.push_back(i, static_cast<double>(i), i % 3ul == 0ul);
+    }
+    std::stringstream ss;
+    {
+        boost::archive::binary_oarchive oarchive(ss);
+        oarchive << log;
+    }
+    log_type log2;
+    {
+        boost::archive::binary_iarchive iarchive(ss);
+        iarchive >> log2;
+    }
+    BOOST_CHECK_EQUAL(log2.capacity(), 4u);
+    BOOST_CHECK_EQUAL(log2.stride(), log.stride());
+    BOOST_CHECK(log2.lines() == log.lines());
+    // The downsampling continues where it was left.
+    log.push_back(10ul, 10., false);
+    log2.push_back(10ul, 10., false);
+    BOOST_CHECK(log2.lines() == log.lines());
+}
@@ -0,0 +1,314 @@
+#define BOOST_TEST_MODULE fd_gradient_test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+#include <pagmo/bfe.hpp>
+#include <pagmo/problem.hpp>
+#include <pagmo/problems/rosenbrock.hpp>
+#include <pagmo/types.hpp>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <pagmo_plugins_nonfree/detail/fd_gradient.hpp>
+#include <pagmo_plugins_nonfree/detail/sparsity_detection.hpp>
+
+using namespace pagmo;
+using namespace ppnf;
+
+// A problem with a sparse gradient.
+struct sparse_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        return {x[0] * x[0] + m_slope * x[1], x[2] * x[3], std::sin(x[0]) + x[2] * x[2]};
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 2;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1, -1, -1, -1}, {1, 1, 1, 1}};
+    }
+    sparsity_pattern gradient_sparsity() const
+    {
+        return {{0, 0}, {0, 1}, {1, 2}, {1, 3}, {2, 0}, {2, 2}};
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        return {2 * x[0], m_slope, x[3], x[2], std::cos(x[0]), 2 * x[2]};
+    }
+    std::vector<sparsity_pattern> hessians_sparsity() const
+    {
+        return {{{0, 0}}, {{3, 2}}, {{0, 0}, {2, 2}}};
+    }
+    std::vector<vector_double> hessians(const vector_double &x) const
+    {
+        return {{2.}, {1.}, {-std::sin(x[0]), 2.}};
+    }
+    double m_slope = 1.;
+};
+
+// Checks that no two columns of the same color share a row.
+void check_coloring(const sparsity_pattern &sp, const std::vector<vector_double::size_type> &colors)
+{
+    std::set<std::pair<vector_double::size_type, vector_double::size_type>> row_colors;
+    for (const auto &p : sp) {
+        BOOST_CHECK(row_colors.emplace(p.first, colors[p.second]).second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(coloring)
+{
+    // Dense: one color per column.
+    problem dense{rosenbrock{5}};
+    auto colors = ppnf::detail::cpr_coloring(dense.gradient_sparsity(), 5u);
+    BOOST_CHECK((colors == std::vector<vector_double::size_type>{0, 1, 2, 3, 4}));
+    // Sparse.
+    auto sp = sparse_udp{}.gradient_sparsity();
+    colors = ppnf::detail::cpr_coloring(sp, 4u);
+    check_coloring(sp, colors);
+    BOOST_CHECK((colors == std::vector<vector_double::size_type>{0, 1, 1, 0}));
+    // Diagonal.
+    colors = ppnf::detail::cpr_coloring({{0, 0}, {1, 1}, {2, 2}}, 3u);
+    BOOST_CHECK((colors == std::vector<vector_double::size_type>{0, 0, 0}));
+    // A pattern for which the greedy coloring in the natural order needs three colors, while two are enough.
+    sp = {{0, 3}, {0, 5}, {1, 5}, {2, 3}, {3, 0}, {3, 3}, {4, 4}, {4, 5}};
+    colors = ppnf::detail::cpr_coloring(sp, 6u);
+    check_coloring(sp, colors);
+    BOOST_CHECK_EQUAL(*std::max_element(colors.begin(), colors.end()), 1u);
+    // A column not appearing in the pattern.
+    colors = ppnf::detail::cpr_coloring({{0, 0}, {0, 2}}, 3u);
+    check_coloring({{0, 0}, {0, 2}}, colors);
+    BOOST_CHECK_EQUAL(colors.size(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(coloring_cache)
+{
+    const auto sp = sparse_udp{}.gradient_sparsity();
+    const auto c0 = ppnf::detail::cached_cpr_coloring(sp, 4u);
+    BOOST_CHECK(*c0 == ppnf::detail::cpr_coloring(sp, 4u));
+    // The same structure gets the same coloring, without computing it again.
+    BOOST_CHECK(ppnf::detail::cached_cpr_coloring(sp, 4u) == c0);
+    BOOST_CHECK(ppnf::detail::cached_cpr_coloring(sp, 5u) != c0);
+    // The cache is bounded, but the most recently used colorings are kept.
+    for (vector_double::size_type n = 1u; n < 40u; ++n) {
+        ppnf::detail::cached_cpr_coloring({{0, 0}}, n);
+        BOOST_CHECK(ppnf::detail::cached_cpr_coloring(sp, 4u) == c0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gradient)
+{
+    problem p{sparse_udp{}};
+    ppnf::detail::fd_gradient fd{p, p.gradient_sparsity(), bfe{}};
+    BOOST_CHECK_EQUAL(fd.get_ncolors(), 2u);
+    for (const auto &x : std::vector<vector_double>{{0.1, -0.2, 0.3, 0.4}, {1., 1., 1., 1.}, {-1., -1., -1., -1.}}) {
+        const auto fevals = p.get_fevals();
+        const auto g = fd(p, x, p.fitness(x));
+        // One evaluation for the fitness at x, and one per color.
+        BOOST_CHECK_EQUAL(p.get_fevals() - fevals, 3u);
+        BOOST_CHECK_EQUAL(p.get_gevals(), 0u);
+        const auto g_ex = sparse_udp{}.gradient(x);
+        BOOST_REQUIRE_EQUAL(g.size(), g_ex.size());
+        for (decltype(g.size()) i = 0u; i < g.size(); ++i) {
+            BOOST_CHECK(std::abs(g[i] - g_ex[i]) < 1e-6);
+        }
+    }
+    // Dense.
+    problem p2{rosenbrock{10}};
+    ppnf::detail::fd_gradient fd2{p2, p2.gradient_sparsity(), bfe{}};
+    BOOST_CHECK_EQUAL(fd2.get_ncolors(), 10u);
+    vector_double x(10, 0.5);
+    const auto g = fd2(p2, x, p2.fitness(x));
+    const auto g_ex = p2.gradient(x);
+    for (decltype(g.size()) i = 0u; i < g.size(); ++i) {
+        BOOST_CHECK(std::abs(g[i] - g_ex[i]) < 1e-5 * std::max(1., std::abs(g_ex[i])));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(hessians)
+{
+    problem p{sparse_udp{}};
+    // The symmetrised union of the hessians patterns is diagonal but for the (2, 3) block.
+    ppnf::detail::fd_hessians fd{p};
+    BOOST_CHECK_EQUAL(fd.get_ncolors(), 2u);
+    for (const auto &x : std::vector<vector_double>{{0.1, -0.2, 0.3, 0.4}, {1., 1., 1., 1.}, {-1., -1., -1., -1.}}) {
+        const auto h = fd(p, x, p.gradient(x));
+        const auto h_ex = p.hessians(x);
+        BOOST_REQUIRE_EQUAL(h.size(), h_ex.size());
+        for (decltype(h.size()) f = 0u; f < h.size(); ++f) {
+            BOOST_REQUIRE_EQUAL(h[f].size(), h_ex[f].size());
+            for (decltype(h[f].size()) i = 0u; i < h[f].size(); ++i) {
+                BOOST_CHECK(std::abs(h[f][i] - h_ex[f][i]) < 1e-6);
+            }
+        }
+        // The result does not depend on the number of threads.
+        BOOST_CHECK((ppnf::detail::fd_hessians{p, 1u}(p, x, p.gradient(x)) == h));
+        BOOST_CHECK((ppnf::detail::fd_hessians{p, 7u}(p, x, p.gradient(x)) == h));
+    }
+    // With two threads, the second color is evaluated by the copy of the problem made at construction, whose
+    // gradient evaluations are counted separately.
+    const ppnf::detail::fd_hessians fd3{p, 2u};
+    const auto gevals = p.get_gevals();
+    fd3(p, {0.1, -0.2, 0.3, 0.4}, p.gradient({0.1, -0.2, 0.3, 0.4}));
+    BOOST_CHECK_EQUAL(p.get_gevals() - gevals, 2u);
+    BOOST_CHECK_EQUAL(fd3.get_copies_gevals(), 1u);
+    // Dense hessians.
+    problem p2{rosenbrock{6}};
+    ppnf::detail::fd_hessians fd2{p2};
+    BOOST_CHECK_EQUAL(fd2.get_ncolors(), 6u);
+    vector_double x(6, 0.5);
+    const auto h = fd2(p2, x, p2.gradient(x));
+    BOOST_REQUIRE_EQUAL(h.size(), 1u);
+    const auto hs = p2.hessians_sparsity()[0];
+    for (decltype(hs.size()) k = 0u; k < hs.size(); ++k) {
+        const auto i = hs[k].first, j = hs[k].second;
+        // The rosenbrock hessian at x = 0.5: 1200 x_i^2 - 400 x_{i+1} + 2 (+ 200 if i > 0) on the diagonal,
+        // -400 x_j on the first subdiagonal, zero elsewhere.
+        double h_ex = 0.;
+        if (i == j) {
+            h_ex = (i < 5u ? 1200. * 0.25 - 400. * 0.5 + 2. : 0.) + (i > 0u ? 200. : 0.);
+        } else if (i == j + 1u) {
+            h_ex = -400. * 0.5;
+        }
+        BOOST_CHECK(std::abs(h[0][k] - h_ex) < 1e-4 * std::max(1., std::abs(h_ex)));
+    }
+}
+
+// The same problem as sparse_udp (possibly with different bounds and with the first fitness component depending also
+// on the last variable), not providing the gradient sparsity (and, optionally, providing the gradient in the dense
+// layout).
+struct undeclared_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        auto retval = sparse_udp{}.fitness(x);
+        if (m_coupled) {
+            retval[0] += x[3];
+        }
+        return retval;
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 2;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return m_bounds;
+    }
+    std::pair<vector_double, vector_double> m_bounds = sparse_udp{}.get_bounds();
+    bool m_coupled = false;
+};
+struct undeclared_gradient_udp : undeclared_udp {
+    vector_double gradient(const vector_double &x) const
+    {
+        vector_double retval(12, 0.);
+        const auto sp = sparse_udp{}.gradient_sparsity();
+        const auto g = sparse_udp{}.gradient(x);
+        for (decltype(sp.size()) k = 0u; k < sp.size(); ++k) {
+            retval[sp[k].first * 4u + sp[k].second] = g[k];
+        }
+        return retval;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(sparsity_detection)
+{
+    const vector_double x0{0.1, -0.2, 0.3, 0.4};
+    // Probing the fitness: three probe points and a validation one, each costing one evaluation plus one per
+    // variable.
+    problem p{undeclared_udp{}};
+    BOOST_CHECK(ppnf::detail::detect_gradient_sparsity(p, x0, bfe{}) == sparse_udp{}.gradient_sparsity());
+    BOOST_CHECK_EQUAL(p.get_fevals(), 20u);
+    // Probing the gradient.
+    problem p2{undeclared_gradient_udp{}};
+    BOOST_CHECK(ppnf::detail::detect_gradient_sparsity(p2, x0, bfe{}) == sparse_udp{}.gradient_sparsity());
+    BOOST_CHECK_EQUAL(p2.get_fevals(), 0u);
+    BOOST_CHECK_EQUAL(p2.get_gevals(), 4u);
+    BOOST_CHECK((ppnf::detail::dense_gradient_positions(sparse_udp{}.gradient_sparsity(), 4u)
+                 == std::vector<vector_double::size_type>{0, 1, 6, 7, 8, 10}));
+    // A fixed variable cannot be perturbed, and is assumed to affect all the fitness components.
+    undeclared_udp fixed;
+    fixed.m_bounds = {{-1, -1, 0.5, -1}, {1, 1, 0.5, 1}};
+    const auto sp = ppnf::detail::detect_gradient_sparsity(problem{fixed}, {0.1, -0.2, 0.5, 0.4}, bfe{});
+    BOOST_CHECK((sp == sparsity_pattern{{0, 0}, {0, 1}, {0, 2}, {1, 2}, {1, 3}, {2, 0}, {2, 2}}));
+    // Caching: a cached pattern costs only a validation probe (perturbing at most 8 variables, here all of them).
+    problem p3{undeclared_udp{}};
+    const auto sp0 = ppnf::detail::cached_gradient_sparsity(p3, x0, bfe{});
+    BOOST_CHECK_EQUAL(p3.get_fevals(), 20u);
+    BOOST_CHECK(*sp0 == sparse_udp{}.gradient_sparsity());
+    BOOST_CHECK(ppnf::detail::cached_gradient_sparsity(p3, x0, bfe{}) == sp0);
+    BOOST_CHECK_EQUAL(p3.get_fevals(), 25u);
+    // Different bounds make a different problem.
+    undeclared_udp wider;
+    wider.m_bounds = {{-2, -2, -2, -2}, {2, 2, 2, 2}};
+    BOOST_CHECK(ppnf::detail::cached_gradient_sparsity(problem{wider}, x0, bfe{}) != sp0);
+    // A problem of the same type and with the same bounds, but with a different sparsity, does not re-use the
+    // cached pattern.
+    undeclared_udp coupled;
+    coupled.m_coupled = true;
+    const auto sp1 = ppnf::detail::cached_gradient_sparsity(problem{coupled}, x0, bfe{});
+    BOOST_CHECK((*sp1 == sparsity_pattern{{0, 0}, {0, 1}, {0, 3}, {1, 2}, {1, 3}, {2, 0}, {2, 2}}));
+    BOOST_CHECK(ppnf::detail::cached_gradient_sparsity(problem{coupled}, x0, bfe{}) == sp1);
+    // A superset of the sparsity is still valid (if conservative), and is re-used.
+    BOOST_CHECK(ppnf::detail::cached_gradient_sparsity(p3, x0, bfe{}) == sp1);
+    // The elements outside a detected pattern, which the solvers verify to be zero during the runs.
+    BOOST_CHECK((ppnf::detail::dropped_gradient_positions(sparse_udp{}.gradient_sparsity(), 3u, 4u)
+                 == std::vector<vector_double::size_type>{2, 3, 4, 5, 9, 11}));
+    // Once discarded, the gradient is assumed dense.
+    ppnf::detail::discard_gradient_sparsity(p3);
+    BOOST_CHECK_EQUAL(ppnf::detail::cached_gradient_sparsity(p3, x0, bfe{})->size(), 12u);
+}
+
+BOOST_AUTO_TEST_CASE(constant_jacobian_detection)
+{
+    const vector_double x0{0.1, -0.2, 0.3, 0.4};
+    problem p{sparse_udp{}};
+    const auto sp = p.gradient_sparsity();
+    std::vector<vector_double::size_type> pos(sp.size());
+    std::iota(pos.begin(), pos.end(), vector_double::size_type(0u));
+    // The gradient is evaluated at x0 and at three probe points.
+    const auto cj = ppnf::detail::detect_constant_jacobian(p, x0, sp, pos);
+    BOOST_CHECK((cj.first == sparsity_pattern{{0, 1}}));
+    BOOST_CHECK((cj.second == vector_double{1.}));
+    BOOST_CHECK_EQUAL(p.get_gevals(), 4u);
+    BOOST_CHECK_THROW(ppnf::detail::detect_constant_jacobian(p, x0, sp, {0u}), std::invalid_argument);
+    BOOST_CHECK_THROW(ppnf::detail::detect_constant_jacobian(p, {0.1}, sp, pos), std::invalid_argument);
+    // In the dense layout, the structural zeros are constant too.
+    problem p2{undeclared_gradient_udp{}};
+    sparsity_pattern dense;
+    for (vector_double::size_type i = 0u; i < 3u; ++i) {
+        for (vector_double::size_type j = 0u; j < 4u; ++j) {
+            dense.emplace_back(i, j);
+        }
+    }
+    const auto cj2
+        = ppnf::detail::detect_constant_jacobian(p2, x0, dense, ppnf::detail::dense_gradient_positions(dense, 4u));
+    BOOST_CHECK((cj2.first == sparsity_pattern{{0, 1}, {0, 2}, {0, 3}, {1, 0}, {1, 1}, {2, 1}, {2, 3}}));
+    BOOST_CHECK((cj2.second == vector_double{1., 0., 0., 0., 0., 0., 0.}));
+    // Caching: cached elements cost only a validation gradient.
+    problem p3{sparse_udp{}};
+    const auto cj0 = ppnf::detail::cached_constant_jacobian(p3, x0, sp, pos);
+    BOOST_CHECK(*cj0 == cj);
+    BOOST_CHECK(ppnf::detail::cached_constant_jacobian(p3, x0, sp, pos) == cj0);
+    BOOST_CHECK_EQUAL(p3.get_gevals(), 5u);
+    // A problem of the same type and with the same bounds, but with different constant values, does not re-use
+    // the cached elements.
+    sparse_udp steeper;
+    steeper.m_slope = 2.;
+    const auto cj1 = ppnf::detail::cached_constant_jacobian(problem{steeper}, x0, sp, pos);
+    BOOST_CHECK((cj1->first == sparsity_pattern{{0, 1}}));
+    BOOST_CHECK((cj1->second == vector_double{2.}));
+    // Nor does a problem whose candidates do not include them.
+    const sparsity_pattern sp2{{0, 0}, {1, 2}, {1, 3}, {2, 0}, {2, 2}};
+    const auto cj3 = ppnf::detail::cached_constant_jacobian(p3, x0, sp2, {0, 2, 3, 4, 5});
+    BOOST_CHECK(cj3->first.empty());
+    // Once discarded, no constant elements are reported, and the detection does not run again.
+    problem p4{sparse_udp{}};
+    ppnf::detail::discard_constant_jacobian(p4);
+    BOOST_CHECK(ppnf::detail::cached_constant_jacobian(p4, x0, sp, pos)->first.empty());
+    BOOST_CHECK_EQUAL(p4.get_gevals(), 0u);
+}
@@ -0,0 +1,189 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#define BOOST_TEST_MODULE hm_structure_test
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <pagmo/types.hpp>
+
+#include <pagmo_plugins_nonfree/detail/hm_structure.hpp>
+
+using namespace pagmo;
+using size_type = vector_double::size_type;
+
+// Random hessians sparsity patterns of a problem with dim variables and nf fitness components: each pattern is a
+// random subset of the lower triangle, in random order (so that the patterns overlap and are not sorted).
+std::vector<sparsity_pattern> random_patterns(size_type dim, size_type nf, std::mt19937 &rng)
+{
+    sparsity_pattern lower;
+    for (size_type i = 0u; i < dim; ++i) {
+        for (size_type j = 0u; j <= i; ++j) {
+            lower.emplace_back(i, j);
+        }
+    }
+    std::vector<sparsity_pattern> retval(nf);
+    for (auto &sp : retval) {
+        const auto n = std::uniform_int_distribution<size_type>(0u, lower.size() / 2u)(rng);
+        std::sample(lower.begin(), lower.end(), std::back_inserter(sp), static_cast<std::ptrdiff_t>(n), rng);
+        std::shuffle(sp.begin(), sp.end(), rng);
+    }
+    return retval;
+}
+
+// The WORHP representation of the hessian of the lagrangian, computed naively: the union of the patterns via
+// std::set_union, the off-diagonal part of it sorted by column and then by row, followed by the full diagonal.
+struct reference_hm {
+    reference_hm(const std::vector<sparsity_pattern> &hs, size_type dim)
+    {
+        for (auto sp : hs) {
+            std::sort(sp.begin(), sp.end());
+            sparsity_pattern tmp;
+            std::set_union(m_merged.begin(), m_merged.end(), sp.begin(), sp.end(), std::back_inserter(tmp));
+            m_merged.swap(tmp);
+        }
+        std::copy_if(m_merged.begin(), m_merged.end(), std::back_inserter(m_off),
+                     [](const sparsity_pattern::value_type &rc) { return rc.first != rc.second; });
+        std::sort(m_off.begin(), m_off.end(),
+                  [](const sparsity_pattern::value_type &a, const sparsity_pattern::value_type &b) {
+                      return std::make_pair(a.second, a.first) < std::make_pair(b.second, b.first);
+                  });
+        m_nnz = m_off.size() + dim;
+    }
+    // The position in HM.val of the element (r, c).
+    size_type slot(const sparsity_pattern::value_type &rc) const
+    {
+        if (rc.first == rc.second) {
+            return m_off.size() + rc.first;
+        }
+        return static_cast<size_type>(std::find(m_off.begin(), m_off.end(), rc) - m_off.begin());
+    }
+    // HM.val, accumulating the weighted hessians element by element.
+    vector_double values(const std::vector<sparsity_pattern> &hs, const std::vector<vector_double> &h, double w0,
+                         const vector_double &mu) const
+    {
+        vector_double retval(m_nnz, 0.);
+        for (decltype(hs.size()) i = 0u; i < hs.size(); ++i) {
+            for (decltype(hs[i].size()) j = 0u; j < hs[i].size(); ++j) {
+                retval[slot(hs[i][j])] += (i == 0u ? w0 : mu[i - 1u]) * h[i][j];
+            }
+        }
+        return retval;
+    }
+    sparsity_pattern m_merged;
+    sparsity_pattern m_off;
+    size_type m_nnz;
+};
+
+BOOST_AUTO_TEST_CASE(structure_and_assembly)
+{
+    std::mt19937 rng(42u);
+    for (auto dim : {1u, 2u, 5u, 13u}) {
+        for (auto nf : {1u, 2u, 7u}) {
+            const auto hs = random_patterns(dim, nf, rng);
+            const reference_hm ref(hs, dim);
+            const auto str = ppnf::detail::build_hm_structure(hs, dim);
+            // The merged pattern and the index map.
+            BOOST_CHECK(str.m_merged == ref.m_merged);
+            BOOST_REQUIRE_EQUAL(str.m_idx_map.size(), ref.m_off.size());
+            for (decltype(str.m_idx_map.size()) k = 0u; k < str.m_idx_map.size(); ++k) {
+                BOOST_CHECK(str.m_merged[str.m_idx_map[k]] == ref.m_off[k]);
+            }
+            // The scatter plan.
+            std::vector<size_type> plan;
+            for (const auto &sp : hs) {
+                for (const auto &rc : sp) {
+                    plan.push_back(ref.slot(rc));
+                }
+            }
+            BOOST_CHECK(str.m_plan == plan);
+            // The assembled values, via the scatter plan and via the gather plan with any number of threads.
+            std::vector<vector_double> h(nf);
+            for (decltype(hs.size()) i = 0u; i < hs.size(); ++i) {
+                for (decltype(hs[i].size()) j = 0u; j < hs[i].size(); ++j) {
+                    h[i].push_back(std::uniform_real_distribution<double>(-1., 1.)(rng));
+                }
+            }
+            vector_double mu(nf - 1u);
+            for (auto &m : mu) {
+                m = std::uniform_real_distribution<double>(-2., 2.)(rng);
+            }
+            const auto expected = ref.values(hs, h, 0.5, mu);
+            // Some garbage, which the assembly must overwrite.
+            vector_double val(ref.m_nnz, 123.);
+            ppnf::detail::hm_scatter(str.m_plan, h, 0.5, mu.data(), val.data(), val.size());
+            BOOST_CHECK(val == expected);
+            for (auto nthreads : {1u, 2u, 3u, 8u}) {
+                const ppnf::detail::hm_gather gather(str.m_plan, hs, ref.m_nnz, nthreads);
+                // The threads of the gather plan are reused across the assemblies.
+                for (auto rep = 0u; rep < 3u; ++rep) {
+                    std::fill(val.begin(), val.end(), 123.);
+                    gather(h, 0.5, mu.data(), val.data());
+                    BOOST_CHECK(val == expected);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(structure_cache)
+{
+    std::mt19937 rng(43u);
+    const auto hs = random_patterns(6u, 3u, rng);
+    const auto str = ppnf::detail::cached_hm_structure(hs, 6u);
+    BOOST_CHECK(ppnf::detail::cached_hm_structure(hs, 6u) == str);
+    BOOST_CHECK(str->m_merged == ppnf::detail::build_hm_structure(hs, 6u).m_merged);
+    // A different dimension yields a different structure.
+    BOOST_CHECK(ppnf::detail::cached_hm_structure(hs, 7u) != str);
+    BOOST_CHECK_EQUAL(ppnf::detail::cached_hm_structure(hs, 7u)->m_plan.size(), str->m_plan.size());
+}
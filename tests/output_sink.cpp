@@ -0,0 +1,129 @@
+/* Copyright 2018 PaGMO development team
+This file is part of "pagmo plugins nonfree", a PaGMO affiliated library.
+The "pagmo plugins nonfree" library, is free software;
+you can redistribute it and/or modify it under the terms of either:
+  * the GNU Lesser General Public License as published by the Free
+    Software Foundation; either version 3 of the License, or (at your
+    option) any later version.
+or
+  * the GNU General Public License as published by the Free Software
+    Foundation; either version 3 of the License, or (at your option) any
+    later version.
+or both in parallel, as here.
+
+Linking "pagmo plugins nonfree" statically or dynamically with other modules is
+making a combined work based on "pagmo plugins nonfree". Thus, the terms and conditions
+of the GNU General Public License cover the whole combination.
+
+As a special exception, the copyright holders of "pagmo plugins nonfree" give you
+permission to combine ABC program with free software programs or libraries that are
+released under the GNU LGPL and with independent modules that communicate with
+"pagmo plugins nonfree" solely through the interface defined by the headers included in
+"pagmo plugins nonfree" bogus_libs folder.
+You may copy and distribute such a system following the terms of the licence
+for "pagmo plugins nonfree" and the licenses of the other code concerned, provided that
+you include the source code of that other code when and as the "pagmo plugins nonfree" licence
+requires distribution of source code and provided that you do not modify the interface defined in the bogus_libs folder
+
+Note that people who make modified versions of "pagmo plugins nonfree" are not obligated to grant this special
+exception for their modified versions; it is their choice whether to do so.
+The GNU General Public License gives permission to release a modified version without this exception;
+this exception also makes it possible to release a modified version which carries forward this exception.
+If you modify the interface defined in the bogus_libs folder, this exception does not apply to your
+modified version of "pagmo plugins nonfree", and you must remove this exception when you distribute your modified
+version.
+
+This exception is an additional permission under section 7 of the GNU General Public License, version 3 (“GPLv3”)
+
+The "pagmo plugins nonfree" library, and its affiliated librares are distributed in the hope
+that they will be useful, but WITHOUT ANY WARRANTY;
+without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+for more details.
+You should have received copies of the GNU General Public License and the
+GNU Lesser General Public License along with the "pagmo plugins nonfree" library.  If not,
+see https://www.gnu.org/licenses/. */
+
+#define BOOST_TEST_MODULE output_sink_test
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <pagmo_plugins_nonfree/detail/output_sink.hpp>
+
+using namespace ppnf::detail;
+
+// Redirects std::cout into a string stream for the lifetime of the object.
+struct cout_capture {
+    cout_capture() : m_old(std::cout.rdbuf(m_oss.rdbuf())) {}
+    ~cout_capture()
+    {
+        std::cout.rdbuf(m_old);
+    }
+    std::string str() const
+    {
+        return m_oss.str();
+    }
+    std::ostringstream m_oss;
+    std::streambuf *m_old;
+};
+
+// Prints some log lines, as the plugins do.
+void print_lines(output_sink &sink)
+{
+    sink.print("\n", std::setw(10), "objevals:", std::setw(15), "objval:", '\n');
+    for (auto i = 1u; i <= 100u; ++i) {
+        sink.print(std::setw(10), i, std::setw(15), 1. / i, i % 2u ? "" : " i", '\n');
+    }
+    sink.print(std::string("Done"), ".\n");
+}
+
+BOOST_AUTO_TEST_CASE(output_modes)
+{
+    BOOST_CHECK(output_mode_from_string("sync") == output_mode::sync);
+    BOOST_CHECK(output_mode_from_string("async") == output_mode::async);
+    BOOST_CHECK(output_mode_from_string("null") == output_mode::null);
+    BOOST_CHECK_THROW(output_mode_from_string("asynchronous"), std::invalid_argument);
+    for (auto mode : {output_mode::sync, output_mode::async, output_mode::null}) {
+        BOOST_CHECK(output_mode_from_string(output_mode_to_string(mode)) == mode);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sink_output)
+{
+    std::string expected;
+    {
+        cout_capture cap;
+        output_sink sink(output_mode::sync);
+        print_lines(sink);
+        expected = cap.str();
+    }
+    BOOST_CHECK(expected.find("       100           0.01 i\nDone.\n") != std::string::npos);
+    // The asynchronous sink writes the same output, by the time it is flushed.
+    {
+        cout_capture cap;
+        output_sink sink(output_mode::async);
+        print_lines(sink);
+        sink.flush();
+        BOOST_CHECK_EQUAL(cap.str(), expected);
+        // The sink can be used after a flush, and it is flushed on destruction.
+        {
+            output_sink sink2(output_mode::async);
+            print_lines(sink2);
+        }
+        BOOST_CHECK_EQUAL(cap.str(), expected + expected);
+    }
+    // The null sink writes nothing.
+    {
+        cout_capture cap;
+        output_sink sink(output_mode::null);
+        print_lines(sink);
+        sink.flush();
+        BOOST_CHECK(cap.str().empty());
+    }
+}
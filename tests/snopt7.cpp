@@ -2,9 +2,16 @@
 #define BOOST_TEST_DYN_LINK
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <map>
+#include <boost/dll/shared_library.hpp>
 #include <boost/lexical_cast.hpp>
 #include <pagmo/algorithm.hpp>
 #include <pagmo/algorithms/null_algorithm.hpp>
+#include <pagmo/bfe.hpp>
 #include <pagmo/io.hpp>
 #include <pagmo/population.hpp>
 #include <pagmo/problem.hpp>
@@ -16,8 +23,11 @@
 #include <pagmo/types.hpp>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
+#include <pagmo_plugins_nonfree/detail/sparsity_detection.hpp>
 #include <pagmo_plugins_nonfree/snopt7.hpp>
 
 #ifdef _MSC_VER
@@ -33,6 +43,26 @@
 using namespace pagmo;
 using namespace ppnf;
 
+// The number of calls made so far to snInit, to setIntParameter / setRealParameter and to deleteSNOPT in the bogus
+// library. The library is kept loaded, so that the counters are not reset between the evolves.
+std::array<int, 3> bogus_call_counts()
+{
+    static const boost::dll::shared_library lib(SNOPT7C_LIB);
+    std::array<int, 3> retval;
+    lib.get<void(int *, int *, int *)>("bogus_call_counts")(&retval[0], &retval[1], &retval[2]);
+    return retval;
+}
+
+// The calls to snInit, setIntParameter / setRealParameter and deleteSNOPT made by f().
+template <typename F>
+std::array<int, 3> calls_made_by(const F &f)
+{
+    const auto before = bogus_call_counts();
+    f();
+    const auto after = bogus_call_counts();
+    return {after[0] - before[0], after[1] - before[1], after[2] - before[2]};
+}
+
 // a throwing problem. It throws every 50 evals
 struct throwing_udp {
     static unsigned counter;
@@ -117,6 +147,10 @@ BOOST_AUTO_TEST_CASE(evolve)
         // We test the throw if the library is not well formed
         BOOST_CHECK_THROW(snopt7(true, "IDONOTEXIST").evolve(population{ackley{10}, 1u}), std::invalid_argument);
         BOOST_CHECK_THROW(snopt7(false, "IDONOTEXIST").evolve(population{ackley{10}, 1u}), std::invalid_argument);
+        // A failed load is not cached, and a successful one is reused
+        BOOST_CHECK_THROW(snopt7(false, "IDONOTEXIST").evolve(population{ackley{10}, 1u}), std::invalid_argument);
+        BOOST_CHECK_NO_THROW(snopt7(false, SNOPT7C_LIB).evolve(population{ackley{10}, 1u}));
+        BOOST_CHECK_NO_THROW(snopt7(false, SNOPT7C_LIB).evolve(population{ackley{10}, 1u}));
 
         // We test the throw if the user has tried to set the derivative option
         uda.set_integer_option("Derivative option", 2);
@@ -152,6 +186,487 @@ BOOST_AUTO_TEST_CASE(evolve)
     population pop{throwing_udp{}, 1u};
     BOOST_CHECK_THROW(uda.evolve(pop), std::invalid_argument);
 }
+BOOST_AUTO_TEST_CASE(persistent_workspace)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK(!uda.get_persistent_workspace());
+    uda.set_persistent_workspace(true);
+    BOOST_CHECK(uda.get_persistent_workspace());
+    BOOST_CHECK(uda.get_extra_info().find("Persistent workspace: active") != std::string::npos);
+    // The calls to snInit, setIntParameter / setRealParameter and deleteSNOPT made by an evolve of uda on prob.
+    const auto evolve_calls = [&uda](const problem &prob) {
+        return calls_made_by([&]() { uda.evolve(population{prob, 1u}); });
+    };
+    // The first evolve initialises the workspace and sets the only option ("Derivative option").
+    BOOST_CHECK((evolve_calls(hock_schittkowsky_71{}) == std::array<int, 3>{1, 1, 0}));
+    // Repeated evolves on the same problem re-use the workspace.
+    BOOST_CHECK((evolve_calls(hock_schittkowsky_71{}) == std::array<int, 3>{0, 0, 0}));
+    BOOST_CHECK((evolve_calls(hock_schittkowsky_71{}) == std::array<int, 3>{0, 0, 0}));
+    // Changing the problem re-initialises it.
+    BOOST_CHECK((evolve_calls(ackley{10}) == std::array<int, 3>{1, 1, 1}));
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{1, 1, 1}));
+    // Adding an option, or changing its value, only sets the option.
+    uda.set_numeric_option("Major optimality tolerance", 1e-8);
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{0, 1, 0}));
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{0, 0, 0}));
+    uda.set_numeric_option("Major optimality tolerance", 1e-9);
+    uda.set_integer_option("Major iterations limit", 100);
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{0, 2, 0}));
+    // Removing an option re-initialises the workspace and sets the remaining ones again.
+    uda.reset_numeric_options();
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{1, 2, 1}));
+    // Invalid options are still detected, also after a successful evolve, and do not spoil the workspace.
+    uda.set_integer_option("invalid_integer_option", 32);
+    BOOST_CHECK_THROW(uda.evolve(population{cec2006{1}, 1u}), std::invalid_argument);
+    uda.reset_integer_options();
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{1, 1, 1}));
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{0, 0, 0}));
+    // Exceptions thrown by the usrfun are still rethrown.
+    BOOST_CHECK_THROW(uda.evolve(population{throwing_udp{}, 1u}), std::invalid_argument);
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{1, 1, 1}));
+    // Copies share the workspace, also through pagmo::algorithm.
+    algorithm algo{uda};
+    BOOST_CHECK(algo.extract<snopt7>()->get_persistent_workspace());
+    BOOST_CHECK((calls_made_by([&algo]() { algo.evolve(population{cec2006{1}, 1u}); })
+                 == std::array<int, 3>{0, 0, 0}));
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{0, 0, 0}));
+    // Concurrent evolves of two copies: one of them uses a temporary workspace.
+    snopt7 uda2{uda};
+    std::thread th([&uda2]() { uda2.evolve(population{cec2006{1}, 1u}); });
+    BOOST_CHECK_NO_THROW(uda.evolve(population{cec2006{1}, 1u}));
+    th.join();
+    // The log is filled as in the default mode.
+    uda.set_verbosity(1u);
+    uda.evolve(population{cec2006{1}, 1u});
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 100u);
+    uda.set_persistent_workspace(false);
+    BOOST_CHECK(!uda.get_persistent_workspace());
+    // Without the persistent workspace, each evolve initialises and releases its own workspace.
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{1, 1, 1}));
+    BOOST_CHECK((evolve_calls(cec2006{1}) == std::array<int, 3>{1, 1, 1}));
+}
+
+// a problem providing the fused fitness_and_gradient() extension
+struct fused_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        return {x[0] * x[0] + x[1] * x[1], x[0] + x[1] - 1.};
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        return {2. * x[0], 2. * x[1], 1., 1.};
+    }
+    std::pair<vector_double, vector_double> fitness_and_gradient(const vector_double &x) const
+    {
+        ++counter;
+        return {fitness(x), gradient(x)};
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 1;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1, -1}, {1, 1}};
+    }
+    static unsigned counter;
+};
+unsigned fused_udp::counter = 0u;
+PPNF_REGISTER_FITNESS_AND_GRADIENT(fused_udp)
+
+BOOST_AUTO_TEST_CASE(fused_fitness_and_gradient)
+{
+    BOOST_CHECK(has_fitness_and_gradient<fused_udp>::value);
+    BOOST_CHECK(!has_fitness_and_gradient<hock_schittkowsky_71>::value);
+    BOOST_CHECK(!has_fitness_and_gradient<throwing_udp>::value);
+    snopt7 uda{false, SNOPT7C_LIB};
+    // The bogus solver calls the usrfun 100 times, always requesting fitness and gradient together:
+    // the fused method is used for every call.
+    BOOST_CHECK_NO_THROW(uda.evolve(population{fused_udp{}, 1u}));
+    BOOST_CHECK_EQUAL(fused_udp::counter, 100u);
+    // Problems without the extension take the usual route.
+    BOOST_CHECK_NO_THROW(uda.evolve(population{hock_schittkowsky_71{}, 1u}));
+    BOOST_CHECK_EQUAL(fused_udp::counter, 100u);
+}
+
+BOOST_AUTO_TEST_CASE(evaluation_cache)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK(uda.get_cache_stats().empty());
+    BOOST_CHECK_EQUAL(uda.get_cache_size(), 16u);
+    // The bogus solver calls the usrfun 100 times at random points: nothing can be re-used.
+    uda.evolve(population{hock_schittkowsky_71{}, 1u});
+    auto stats = uda.get_cache_stats();
+    BOOST_CHECK_EQUAL(stats["fitness_misses"], 100u);
+    BOOST_CHECK_EQUAL(stats["fitness_hits"], 0u);
+    BOOST_CHECK_EQUAL(stats["gradient_misses"], 100u);
+    BOOST_CHECK_EQUAL(stats["gradient_hits"], 0u);
+    BOOST_CHECK_EQUAL(stats["hessians_misses"], 0u);
+    uda.set_cache_size(0u);
+    BOOST_CHECK_EQUAL(uda.get_cache_size(), 0u);
+    BOOST_CHECK(uda.get_extra_info().find("Evaluation cache size: 0") != std::string::npos);
+    BOOST_CHECK_NO_THROW(uda.evolve(population{hock_schittkowsky_71{}, 1u}));
+    BOOST_CHECK_EQUAL(uda.get_cache_stats()["fitness_misses"], 100u);
+    // Exceptions thrown by the UDP are not cached.
+    BOOST_CHECK_THROW(uda.evolve(population{throwing_udp{}, 1u}), std::invalid_argument);
+}
+
+// a problem with a sparse gradient, not providing it and counting its fitness evaluations
+struct no_gradient_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        ++counter;
+        return {x[0] * x[0] + x[1], x[2] * x[3], x[0] + x[2] * x[2]};
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 2;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1, -1, -1, -1}, {1, 1, 1, 1}};
+    }
+    sparsity_pattern gradient_sparsity() const
+    {
+        return {{0, 0}, {0, 1}, {1, 2}, {1, 3}, {2, 0}, {2, 2}};
+    }
+    static std::atomic<unsigned> counter;
+};
+std::atomic<unsigned> no_gradient_udp::counter{0u};
+
+BOOST_AUTO_TEST_CASE(fd_gradient)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK(uda.get_extra_info().find("Batch fitness evaluator: none") != std::string::npos);
+    uda.set_bfe(bfe{});
+    BOOST_CHECK(uda.get_extra_info().find("Batch fitness evaluator: none") == std::string::npos);
+    population pop{no_gradient_udp{}, 1u};
+    no_gradient_udp::counter = 0u;
+    pop = uda.evolve(pop);
+    // The bogus solver calls the usrfun 100 times, requesting both the fitness and the gradient: the gradient
+    // sparsity has two colors, so each call costs three fitness evaluations.
+    BOOST_CHECK_EQUAL(no_gradient_udp::counter.load(), 300u);
+    BOOST_CHECK_EQUAL(uda.get_cache_stats()["gradient_misses"], 100u);
+    // Problems providing the gradient are not affected.
+    BOOST_CHECK_NO_THROW(uda.evolve(population{hock_schittkowsky_71{}, 1u}));
+}
+
+// The same problem, not providing the gradient sparsity and providing the gradient in the dense layout.
+struct undeclared_sparsity_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        return no_gradient_udp{}.fitness(x);
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 2;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1, -1, -1, -1}, {1, 1, 1, 1}};
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        return {2 * x[0], 1, 0, 0, 0, 0, x[3], x[2], 1, 0, 2 * x[2], 0};
+    }
+};
+
+// A problem providing a dense gradient, whose objective does not depend on x[1] for |x[1]| <= 2.
+struct vanishing_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        const auto d = std::max(0., std::abs(x[1]) - 2.);
+        return {x[0] * x[0] + d * d};
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-10, -10}, {10, 10}};
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        const auto d = std::max(0., std::abs(x[1]) - 2.);
+        return {2 * x[0], x[1] > 0. ? 2 * d : -2 * d};
+    }
+};
+
+BOOST_AUTO_TEST_CASE(sparsity_detection)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK(!uda.get_sparsity_detection());
+    BOOST_CHECK(uda.get_extra_info().find("Gradient sparsity detection: inactive") != std::string::npos);
+    uda.set_sparsity_detection(true);
+    BOOST_CHECK(uda.get_sparsity_detection());
+    BOOST_CHECK(uda.get_extra_info().find("Gradient sparsity detection: active") != std::string::npos);
+    // The gradient of the problem is probed, and then gathered into the detected pattern.
+    population pop{undeclared_sparsity_udp{}, 1u};
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(pop.get_problem().get_gevals(), 4u);
+    // Without the gradient, the fitness is probed: four times, each costing one evaluation plus one per variable.
+    pop = population{cec2006{1}, 1u};
+    const auto fevals0 = pop.get_problem().get_fevals();
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(pop.get_problem().get_fevals() - fevals0, 4u * 14u);
+    // The detected pattern is cached: re-using it costs one probe to validate it, perturbing only 8 variables.
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(pop.get_problem().get_fevals() - fevals0, 4u * 14u + 9u);
+    // Problems providing the gradient sparsity are not affected.
+    pop = population{no_gradient_udp{}, 1u};
+    const auto fevals = pop.get_problem().get_fevals();
+    uda.set_bfe(bfe{});
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(pop.get_problem().get_fevals(), fevals);
+    // Near x = (0, 0) the objective does not depend on x[1], but it does at the random points visited by the bogus
+    // solver: the run is stopped and started again with a dense gradient sparsity, which is then cached.
+    population pop2{vanishing_udp{}};
+    pop2.push_back({0., 0.});
+    BOOST_CHECK_NO_THROW(pop2 = uda.evolve(pop2));
+    BOOST_CHECK_EQUAL(ppnf::detail::cached_gradient_sparsity(pop2.get_problem(), {0., 0.}, bfe{})->size(), 2u);
+}
+
+// A problem with a linear part: the objective is linear in x[1], the first constraint is linear and the second one
+// is linear in x[0].
+struct linear_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        return {x[0] * x[0] + 2. * x[1], x[0] + x[1] + x[2] - 1., x[2] * x[3] + 3. * x[0]};
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 2;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1, -1, -1, -1}, {1, 1, 1, 1}};
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        return {2 * x[0], 2, 1, 1, 1, 3, x[3], x[2]};
+    }
+    sparsity_pattern gradient_sparsity() const
+    {
+        return {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {1, 2}, {2, 0}, {2, 2}, {2, 3}};
+    }
+    std::pair<sparsity_pattern, vector_double> linear_jacobian() const
+    {
+        // Not sorted on purpose.
+        return {{{2, 0}, {0, 1}, {1, 0}, {1, 1}, {1, 2}}, {3, 2, 1, 1, 1}};
+    }
+};
+
+PPNF_REGISTER_LINEAR_JACOBIAN(linear_udp)
+
+// A problem declaring an invalid linear part.
+struct bad_linear_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        return {x[0] + x[1]};
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1, -1}, {1, 1}};
+    }
+    std::pair<sparsity_pattern, vector_double> linear_jacobian() const
+    {
+        return m_linear;
+    }
+    std::pair<sparsity_pattern, vector_double> m_linear;
+};
+
+PPNF_REGISTER_LINEAR_JACOBIAN(bad_linear_udp)
+
+BOOST_AUTO_TEST_CASE(linear_jacobian)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    population pop{linear_udp{}, 1u};
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    // The fitness stored in the population includes the linear part.
+    BOOST_CHECK(pop.get_f()[0] == pop.get_problem().fitness(pop.get_x()[0]));
+    // The same with a numerical gradient computed by the plugin.
+    uda.set_bfe(bfe{});
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK(pop.get_f()[0] == pop.get_problem().fitness(pop.get_x()[0]));
+    // Invalid linear parts are rejected.
+    BOOST_CHECK_THROW(uda.evolve(population{bad_linear_udp{{{{0, 0}}, {1, 2}}}, 1u}), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.evolve(population{bad_linear_udp{{{{0, 2}}, {1}}}, 1u}), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.evolve(population{bad_linear_udp{{{{1, 0}}, {1}}}, 1u}), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.evolve(population{bad_linear_udp{{{{0, 0}, {0, 0}}, {1, 1}}}, 1u}), std::invalid_argument);
+    BOOST_CHECK_NO_THROW(uda.evolve(population{bad_linear_udp{{{{0, 1}, {0, 0}}, {1, 1}}}, 1u}));
+}
+
+// The problem of linear_udp, not declaring its linear part.
+struct constant_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        return linear_udp{}.fitness(x);
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 2;
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return linear_udp{}.get_bounds();
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        ++counter;
+        return linear_udp{}.gradient(x);
+    }
+    sparsity_pattern gradient_sparsity() const
+    {
+        return linear_udp{}.gradient_sparsity();
+    }
+    static std::atomic<unsigned> counter;
+};
+std::atomic<unsigned> constant_udp::counter{0u};
+
+// A problem with a gradient element that is constant only piecewise.
+struct piecewise_udp {
+    vector_double fitness(const vector_double &x) const
+    {
+        return {std::abs(x[0]) + x[1] * x[1]};
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1, -1}, {1, 1}};
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        ++counter;
+        return {x[0] < 0. ? -1. : 1., 2 * x[1]};
+    }
+    static std::atomic<unsigned> counter;
+};
+std::atomic<unsigned> piecewise_udp::counter{0u};
+
+BOOST_AUTO_TEST_CASE(constant_jacobian_detection)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK(!uda.get_constant_jacobian_detection());
+    BOOST_CHECK(uda.get_extra_info().find("Constant Jacobian detection: inactive") != std::string::npos);
+    uda.set_constant_jacobian_detection(true);
+    BOOST_CHECK(uda.get_constant_jacobian_detection());
+    BOOST_CHECK(uda.get_extra_info().find("Constant Jacobian detection: active") != std::string::npos);
+    // The detection costs four gradient evaluations, and then the bogus solver calls the usrfun 100 times.
+    constant_udp::counter = 0u;
+    population pop{constant_udp{}, 1u};
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(constant_udp::counter.load(), 104u);
+    BOOST_CHECK(pop.get_f()[0] == pop.get_problem().fitness(pop.get_x()[0]));
+    // The detected elements are cached: re-using them costs one gradient evaluation to validate them.
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(constant_udp::counter.load(), 205u);
+    // Near x = (0.5, 0.5) the derivative of the piecewise problem with respect to x[0] is constant, but it changes
+    // at the random points visited by the bogus solver: the run is stopped and started again without the linear part.
+    piecewise_udp::counter = 0u;
+    population pop2{piecewise_udp{}};
+    pop2.push_back({0.5, 0.5});
+    BOOST_CHECK_NO_THROW(pop2 = uda.evolve(pop2));
+    BOOST_CHECK(piecewise_udp::counter.load() > 104u);
+    // The detection is discarded for good.
+    piecewise_udp::counter = 0u;
+    BOOST_CHECK_NO_THROW(pop2 = uda.evolve(pop2));
+    BOOST_CHECK_EQUAL(piecewise_udp::counter.load(), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(warm_start)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK(!uda.get_warm_start());
+    BOOST_CHECK(uda.get_extra_info().find("Warm start: inactive") != std::string::npos);
+    uda.set_warm_start(true);
+    BOOST_CHECK(uda.get_warm_start());
+    BOOST_CHECK(uda.get_extra_info().find("Warm start: active") != std::string::npos);
+    // No data before the first evolve.
+    BOOST_CHECK(std::get<0>(uda.get_warm_start_data()).empty());
+    BOOST_CHECK(std::get<2>(uda.get_warm_start_data()).empty());
+    // The final state is stored after each evolve.
+    population pop{hock_schittkowsky_71{}, 1u};
+    uda.set_verbosity(10u);
+    pop = uda.evolve(pop);
+    auto data = uda.get_warm_start_data();
+    BOOST_CHECK_EQUAL(std::get<0>(data), pop.get_problem().get_name());
+    BOOST_CHECK_EQUAL(std::get<2>(data).size(), 4u);
+    BOOST_CHECK_EQUAL(std::get<3>(data).size(), 4u);
+    BOOST_CHECK_EQUAL(std::get<4>(data).size(), 3u);
+    BOOST_CHECK_EQUAL(std::get<5>(data).size(), 3u);
+    // The next evolve on the same problem is warm started, on a different problem cold started.
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_NO_THROW(uda.evolve(population{cec2006{1}, 1u}));
+    BOOST_CHECK_EQUAL(std::get<0>(uda.get_warm_start_data()), problem{cec2006{1}}.get_name());
+    // The data can be transferred to another object.
+    snopt7 uda2{false, SNOPT7C_LIB};
+    uda2.set_warm_start(true);
+    uda2.set_warm_start_data(data);
+    BOOST_CHECK(uda2.get_warm_start_data() == data);
+    BOOST_CHECK_NO_THROW(uda2.evolve(pop));
+    // The warm start database: the states are looked up by the initial decision vector.
+    BOOST_CHECK_EQUAL(uda2.get_warm_start_db_size(), 0u);
+    uda2.set_warm_start_db_size(5u);
+    BOOST_CHECK_EQUAL(uda2.get_warm_start_db_size(), 5u);
+    BOOST_CHECK(uda2.get_extra_info().find("Warm start database size: 5") != std::string::npos);
+    for (auto i = 0u; i < 10u; ++i) {
+        BOOST_CHECK_NO_THROW(uda2.evolve(population{hock_schittkowsky_71{}, 1u}));
+    }
+    uda2.set_warm_start_db_size(0u);
+    BOOST_CHECK_NO_THROW(uda2.evolve(population{hock_schittkowsky_71{}, 1u}));
+    // Inconsistent data is rejected.
+    std::get<3>(data).pop_back();
+    BOOST_CHECK_THROW(uda2.set_warm_start_data(data), std::invalid_argument);
+    std::get<3>(data).push_back(0.);
+    std::get<5>(data).push_back(0.);
+    BOOST_CHECK_THROW(uda2.set_warm_start_data(data), std::invalid_argument);
+    std::get<5>(data).pop_back();
+    std::get<1>(data) = -1;
+    BOOST_CHECK_THROW(uda2.set_warm_start_data(data), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(stop_criteria)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK(uda.get_stop_criteria().empty());
+    BOOST_CHECK(uda.get_extra_info().find("Early termination criteria") == std::string::npos);
+    // Invalid criteria are rejected.
+    BOOST_CHECK_THROW(uda.set_stop_criterion("Major iterations limit", 10.), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.set_stop_criterion("Target objective", std::nan("")), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.set_stop_criterion("Max dual infeasibility", -1.), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.set_stop_criterion("Stall iterations", -1.), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.set_stop_criterion("Stall iterations", 2.5), std::invalid_argument);
+    BOOST_CHECK_THROW(uda.set_stop_criteria({{"Stall iterations", 3.}, {"Stall tol", 1.}}), std::invalid_argument);
+    BOOST_CHECK(uda.get_stop_criteria().empty());
+    // The bogus library makes 100 major iterations, each evaluating the fitness once.
+    uda.set_verbosity(1u);
+    population pop{cec2006{1}, 1u};
+    uda.set_stop_criterion("Primal feasibility", 1.);
+    BOOST_CHECK(uda.get_extra_info().find("Early termination criteria") != std::string::npos);
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_last_opt_result(), 74);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 1u);
+    uda.reset_stop_criteria();
+    uda.set_stop_criteria({{"Max primal infeasibility", 0.5}, {"Infeasibility check iteration", 10.}});
+    BOOST_CHECK_EQUAL(uda.get_stop_criteria().size(), 2u);
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_last_opt_result(), 74);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 10u);
+    uda.reset_stop_criteria();
+    uda.set_stop_criteria({{"Stall iterations", 3.}, {"Stall tolerance", 1e300}});
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_last_opt_result(), 74);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 4u);
+    uda.reset_stop_criteria();
+    uda.set_stop_criterion("Target objective", 1e300);
+    population pop2{ackley{10}, 1u};
+    pop2 = uda.evolve(pop2);
+    BOOST_CHECK_EQUAL(uda.get_last_opt_result(), 74);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 1u);
+    // Without criteria, the hook is removed.
+    uda.reset_stop_criteria();
+    BOOST_CHECK(uda.get_stop_criteria().empty());
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_last_opt_result(), 1);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 100u);
+}
+
 BOOST_AUTO_TEST_CASE(streams_and_log)
 {
     snopt7 uda{false, SNOPT7C_LIB};
@@ -165,6 +680,91 @@ BOOST_AUTO_TEST_CASE(streams_and_log)
     BOOST_CHECK(uda.get_extra_info().find("Name of the snopt7_c library") != std::string::npos);
 }
 
+BOOST_AUTO_TEST_CASE(log_capacity)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK_EQUAL(uda.get_log_capacity(), 0u);
+    BOOST_CHECK(uda.get_extra_info().find("Log capacity: unbounded") != std::string::npos);
+    BOOST_CHECK_THROW(uda.set_log_capacity(1u), std::invalid_argument);
+    uda.set_log_capacity(16u);
+    BOOST_CHECK_EQUAL(uda.get_log_capacity(), 16u);
+    BOOST_CHECK(uda.get_extra_info().find("Log capacity: 16") != std::string::npos);
+    // The bogus library evaluates the fitness 100 times: one evaluation every 8 is kept.
+    population pop{cec2006{1}, 1u};
+    uda.set_verbosity(1u);
+    pop = uda.evolve(pop);
+    const auto &log = uda.get_columnar_log();
+    BOOST_CHECK_EQUAL(log.size(), 13u);
+    BOOST_CHECK_EQUAL(log.stride(), 8u);
+    BOOST_CHECK_EQUAL(log.column<0>()[0], 1u);
+    BOOST_CHECK_EQUAL(log.column<0>()[12], 97u);
+    const auto &lines = uda.get_log();
+    BOOST_CHECK_EQUAL(lines.size(), 13u);
+    BOOST_CHECK_EQUAL(std::get<1>(lines[5]), log.column<1>()[5]);
+    // The lines are built once, and kept until the log changes.
+    BOOST_CHECK(&uda.get_log() == &lines);
+    BOOST_CHECK(snopt7{uda}.get_log() == lines);
+    uda.set_log_capacity(4u);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 4u);
+    BOOST_CHECK(uda.get_log()[1] == log[1]);
+    // Back to an unbounded log.
+    uda.set_log_capacity(0u);
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(output_mode)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK_EQUAL(uda.get_output_mode(), "sync");
+    BOOST_CHECK_THROW(uda.set_output_mode("none"), std::invalid_argument);
+    BOOST_CHECK(uda.get_extra_info().find("Output mode: sync") != std::string::npos);
+    // The output mode does not affect the log.
+    population pop{cec2006{1}, 1u};
+    uda.set_verbosity(1u);
+    for (const auto &mode : {"async", "null"}) {
+        uda.set_output_mode(mode);
+        BOOST_CHECK_EQUAL(uda.get_output_mode(), mode);
+        pop = uda.evolve(pop);
+        BOOST_CHECK_EQUAL(uda.get_log().size(), 100u);
+    }
+    uda.set_log_mode("major");
+    uda.set_output_mode("async");
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_major_log().size(), 100u);
+}
+
+BOOST_AUTO_TEST_CASE(major_log)
+{
+    snopt7 uda{false, SNOPT7C_LIB};
+    BOOST_CHECK_EQUAL(uda.get_log_mode(), "evaluation");
+    BOOST_CHECK_THROW(uda.set_log_mode("majors"), std::invalid_argument);
+    uda.set_log_mode("major");
+    BOOST_CHECK_EQUAL(uda.get_log_mode(), "major");
+    BOOST_CHECK(uda.get_extra_info().find("Log mode: major") != std::string::npos);
+    // Without verbosity, nothing is logged.
+    population pop{cec2006{1}, 1u};
+    pop = uda.evolve(pop);
+    BOOST_CHECK(uda.get_log().empty());
+    BOOST_CHECK(uda.get_major_log().empty());
+    // The bogus library makes 100 major iterations.
+    uda.set_verbosity(1u);
+    pop = uda.evolve(pop);
+    BOOST_CHECK(uda.get_log().empty());
+    BOOST_CHECK_EQUAL(uda.get_major_log().size(), 100u);
+    const auto line = uda.get_major_log()[0];
+    BOOST_CHECK(line == (snopt7::major_log_line_type{1, std::get<1>(line), 1., 1., 1., 0}));
+    uda.set_verbosity(10u);
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_major_log().size(), 10u);
+    BOOST_CHECK_EQUAL(std::get<0>(uda.get_major_log().back()), 100);
+    // Back to the evaluation log.
+    uda.set_log_mode("evaluation");
+    pop = uda.evolve(pop);
+    BOOST_CHECK_EQUAL(uda.get_log().size(), 10u);
+    BOOST_CHECK(uda.get_major_log().empty());
+}
+
 BOOST_AUTO_TEST_CASE(serialization_test)
 {
     // Make one evolution
@@ -174,12 +774,25 @@ BOOST_AUTO_TEST_CASE(serialization_test)
     algo.set_verbosity(1u);
     algo.extract<snopt7>()->set_integer_option("some_int", 4);
     algo.extract<snopt7>()->set_numeric_option("some_float", 2.2);
+    algo.extract<snopt7>()->set_persistent_workspace(true);
+    algo.extract<snopt7>()->set_cache_size(3u);
+    algo.extract<snopt7>()->set_bfe(bfe{});
+    algo.extract<snopt7>()->set_sparsity_detection(true);
+    algo.extract<snopt7>()->set_constant_jacobian_detection(true);
+    algo.extract<snopt7>()->set_warm_start(true);
+    algo.extract<snopt7>()->set_warm_start_db_size(7u);
+    algo.extract<snopt7>()->set_stop_criterion("Stall iterations", 50.);
+    algo.extract<snopt7>()->set_log_mode("major");
+    algo.extract<snopt7>()->set_log_capacity(64u);
+    algo.extract<snopt7>()->set_output_mode("async");
     pop = algo.evolve(pop);
 
     // Store the string representation of p.
     std::stringstream ss;
     auto before_text = boost::lexical_cast<std::string>(algo);
     auto before_log = algo.extract<snopt7>()->get_log();
+    auto before_warm_start_data = algo.extract<snopt7>()->get_warm_start_data();
+    auto before_major_log = algo.extract<snopt7>()->get_major_log();
     // Now serialize, deserialize and compare the result.
     {
         boost::archive::binary_oarchive oarchive(ss);
@@ -193,4 +806,20 @@ BOOST_AUTO_TEST_CASE(serialization_test)
     }
     auto after_text = boost::lexical_cast<std::string>(algo);
     BOOST_CHECK_EQUAL(before_text, after_text);
+    BOOST_CHECK(algo.extract<snopt7>()->get_persistent_workspace());
+    BOOST_CHECK_EQUAL(algo.extract<snopt7>()->get_cache_size(), 3u);
+    BOOST_CHECK(algo.extract<snopt7>()->get_sparsity_detection());
+    BOOST_CHECK(algo.extract<snopt7>()->get_constant_jacobian_detection());
+    BOOST_CHECK(algo.extract<snopt7>()->get_warm_start());
+    BOOST_CHECK_EQUAL(algo.extract<snopt7>()->get_warm_start_db_size(), 7u);
+    BOOST_CHECK_EQUAL(algo.extract<snopt7>()->get_log_mode(), "major");
+    BOOST_CHECK_EQUAL(algo.extract<snopt7>()->get_log_capacity(), 64u);
+    BOOST_CHECK_EQUAL(algo.extract<snopt7>()->get_output_mode(), "async");
+    BOOST_CHECK(algo.extract<snopt7>()->get_log() == before_log);
+    BOOST_CHECK(algo.extract<snopt7>()->get_major_log() == before_major_log);
+    BOOST_CHECK(algo.extract<snopt7>()->get_stop_criteria()
+                == (std::map<std::string, double>{{"Stall iterations", 50.}}));
+    BOOST_CHECK(algo.extract<snopt7>()->get_warm_start_data() == before_warm_start_data);
+    // The deserialized object has its own persistent workspace.
+    BOOST_CHECK_NO_THROW(algo.evolve(pop));
 }
@@ -0,0 +1,140 @@
+#define BOOST_TEST_MODULE warm_start_db_test
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <pagmo/s11n.hpp>
+#include <pagmo/types.hpp>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <pagmo_plugins_nonfree/detail/warm_start_db.hpp>
+
+using namespace pagmo;
+
+BOOST_AUTO_TEST_CASE(nearest)
+{
+    using db_type = ppnf::detail::warm_start_db<std::size_t>;
+    std::mt19937 rng(42u);
+    std::uniform_real_distribution<double> u(-1., 1.);
+    for (auto trial = 0u; trial < 20u; ++trial) {
+        const auto cap = 1u + rng() % 100u, d = 1u + rng() % 6u;
+        const db_type::key_type k{"a", d, 1u};
+        db_type db;
+        db.set_capacity(cap);
+        vector_double scale(d);
+        for (auto &v : scale) {
+            v = 1. + u(rng) * u(rng);
+        }
+        // The decision vectors inserted so far.
+        std::vector<vector_double> pts;
+        const auto dist2 = [&pts, &scale](std::size_t i, const vector_double &x) {
+            double retval = 0.;
+            for (decltype(x.size()) j = 0u; j < x.size(); ++j) {
+                retval += (pts[i][j] - x[j]) / scale[j] * (pts[i][j] - x[j]) / scale[j];
+            }
+            return retval;
+        };
+        // Lookups interleaved with insertions (and, past the capacity, evictions).
+        for (auto n = 0u; n < 2u * cap; ++n) {
+            vector_double x(d);
+            for (auto &v : x) {
+                // Some repeated coordinates.
+                v = rng() % 4u ? u(rng) : 0.5;
+            }
+            pts.push_back(x);
+            db.insert(k, x, n);
+            for (auto &v : x) {
+                v = u(rng);
+            }
+            // Same distance as the brute force search over the entries not evicted.
+            double best = std::numeric_limits<double>::infinity();
+            for (std::size_t i = pts.size() > cap ? pts.size() - cap : 0u; i < pts.size(); ++i) {
+                best = std::min(best, dist2(i, x));
+            }
+            const auto found = *db.nearest(k, x, scale);
+            BOOST_CHECK(found + cap >= pts.size());
+            BOOST_CHECK(std::abs(dist2(found, x) - best) <= 1e-12 * best);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(warm_start_db)
+{
+    using db_type = ppnf::detail::warm_start_db<int>;
+    const db_type::key_type k1{"a", 1u, 1u}, k2{"b", 1u, 1u};
+    const vector_double scale{1.};
+    // Disabled by default.
+    db_type db;
+    db.insert(k1, {0.}, 1);
+    BOOST_CHECK_EQUAL(db.size(), 0u);
+    BOOST_CHECK(db.nearest(k1, {0.}, scale) == nullptr);
+    // Lookups are per problem.
+    db.set_capacity(3u);
+    db.insert(k1, {0.}, 1);
+    db.insert(k1, {1.}, 2);
+    db.insert(k2, {0.}, 3);
+    BOOST_CHECK_EQUAL(db.size(), 3u);
+    BOOST_CHECK_EQUAL(*db.nearest(k1, {0.2}, scale), 1);
+    BOOST_CHECK_EQUAL(*db.nearest(k1, {0.7}, scale), 2);
+    BOOST_CHECK_EQUAL(*db.nearest(k2, {0.7}, scale), 3);
+    BOOST_CHECK(db.nearest(db_type::key_type{"c", 1u, 1u}, {0.}, scale) == nullptr);
+    // When full, the oldest entry is evicted.
+    db.insert(k1, {2.}, 4);
+    BOOST_CHECK_EQUAL(db.size(), 3u);
+    BOOST_CHECK_EQUAL(*db.nearest(k1, {0.2}, scale), 2);
+    db.insert(k1, {3.}, 5);
+    BOOST_CHECK_EQUAL(*db.nearest(k1, {0.2}, scale), 4);
+    BOOST_CHECK_EQUAL(*db.nearest(k2, {0.}, scale), 3);
+    db.insert(k1, {4.}, 6);
+    BOOST_CHECK(db.nearest(k2, {0.}, scale) == nullptr);
+    // The variables are scaled.
+    db_type db2;
+    db2.set_capacity(2u);
+    const db_type::key_type k3{"c", 2u, 1u};
+    db2.insert(k3, {0., 1.}, 1);
+    db2.insert(k3, {2., 0.}, 2);
+    BOOST_CHECK_EQUAL(*db2.nearest(k3, {0.5, 0.}, {1., 1.}), 1);
+    BOOST_CHECK_EQUAL(*db2.nearest(k3, {0.5, 0.}, {10., 1.}), 2);
+    BOOST_CHECK((ppnf::detail::warm_start_scale({-1., 0., -std::numeric_limits<double>::infinity()}, {1., 0., 0.})
+                 == vector_double{2., 1., 1.}));
+    // Shrinking evicts the oldest entries.
+    db.set_capacity(1u);
+    BOOST_CHECK_EQUAL(db.size(), 1u);
+    BOOST_CHECK_EQUAL(*db.nearest(k1, {0.}, scale), 6);
+    db.clear();
+    BOOST_CHECK_EQUAL(db.size(), 0u);
+    BOOST_CHECK_EQUAL(db.capacity(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(serialization_test)
+{
+    using db_type = ppnf::detail::warm_start_db<int>;
+    const db_type::key_type k{"a", 1u, 1u};
+    db_type db;
+    db.set_capacity(2u);
+    db.insert(k, {0.}, 1);
+    db.insert(k, {1.}, 2);
+    BOOST_CHECK_EQUAL(*db.nearest(k, {0.}, {1.}), 1);
+    std::stringstream ss;
+    {
+        boost::archive::binary_oarchive oarchive(ss);
+        oarchive << db;
+    }
+    db_type db2;
+    {
+        boost::archive::binary_iarchive iarchive(ss);
+        iarchive >> db2;
+    }
+    BOOST_CHECK_EQUAL(db2.capacity(), 2u);
+    BOOST_CHECK_EQUAL(db2.size(), 2u);
+    BOOST_CHECK_EQUAL(*db2.nearest(k, {0.}, {1.}), 1);
+    BOOST_CHECK_EQUAL(*db2.nearest(k, {0.9}, {1.}), 2);
+    // The eviction order is preserved.
+    db2.insert(k, {2.}, 3);
+    BOOST_CHECK_EQUAL(*db2.nearest(k, {0.}, {1.}), 2);
+}
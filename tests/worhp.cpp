@@ -1,9 +1,17 @@
 #define BOOST_TEST_MODULE worhp_test
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
+#include <boost/dll/shared_library.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
 #include <pagmo/algorithm.hpp>
 #include <pagmo/algorithms/null_algorithm.hpp>
+#include <pagmo/bfe.hpp>
+#include <pagmo/exceptions.hpp>
 #include <pagmo/io.hpp>
 #include <pagmo/population.hpp>
 #include <pagmo/problem.hpp>
@@ -18,8 +26,11 @@
 #include <pagmo/types.hpp>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
+#include <pagmo_plugins_nonfree/detail/sparsity_detection.hpp>
 #include <pagmo_plugins_nonfree/worhp.hpp>
 
 #ifdef _MSC_VER
@@ -35,6 +46,26 @@
 using namespace pagmo;
 using namespace ppnf;
 
+// The number of calls made so far to WorhpInit, WorhpRestart and WorhpFree in the bogus library. The library is kept
+// loaded, so that the counters are not reset between the evolves.
+std::array<int, 3> bogus_call_counts()
+{
+    static const boost::dll::shared_library lib(WORHP_LIB);
+    std::array<int, 3> retval;
+    lib.get<void(int *, int *, int *)>("bogus_call_counts")(&retval[0], &retval[1], &retval[2]);
+    return retval;
+}
+
+// The calls to WorhpInit, WorhpRestart and WorhpFree made by f().
+template <typename F>
+std::array<int, 3> calls_made_by(const F &f)
+{
+    const auto before = bogus_call_counts();
+    f();
+    const auto after = bogus_call_counts();
+    return {after[0] - before[0], after[1] - before[1], after[2] - before[2]};
+}
+
 /*-----------------------------------------------------------------------
  *
  * Minimise    f
@@ -101,6 +132,18 @@ struct worhp_test_problem {
     }
 };
 
+// The same problem, also providing the fused fitness_and_gradient() extension.
+struct worhp_fused_problem : worhp_test_problem {
+    std::pair<vector_double, vector_double> fitness_and_gradient(const vector_double &x) const
+    {
+        ++counter;
+        return {fitness(x), gradient(x)};
+    }
+    static unsigned counter;
+};
+unsigned worhp_fused_problem::counter = 0u;
+PPNF_REGISTER_FITNESS_AND_GRADIENT(worhp_fused_problem)
+
 BOOST_AUTO_TEST_CASE(construction)
 {
     // We test construction of the worhp uda
@@ -123,6 +166,8 @@ BOOST_AUTO_TEST_CASE(evolve)
     // We test the throw if the library is not well formed
     BOOST_CHECK_THROW(worhp(true, "IDONOTEXIST").evolve(population{rosenbrock{10}, 1u}), std::invalid_argument);
     BOOST_CHECK_THROW(worhp(false, "IDONOTEXIST").evolve(population{rosenbrock{10}, 1u}), std::invalid_argument);
+    // A failed load is not cached
+    BOOST_CHECK_THROW(worhp(false, "IDONOTEXIST").evolve(population{rosenbrock{10}, 1u}), std::invalid_argument);
     // We call evolve and test that it does not throw in allowed cases.
     worhp uda{true, WORHP_LIB};
     problem p{worhp_test_problem{}};
@@ -163,6 +208,92 @@ BOOST_AUTO_TEST_CASE(verbosity)
     }
 }
 
+BOOST_AUTO_TEST_CASE(log_capacity)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK_EQUAL(uda.get_log_capacity(), 0u);
+    BOOST_CHECK(uda.get_extra_info().find("Log capacity: unbounded") != std::string::npos);
+    BOOST_CHECK_THROW(uda.set_log_capacity(1u), std::invalid_argument);
+    problem p{worhp_test_problem{}};
+    uda.set_verbosity(1u);
+    uda.evolve(population{p, 1u});
+    const auto full_log = uda.get_log();
+    BOOST_CHECK(full_log.size() > 2u);
+    // A bounded log keeps a chronological subset of the full log.
+    uda.set_log_capacity(2u);
+    BOOST_CHECK_EQUAL(uda.get_log_capacity(), 2u);
+    BOOST_CHECK(uda.get_extra_info().find("Log capacity: 2") != std::string::npos);
+    uda.evolve(population{p, 1u});
+    const auto &log = uda.get_columnar_log();
+    BOOST_CHECK(log.size() <= 2u);
+    BOOST_CHECK(log.stride() > 1u);
+    for (decltype(log.size()) i = 0u; i < log.size(); ++i) {
+        BOOST_CHECK(log[i] == full_log[i * log.stride()]);
+    }
+    // The lines returned by get_log() are built once, and kept until the log changes.
+    const auto &lines = uda.get_log();
+    BOOST_CHECK(lines == log.lines());
+    BOOST_CHECK(&uda.get_log() == &lines);
+    uda.set_log_capacity(0u);
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK(uda.get_log().size() > 2u);
+    BOOST_CHECK(uda.get_log() == uda.get_columnar_log().lines());
+}
+
+BOOST_AUTO_TEST_CASE(output_mode)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK_EQUAL(uda.get_output_mode(), "sync");
+    BOOST_CHECK_THROW(uda.set_output_mode("none"), std::invalid_argument);
+    BOOST_CHECK(uda.get_extra_info().find("Output mode: sync") != std::string::npos);
+    // The output mode does not affect the log.
+    problem p{worhp_test_problem{}};
+    uda.set_verbosity(1u);
+    uda.evolve(population{p, 1u});
+    const auto log = uda.get_log();
+    for (const auto &mode : {"async", "null"}) {
+        uda.set_output_mode(mode);
+        BOOST_CHECK_EQUAL(uda.get_output_mode(), mode);
+        uda.evolve(population{p, 1u});
+        BOOST_CHECK_EQUAL(uda.get_log().size(), log.size());
+    }
+    uda.set_log_mode("major");
+    uda.set_output_mode("async");
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK_EQUAL(uda.get_major_log().size(), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(major_log)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK_EQUAL(uda.get_log_mode(), "evaluation");
+    BOOST_CHECK_THROW(uda.set_log_mode("iteration"), std::invalid_argument);
+    uda.set_log_mode("major");
+    BOOST_CHECK_EQUAL(uda.get_log_mode(), "major");
+    BOOST_CHECK(uda.get_extra_info().find("Log mode: major") != std::string::npos);
+    problem p{worhp_test_problem{}};
+    // Without verbosity, nothing is logged.
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK(uda.get_log().empty());
+    BOOST_CHECK(uda.get_major_log().empty());
+    // The bogus library makes 10 major iterations.
+    uda.set_verbosity(1u);
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK(uda.get_log().empty());
+    BOOST_CHECK_EQUAL(uda.get_major_log().size(), 10u);
+    const auto line = uda.get_major_log()[0];
+    BOOST_CHECK(line == (worhp::major_log_line_type{1, std::get<1>(line), 0., 1., 1., true}));
+    uda.set_verbosity(5u);
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK_EQUAL(uda.get_major_log().size(), 2u);
+    BOOST_CHECK_EQUAL(std::get<0>(uda.get_major_log().back()), 10);
+    // Back to the evaluation log.
+    uda.set_log_mode("evaluation");
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK(uda.get_log().size() > 0u);
+    BOOST_CHECK(uda.get_major_log().empty());
+}
+
 BOOST_AUTO_TEST_CASE(parameters_setting)
 {
     worhp uda{true, WORHP_LIB};
@@ -214,6 +345,440 @@ BOOST_AUTO_TEST_CASE(parameters_setting)
     BOOST_CHECK(uda.get_integer_options().size() == 0);
 }
 
+// A problem whose fitness throws once the population has been initialised.
+struct worhp_throwing_problem {
+    vector_double fitness(const vector_double &x) const
+    {
+        if (m_counter++ > 0u) {
+            throw std::invalid_argument("Throwing fitness");
+        }
+        return {x[0] * x[0]};
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-1.}, {1.}};
+    }
+    mutable unsigned m_counter = 0u;
+};
+
+BOOST_AUTO_TEST_CASE(persistent_workspace)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK(!uda.get_persistent_workspace());
+    uda.set_persistent_workspace(true);
+    BOOST_CHECK(uda.get_persistent_workspace());
+    BOOST_CHECK(uda.get_extra_info().find("Persistent workspace: active") != std::string::npos);
+    problem p{worhp_test_problem{}};
+    // The calls to WorhpInit, WorhpRestart and WorhpFree made by an evolve of uda on prob.
+    const auto evolve_calls = [&uda](const problem &prob) {
+        return calls_made_by([&]() { uda.evolve(population{prob, 1u}); });
+    };
+    // The first evolve initialises the data structures, the next ones on the same problem restart WORHP re-using
+    // them.
+    population pop{p, 1u};
+    for (auto i = 0u; i < 3u; ++i) {
+        BOOST_CHECK((calls_made_by([&]() { pop = uda.evolve(pop); }) == std::array<int, 3>{i == 0u, i > 0u, 0}));
+        BOOST_CHECK(uda.get_last_opt_result().find("All went great!!!!") != std::string::npos);
+    }
+    const auto bounds = p.get_bounds();
+    for (auto i = 0u; i < 4u; ++i) {
+        BOOST_CHECK(pop.get_x()[0][i] >= bounds.first[i] && pop.get_x()[0][i] <= bounds.second[i]);
+    }
+    // Changing the problem, or the options, releases the data structures and initialises them anew.
+    BOOST_CHECK((evolve_calls(hock_schittkowsky_71{}) == std::array<int, 3>{1, 0, 1}));
+    BOOST_CHECK((evolve_calls(rastrigin{10u}) == std::array<int, 3>{1, 0, 1}));
+    BOOST_CHECK((evolve_calls(rastrigin{10u}) == std::array<int, 3>{0, 1, 0}));
+    uda.set_numeric_option("Valid", 1.);
+    BOOST_CHECK((evolve_calls(rastrigin{10u}) == std::array<int, 3>{1, 0, 1}));
+    BOOST_CHECK((evolve_calls(rastrigin{10u}) == std::array<int, 3>{0, 1, 0}));
+    uda.set_bool_option("invalid_bool_option", true);
+    BOOST_CHECK((calls_made_by([&uda]() {
+                     BOOST_CHECK_THROW(uda.evolve(population{rastrigin{10u}, 1u}), std::invalid_argument);
+                 })
+                 == std::array<int, 3>{1, 0, 1}));
+    // A failed setup leaves the data structures not reusable.
+    uda.reset_bool_options();
+    BOOST_CHECK((evolve_calls(rastrigin{10u}) == std::array<int, 3>{1, 0, 1}));
+    // An exception in the middle of a run does not spoil the data structures, which are initialised anew.
+    BOOST_CHECK_THROW(uda.evolve(population{problem{worhp_throwing_problem{}}, 1u}), std::invalid_argument);
+    BOOST_CHECK((evolve_calls(rastrigin{10u}) == std::array<int, 3>{1, 0, 1}));
+    // Copies share the data structures, also through pagmo::algorithm.
+    algorithm algo{uda};
+    BOOST_CHECK(algo.extract<worhp>()->get_persistent_workspace());
+    BOOST_CHECK((calls_made_by([&algo]() { algo.evolve(population{rastrigin{10u}, 1u}); })
+                 == std::array<int, 3>{0, 1, 0}));
+    BOOST_CHECK((evolve_calls(rastrigin{10u}) == std::array<int, 3>{0, 1, 0}));
+    // Concurrent evolves of two copies: one of them uses temporary data structures.
+    worhp uda2{uda};
+    std::thread th([&uda2]() { uda2.evolve(population{rastrigin{10u}, 1u}); });
+    BOOST_CHECK_NO_THROW(uda.evolve(population{rastrigin{10u}, 1u}));
+    th.join();
+    // The log is filled as in the default mode.
+    uda.set_verbosity(1u);
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK(uda.get_log().size() > 0u);
+    uda.evolve(population{p, 1u});
+    BOOST_CHECK(uda.get_log().size() > 0u);
+    uda.set_persistent_workspace(false);
+    BOOST_CHECK(!uda.get_persistent_workspace());
+    // Without the persistent workspace, each evolve initialises and releases its own data structures.
+    BOOST_CHECK((evolve_calls(p) == std::array<int, 3>{1, 0, 1}));
+    BOOST_CHECK((evolve_calls(p) == std::array<int, 3>{1, 0, 1}));
+}
+
+BOOST_AUTO_TEST_CASE(param_source)
+{
+    problem p{worhp_test_problem{}};
+    // Default source.
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK(uda.get_param_source().empty());
+    BOOST_CHECK(uda.get_extra_info().find("Parameters source: default") != std::string::npos);
+    BOOST_CHECK_NO_THROW(uda.evolve(population{p, 1u}));
+    BOOST_CHECK_NO_THROW(uda.evolve(population{p, 1u}));
+    // In-memory xml.
+    const std::string xml = R"(  <?xml version="1.0" encoding="UTF-8"?>
+<WorhpData><Params><DOUBLE name="TolOpti">1e-8</DOUBLE></Params></WorhpData>)";
+    worhp uda2{false, WORHP_LIB, xml};
+    BOOST_CHECK_EQUAL(uda2.get_param_source(), xml);
+    BOOST_CHECK(uda2.get_extra_info().find("Parameters source: xml string") != std::string::npos);
+    BOOST_CHECK_NO_THROW(uda2.evolve(population{p, 1u}));
+    BOOST_CHECK_NO_THROW(uda2.evolve(population{hock_schittkowsky_71{}, 1u}));
+    // Copies share the parsed parameters.
+    algorithm algo{uda2};
+    BOOST_CHECK_NO_THROW(algo.evolve(population{p, 1u}));
+    // A parameter file.
+    const auto path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    {
+        std::ofstream ofs(path.string());
+        ofs << xml;
+    }
+    worhp uda3{false, WORHP_LIB, path.string()};
+    BOOST_CHECK(uda3.get_extra_info().find("Parameters source: " + path.string()) != std::string::npos);
+    BOOST_CHECK_NO_THROW(uda3.evolve(population{p, 1u}));
+    // Once parsed, the file is not needed anymore.
+    boost::filesystem::remove(path);
+    BOOST_CHECK_NO_THROW(uda3.evolve(population{p, 1u}));
+    // A parameter file that does not exist.
+    BOOST_CHECK_THROW((worhp{false, WORHP_LIB, path.string()}.evolve(population{p, 1u})), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(fused_fitness_and_gradient)
+{
+    BOOST_CHECK(has_fitness_and_gradient<worhp_fused_problem>::value);
+    BOOST_CHECK(!has_fitness_and_gradient<worhp_test_problem>::value);
+    worhp uda{false, WORHP_LIB};
+    population pop{worhp_fused_problem{}, 1u};
+    population pop_ref{worhp_test_problem{}, 1u};
+    pop = uda.evolve(pop);
+    pop_ref = uda.evolve(pop_ref);
+    // The bogus solver requests the fitness and the gradient at each iteration: the fused
+    // method is used in place of the separate gradient.
+    BOOST_CHECK(worhp_fused_problem::counter > 0u);
+    BOOST_CHECK(pop.get_problem().get_gevals() < pop_ref.get_problem().get_gevals());
+}
+
+BOOST_AUTO_TEST_CASE(evaluation_cache)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK(uda.get_cache_stats().empty());
+    BOOST_CHECK_EQUAL(uda.get_cache_size(), 16u);
+    population pop{worhp_test_problem{}, 1u};
+    auto fevals0 = pop.get_problem().get_fevals();
+    auto gevals0 = pop.get_problem().get_gevals();
+    pop = uda.evolve(pop);
+    // At each iteration the bogus solver requests the objective and the constraints (and their gradients) separately
+    // at the same point, and the final point is evaluated once more: the second requests are served by the caches.
+    auto stats = uda.get_cache_stats();
+    BOOST_CHECK(stats["fitness_misses"] > 0u);
+    BOOST_CHECK_EQUAL(stats["fitness_misses"], pop.get_problem().get_fevals() - fevals0);
+    BOOST_CHECK_EQUAL(stats["fitness_hits"], stats["fitness_misses"] + 1u);
+    BOOST_CHECK_EQUAL(stats["gradient_misses"], pop.get_problem().get_gevals() - gevals0);
+    BOOST_CHECK_EQUAL(stats["gradient_hits"], stats["gradient_misses"]);
+    BOOST_CHECK(stats["hessians_misses"] > 0u);
+    BOOST_CHECK_EQUAL(stats["hessians_hits"], 0u);
+    // Disabling the caches.
+    uda.set_cache_size(0u);
+    BOOST_CHECK_EQUAL(uda.get_cache_size(), 0u);
+    BOOST_CHECK(uda.get_extra_info().find("Evaluation cache size: 0") != std::string::npos);
+    fevals0 = pop.get_problem().get_fevals();
+    pop = uda.evolve(pop);
+    stats = uda.get_cache_stats();
+    BOOST_CHECK_EQUAL(stats["fitness_hits"], 0u);
+    BOOST_CHECK_EQUAL(stats["gradient_hits"], 0u);
+    BOOST_CHECK_EQUAL(stats["fitness_misses"], pop.get_problem().get_fevals() - fevals0);
+    // A single entry is enough for the requests of the bogus solver.
+    uda.set_cache_size(1u);
+    pop = uda.evolve(pop);
+    stats = uda.get_cache_stats();
+    BOOST_CHECK_EQUAL(stats["fitness_hits"], stats["fitness_misses"] + 1u);
+}
+
+// The test problem, without the gradient.
+struct worhp_no_gradient_problem {
+    vector_double fitness(const vector_double &x) const
+    {
+        return worhp_test_problem{}.fitness(x);
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return worhp_test_problem{}.get_bounds();
+    }
+    vector_double::size_type get_nec() const
+    {
+        return 1;
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 3;
+    }
+    sparsity_pattern gradient_sparsity() const
+    {
+        return worhp_test_problem{}.gradient_sparsity();
+    }
+    std::vector<sparsity_pattern> hessians_sparsity() const
+    {
+        return worhp_test_problem{}.hessians_sparsity();
+    }
+    std::vector<vector_double> hessians(const vector_double &x) const
+    {
+        return worhp_test_problem{}.hessians(x);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(fd_gradient)
+{
+    worhp uda{false, WORHP_LIB};
+    // The bogus solver always requests the gradient, which the problem does not provide.
+    BOOST_CHECK_THROW(uda.evolve(population{worhp_no_gradient_problem{}, 1u}), not_implemented_error);
+    BOOST_CHECK(uda.get_extra_info().find("Batch fitness evaluator: none") != std::string::npos);
+    // With a bfe, the gradient is computed by the plugin.
+    uda.set_bfe(bfe{});
+    BOOST_CHECK(uda.get_extra_info().find("Batch fitness evaluator: none") == std::string::npos);
+    population pop{worhp_no_gradient_problem{}, 1u};
+    const auto fevals0 = pop.get_problem().get_fevals();
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(pop.get_problem().get_gevals(), 0u);
+    // The gradient sparsity has three colors: each gradient costs three fitness evaluations, besides the one
+    // at the point itself.
+    auto stats = uda.get_cache_stats();
+    BOOST_CHECK_EQUAL(pop.get_problem().get_fevals() - fevals0,
+                      stats["fitness_misses"] + 3u * stats["gradient_misses"]);
+    // Problems providing the gradient are not affected.
+    BOOST_CHECK_NO_THROW(uda.evolve(population{worhp_test_problem{}, 1u}));
+}
+
+// The same test problem, providing the gradient but not the hessians.
+struct worhp_no_hessians_problem {
+    vector_double fitness(const vector_double &x) const
+    {
+        return worhp_test_problem{}.fitness(x);
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return worhp_test_problem{}.get_bounds();
+    }
+    vector_double::size_type get_nec() const
+    {
+        return 1;
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 3;
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        return worhp_test_problem{}.gradient(x);
+    }
+    sparsity_pattern gradient_sparsity() const
+    {
+        return worhp_test_problem{}.gradient_sparsity();
+    }
+    std::vector<sparsity_pattern> hessians_sparsity() const
+    {
+        return worhp_test_problem{}.hessians_sparsity();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(fd_hessians)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK(!uda.get_fd_hessians());
+    BOOST_CHECK(uda.get_extra_info().find("Finite-difference hessians: inactive") != std::string::npos);
+    // The bogus solver always requests the hessians, which the problem does not provide.
+    BOOST_CHECK_THROW(uda.evolve(population{worhp_no_hessians_problem{}, 1u}), not_implemented_error);
+    // In the finite-difference hessians mode, the hessians are computed by the plugin.
+    uda.set_fd_hessians(true);
+    BOOST_CHECK(uda.get_fd_hessians());
+    BOOST_CHECK(uda.get_extra_info().find("Finite-difference hessians: active") != std::string::npos);
+    population pop{worhp_no_hessians_problem{}, 1u};
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(pop.get_problem().get_hevals(), 0u);
+    BOOST_CHECK(uda.get_cache_stats()["hessians_misses"] > 0u);
+    // Problems providing the hessians are not affected.
+    pop = population{worhp_test_problem{}, 1u};
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK(pop.get_problem().get_hevals() > 0u);
+}
+
+// The same test problem, not providing the gradient sparsity and providing the gradient in the dense layout.
+struct worhp_undeclared_sparsity_problem {
+    vector_double fitness(const vector_double &x) const
+    {
+        return worhp_test_problem{}.fitness(x);
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return worhp_test_problem{}.get_bounds();
+    }
+    vector_double::size_type get_nec() const
+    {
+        return 1;
+    }
+    vector_double::size_type get_nic() const
+    {
+        return 3;
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        vector_double retval(20, 0.);
+        const auto sp = worhp_test_problem{}.gradient_sparsity();
+        const auto g = worhp_test_problem{}.gradient(x);
+        for (decltype(sp.size()) k = 0u; k < sp.size(); ++k) {
+            retval[sp[k].first * 4u + sp[k].second] = g[k];
+        }
+        return retval;
+    }
+    std::vector<sparsity_pattern> hessians_sparsity() const
+    {
+        return worhp_test_problem{}.hessians_sparsity();
+    }
+    std::vector<vector_double> hessians(const vector_double &x) const
+    {
+        return worhp_test_problem{}.hessians(x);
+    }
+};
+
+// A problem providing a dense gradient, whose objective does not depend on x[1] for |x[1]| <= 2.
+struct worhp_vanishing_problem {
+    vector_double fitness(const vector_double &x) const
+    {
+        const auto d = std::max(0., std::abs(x[1]) - 2.);
+        return {x[0] * x[0] + d * d};
+    }
+    std::pair<vector_double, vector_double> get_bounds() const
+    {
+        return {{-10, -10}, {10, 10}};
+    }
+    vector_double gradient(const vector_double &x) const
+    {
+        const auto d = std::max(0., std::abs(x[1]) - 2.);
+        return {2 * x[0], x[1] > 0. ? 2 * d : -2 * d};
+    }
+    std::vector<vector_double> hessians(const vector_double &x) const
+    {
+        return {{2., 0., std::abs(x[1]) > 2. ? 2. : 0.}};
+    }
+};
+
+BOOST_AUTO_TEST_CASE(sparsity_detection)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK(!uda.get_sparsity_detection());
+    BOOST_CHECK(uda.get_extra_info().find("Gradient sparsity detection: inactive") != std::string::npos);
+    uda.set_sparsity_detection(true);
+    BOOST_CHECK(uda.get_sparsity_detection());
+    BOOST_CHECK(uda.get_extra_info().find("Gradient sparsity detection: active") != std::string::npos);
+    population pop{worhp_undeclared_sparsity_problem{}, 1u};
+    const auto gevals0 = pop.get_problem().get_gevals();
+    uda.set_verbosity(1u);
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    // Four gradient evaluations to probe the problem, besides those requested by WORHP.
+    BOOST_CHECK_EQUAL(pop.get_problem().get_gevals() - gevals0, 4u + uda.get_cache_stats()["gradient_misses"]);
+    // The detected pattern is cached: re-using it costs no further gradient evaluations, as it is verified during
+    // the run.
+    const auto gevals1 = pop.get_problem().get_gevals();
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(pop.get_problem().get_gevals() - gevals1, uda.get_cache_stats()["gradient_misses"]);
+    // Near x = (0, 0) the objective does not depend on x[1], but it does at the random points visited by the bogus
+    // solver: the run is stopped and started again with a dense gradient sparsity, which is then cached.
+    population pop2{worhp_vanishing_problem{}};
+    pop2.push_back({0., 0.});
+    BOOST_CHECK_NO_THROW(pop2 = uda.evolve(pop2));
+    BOOST_CHECK_EQUAL(ppnf::detail::cached_gradient_sparsity(pop2.get_problem(), {0., 0.}, bfe{})->size(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(hm_threads)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK_EQUAL(uda.get_hm_threads(), 1u);
+    BOOST_CHECK(uda.get_extra_info().find("Hessian assembly threads: 1") != std::string::npos);
+    for (auto n : {0u, 2u, 4u, 100u}) {
+        uda.set_hm_threads(n);
+        BOOST_CHECK_EQUAL(uda.get_hm_threads(), n);
+        BOOST_CHECK_NO_THROW(uda.evolve(population{worhp_test_problem{}, 1u}));
+    }
+    // Also with the hessians computed by the plugin.
+    uda.set_fd_hessians(true);
+    population pop{worhp_no_hessians_problem{}, 1u};
+    BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+    BOOST_CHECK_EQUAL(pop.get_problem().get_hevals(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(warm_start)
+{
+    worhp uda{false, WORHP_LIB};
+    BOOST_CHECK(!uda.get_warm_start());
+    BOOST_CHECK(uda.get_extra_info().find("Warm start: inactive") != std::string::npos);
+    uda.set_warm_start(true);
+    BOOST_CHECK(uda.get_warm_start());
+    BOOST_CHECK(uda.get_extra_info().find("Warm start: active") != std::string::npos);
+    // No data before the first evolve.
+    BOOST_CHECK(std::get<0>(uda.get_warm_start_data()).empty());
+    BOOST_CHECK(std::get<1>(uda.get_warm_start_data()).empty());
+    // The final primal-dual solution is stored after each evolve.
+    problem p{worhp_test_problem{}};
+    population pop{p, 1u};
+    uda.set_verbosity(10u);
+    pop = uda.evolve(pop);
+    auto data = uda.get_warm_start_data();
+    BOOST_CHECK_EQUAL(std::get<0>(data), p.get_name());
+    BOOST_CHECK_EQUAL(std::get<1>(data).size(), 4u);
+    BOOST_CHECK_EQUAL(std::get<2>(data).size(), 4u);
+    BOOST_CHECK_EQUAL(std::get<3>(data).size(), 4u);
+    // The next evolve on the same problem is warm started (also restarting WORHP in the persistent workspace mode),
+    // on a different problem cold started.
+    uda.set_persistent_workspace(true);
+    for (auto i = 0u; i < 3u; ++i) {
+        BOOST_CHECK_NO_THROW(pop = uda.evolve(pop));
+        BOOST_CHECK(uda.get_last_opt_result().find("All went great!!!!") != std::string::npos);
+    }
+    BOOST_CHECK_NO_THROW(uda.evolve(population{hock_schittkowsky_71{}, 1u}));
+    BOOST_CHECK_EQUAL(std::get<0>(uda.get_warm_start_data()), problem{hock_schittkowsky_71{}}.get_name());
+    BOOST_CHECK_EQUAL(std::get<3>(uda.get_warm_start_data()).size(), 2u);
+    // A run throwing an exception does not overwrite the data.
+    BOOST_CHECK_THROW(uda.evolve(population{problem{worhp_throwing_problem{}}, 1u}), std::invalid_argument);
+    BOOST_CHECK_EQUAL(std::get<0>(uda.get_warm_start_data()), problem{hock_schittkowsky_71{}}.get_name());
+    // The data can be transferred to another object.
+    worhp uda2{false, WORHP_LIB};
+    uda2.set_warm_start(true);
+    uda2.set_warm_start_data(data);
+    BOOST_CHECK(uda2.get_warm_start_data() == data);
+    BOOST_CHECK_NO_THROW(uda2.evolve(pop));
+    // The warm start database: the states are looked up by the initial decision vector.
+    BOOST_CHECK_EQUAL(uda2.get_warm_start_db_size(), 0u);
+    uda2.set_warm_start_db_size(5u);
+    BOOST_CHECK_EQUAL(uda2.get_warm_start_db_size(), 5u);
+    BOOST_CHECK(uda2.get_extra_info().find("Warm start database size: 5") != std::string::npos);
+    for (auto i = 0u; i < 10u; ++i) {
+        BOOST_CHECK_NO_THROW(uda2.evolve(population{worhp_test_problem{}, 1u}));
+    }
+    uda2.set_warm_start_db_size(0u);
+    BOOST_CHECK_NO_THROW(uda2.evolve(population{worhp_test_problem{}, 1u}));
+    // Inconsistent data is rejected.
+    std::get<2>(data).pop_back();
+    BOOST_CHECK_THROW(uda2.set_warm_start_data(data), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_CASE(extrainfo_and_others)
 {
     worhp uda{true, WORHP_LIB};
@@ -235,12 +800,24 @@ BOOST_AUTO_TEST_CASE(serialization_test)
     algo.extract<worhp>()->set_integer_option("some_int", 4);
     algo.extract<worhp>()->set_numeric_option("some_float", 2.2);
     algo.extract<worhp>()->set_bool_option("some_bool", false);
+    algo.extract<worhp>()->set_persistent_workspace(true);
+    algo.extract<worhp>()->set_cache_size(3u);
+    algo.extract<worhp>()->set_bfe(bfe{});
+    algo.extract<worhp>()->set_fd_hessians(true);
+    algo.extract<worhp>()->set_hm_threads(2u);
+    algo.extract<worhp>()->set_sparsity_detection(true);
+    algo.extract<worhp>()->set_warm_start(true);
+    algo.extract<worhp>()->set_warm_start_db_size(7u);
+    algo.extract<worhp>()->set_log_mode("major");
+    algo.extract<worhp>()->set_log_capacity(64u);
+    algo.extract<worhp>()->set_output_mode("async");
     pop = algo.evolve(pop);
 
     // Store the string representation of p.
     std::stringstream ss;
     auto before_text = boost::lexical_cast<std::string>(algo);
     auto before_log = algo.extract<worhp>()->get_log();
+    auto before_warm_start_data = algo.extract<worhp>()->get_warm_start_data();
     // Now serialize, deserialize and compare the result.
     {
         boost::archive::binary_oarchive oarchive(ss);
@@ -254,4 +831,18 @@ BOOST_AUTO_TEST_CASE(serialization_test)
     }
     auto after_text = boost::lexical_cast<std::string>(algo);
     BOOST_CHECK_EQUAL(before_text, after_text);
-}
\ No newline at end of file
+    BOOST_CHECK(algo.extract<worhp>()->get_persistent_workspace());
+    BOOST_CHECK_EQUAL(algo.extract<worhp>()->get_cache_size(), 3u);
+    BOOST_CHECK(algo.extract<worhp>()->get_fd_hessians());
+    BOOST_CHECK_EQUAL(algo.extract<worhp>()->get_hm_threads(), 2u);
+    BOOST_CHECK(algo.extract<worhp>()->get_sparsity_detection());
+    BOOST_CHECK(algo.extract<worhp>()->get_warm_start());
+    BOOST_CHECK_EQUAL(algo.extract<worhp>()->get_warm_start_db_size(), 7u);
+    BOOST_CHECK_EQUAL(algo.extract<worhp>()->get_log_mode(), "major");
+    BOOST_CHECK_EQUAL(algo.extract<worhp>()->get_log_capacity(), 64u);
+    BOOST_CHECK_EQUAL(algo.extract<worhp>()->get_output_mode(), "async");
+    BOOST_CHECK(algo.extract<worhp>()->get_warm_start_data() == before_warm_start_data);
+    BOOST_CHECK(algo.extract<worhp>()->get_log() == before_log);
+    // The deserialized object has its own persistent data structures.
+    BOOST_CHECK_NO_THROW(algo.evolve(pop));
+}